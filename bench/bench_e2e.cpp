@@ -0,0 +1,203 @@
+/* End-to-end throughput: FactorySimple -> DownloaderSimple -> TCPSocketBandwidth against a loopback origin.
+ *
+ *   bench_e2e [--size <bytes>] [--count <files>] [--concurrency <n,n,...>] [--out <dir>]
+ *
+ * Prints one JSON document to stdout. CPU is measured for the download thread only
+ * (RUSAGE_THREAD), the origin runs on its own thread. Peak RSS is process-wide. */
+
+#include "origin.h"
+
+#include "factory_simple.h"
+#include "on_tick_simple.h"
+#include "aio/bandwidth_controller.h"
+#include "aio/factory_tcp_bandwidth.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+struct BenchOptions
+{
+    size_t size = 1024 * 1024;
+    size_t count = 200;
+    vector<size_t> concurrency{1, 8, 32, 128};
+    string out = "bench_e2e_out";
+};
+
+struct Result
+{
+    size_t concurrency;
+    double seconds;
+    size_t done;
+    size_t failed;
+    size_t bytes;
+    double cpu_seconds;
+    long peak_rss_kb;
+};
+
+class BenchTaskList final : public TaskList
+{
+public:
+    BenchTaskList(const Origin& origin_, size_t size_, size_t count_, string dir_)
+        : origin(origin_), size{size_}, count{count_}, dir{ move(dir_) }
+    {}
+
+    virtual unique_ptr<Task> get() override
+    {
+        if (next == count)
+            return nullptr;
+        const auto line = next++;
+        return make_unique<Task>( origin.uri(size), dir + "/" + to_string(line), line );
+    }
+
+private:
+    const Origin& origin;
+    const size_t size;
+    const size_t count;
+    const string dir;
+    size_t next = 0;
+};
+
+class BenchDashboard final : public Dashboard
+{
+public:
+    virtual void update(size_t, const StatusDownloader& status) override
+    {
+        if (status.state == StatusDownloader::State::Done)
+        {
+            done++;
+            bytes += status.downloaded;
+        } else if (status.state == StatusDownloader::State::Failed)
+        {
+            failed++;
+            if (failed <= 3)
+                cerr << "bench: " << status.str() << endl;
+        }
+    }
+
+    size_t done = 0;
+    size_t failed = 0;
+    size_t bytes = 0;
+};
+
+double cpu_seconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+         + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+long peak_rss_kb()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+Result run(const Origin& origin, const BenchOptions& options, size_t concurrency)
+{
+    ::mkdir(options.out.c_str(), 0755);
+    BenchTaskList task_list{origin, options.size, options.count, options.out};
+    BenchDashboard dashboard;
+
+    auto loop = uvw::Loop::getDefault();
+    // The limit is far above loopback speed, the controller only paces its cycles
+    auto controller = make_shared< aio::bandwidth::ControllerSimple<AIO_UVW> >( loop, size_t{1} << 40, make_unique<aio::bandwidth::Time>() );
+    auto factory_socket = make_shared<aio::FactoryTCPSocketBandwidth>(loop, controller);
+    auto factory = make_shared<FactorySimple>(loop, dashboard, factory_socket);
+
+    std::list<Job> job_list;
+    auto on_tick = make_shared<OnTickSimple>(job_list, factory, task_list, dashboard);
+    factory->set_OnTick(on_tick);
+
+    const auto cpu_start = cpu_seconds();
+    const auto start = chrono::steady_clock::now();
+    on_tick->start(concurrency);
+    loop->run();
+    const auto seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+    const auto cpu = cpu_seconds() - cpu_start;
+
+    for (size_t i = 0; i < options.count; i++)
+        std::remove( (options.out + "/" + to_string(i)).c_str() );
+
+    return Result{ concurrency, seconds, dashboard.done, dashboard.failed, dashboard.bytes, cpu, peak_rss_kb() };
+}
+
+vector<size_t> parse_list(const string& s)
+{
+    vector<size_t> values;
+    stringstream stream{s};
+    string item;
+    while ( getline(stream, item, ',') )
+        values.push_back( stoul(item) );
+    return values;
+}
+
+BenchOptions parse(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const string key = argv[i];
+        const string value = argv[i + 1];
+        if (key == "--size")
+            options.size = stoul(value);
+        else if (key == "--count")
+            options.count = stoul(value);
+        else if (key == "--concurrency")
+            options.concurrency = parse_list(value);
+        else if (key == "--out")
+            options.out = value;
+        else
+            throw runtime_error{"Unknown option " + key};
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    try {
+        options = parse(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl
+             << "Usage: bench_e2e [--size <bytes>] [--count <files>] [--concurrency <n,n,...>] [--out <dir>]" << endl;
+        return 1;
+    }
+
+    Origin origin{options.size};
+
+    cout << "{\"benchmark\":\"e2e_loopback\",\"file_size\":" << options.size << ",\"files\":" << options.count << ",\"runs\":[";
+    bool first = true;
+    for (const auto n : options.concurrency)
+    {
+        const auto r = run(origin, options, n);
+        const double mb = static_cast<double>(r.bytes) / (1024 * 1024);
+        const double gb = mb / 1024;
+        cout << (first ? "" : ",") << "\n  {\"concurrency\":" << r.concurrency
+             << ",\"seconds\":" << r.seconds
+             << ",\"done\":" << r.done
+             << ",\"failed\":" << r.failed
+             << ",\"mb_per_s\":" << (r.seconds > 0 ? mb / r.seconds : 0)
+             << ",\"files_per_s\":" << (r.seconds > 0 ? static_cast<double>(r.done) / r.seconds : 0)
+             << ",\"cpu_seconds_per_gb\":" << (gb > 0 ? r.cpu_seconds / gb : 0)
+             << ",\"peak_rss_kb\":" << r.peak_rss_kb << "}";
+        first = false;
+    }
+    cout << "\n]}" << endl;
+
+    return 0;
+}
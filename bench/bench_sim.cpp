@@ -0,0 +1,311 @@
+/* Scheduler and rate limiter on a simulated network, virtual time.
+ *
+ *   bench_sim [--jobs <n>] [--hosts <n>] [--size <bytes>] [--pareto <alpha>] [--concurrency <n>]
+ *             [--per-host <n>] [--limit <bytes/s>] [--access <bytes/s>] [--disk <bytes/s>]
+ *             [--rtt <min_ms,max_ms>] [--bandwidth <min,max bytes/s>] [--connect-failure <p>] [--seed <n>]
+ *
+ * OnTickSimple, ControllerSimple and DownloaderSimple run unchanged over AIO_Sim (sim.h).
+ * Sizes are fixed, or Pareto distributed with the given mean when --pareto is set. Jobs pick hosts
+ * uniformly. --limit 0 runs without the bandwidth controller.
+ * Prints one JSON document to stdout: makespan, achieved rate against the limit and
+ * Jain's fairness index over job and host throughput. */
+
+#include "sim.h"
+
+#include "on_tick_simple.h"
+#include "downloader_simple.h"
+#include "task_scheduler.h"
+#include "http.h"
+#include "aio/bandwidth_controller.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+struct BenchOptions
+{
+    size_t jobs = 10000;
+    size_t size = 256 * 1024;
+    double pareto = 0;
+    size_t concurrency = 64;
+    size_t per_host = 0;
+    size_t limit = 0;
+    sim::Network::Config network;
+};
+
+class SimTaskList final : public TaskList
+{
+public:
+    SimTaskList(const BenchOptions& options_, std::mt19937& random_)
+        : options(options_),
+          random(random_)
+    {}
+
+    virtual unique_ptr<Task> get() override
+    {
+        if (next == options.jobs)
+            return nullptr;
+        const auto line = next++;
+        const auto host = uniform_int_distribution<size_t>{0, options.network.hosts - 1}(random);
+        return make_unique<Task>( "http://h" + to_string(host) + ".sim/" + to_string( size() ), "f" + to_string(line), line );
+    }
+
+private:
+    const BenchOptions& options;
+    std::mt19937& random;
+    size_t next = 0;
+
+    size_t size()
+    {
+        if (options.pareto <= 1)
+            return options.size;
+        // Scale chosen so the mean is options.size
+        const double scale = static_cast<double>(options.size) * (options.pareto - 1) / options.pareto;
+        const double u = uniform_real_distribution<double>{0, 1}(random);
+        return static_cast<size_t>( scale / pow(1 - u, 1 / options.pareto) );
+    }
+};
+
+class SimDashboard final : public Dashboard
+{
+public:
+    struct Finished
+    {
+        double seconds;
+        size_t bytes;
+        size_t host;
+        bool done;
+    };
+
+    SimDashboard(sim::Loop& loop_)
+        : loop(loop_)
+    {}
+
+    void set_host(size_t id, size_t host) { hosts[id] = host; }
+
+    virtual void update(size_t id, const StatusDownloader& status) override
+    {
+        using State = StatusDownloader::State;
+
+        const auto now = loop.now();
+        const auto started = start.emplace(id, now).first->second;
+        if (status.state != State::Done && status.state != State::Failed)
+            return;
+
+        start.erase(id);
+        const auto seconds = chrono::duration<double>(now - started).count();
+        finished.push_back( Finished{seconds, status.downloaded, hosts[id], status.state == State::Done} );
+        hosts.erase(id);
+        makespan = now;
+    }
+
+    vector<Finished> finished;
+    sim::Duration makespan{0};
+
+private:
+    sim::Loop& loop;
+    unordered_map<size_t, sim::Duration> start;
+    unordered_map<size_t, size_t> hosts;
+};
+
+class SimFactory final : public Factory
+{
+public:
+    SimFactory(shared_ptr<sim::Loop> loop_, SimDashboard& dashboard_, shared_ptr<aio::FactoryTCPSocket> factory_socket_)
+        : loop{ move(loop_) },
+          dashboard{dashboard_},
+          factory_socket{ move(factory_socket_) }
+    {}
+
+    virtual shared_ptr<Downloader> create(size_t job_id, const string& uri, const string& fname) override
+    {
+        // "http://h<n>.sim/..."
+        dashboard.set_host( job_id, stoul( uri.substr(8) ) );
+        auto downloader = make_shared< DownloaderSimple<AIO_Sim, HttpParser> >(loop, on_tick, factory_socket);
+        bool runned = downloader->run(uri, fname);
+        dashboard.update(job_id, downloader->status());
+        return (runned) ? downloader : nullptr;
+    }
+    virtual void set_OnTick(shared_ptr<OnTick> on_tick_) override { on_tick = move(on_tick_); }
+
+private:
+    shared_ptr<sim::Loop> loop;
+    SimDashboard& dashboard;
+    shared_ptr<aio::FactoryTCPSocket> factory_socket;
+    shared_ptr<OnTick> on_tick;
+};
+
+double jain(const vector<double>& x)
+{
+    double sum = 0, squares = 0;
+    for (const auto v : x)
+    {
+        sum += v;
+        squares += v * v;
+    }
+    return (squares > 0) ? sum * sum / ( static_cast<double>( x.size() ) * squares ) : 0;
+}
+
+double percentile(vector<double> values, double q)
+{
+    if ( values.empty() )
+        return 0;
+    sort( begin(values), end(values) );
+    return values[ static_cast<size_t>( q * static_cast<double>( values.size() - 1 ) + 0.5 ) ];
+}
+
+pair<size_t, size_t> parse_pair(const string& s)
+{
+    const auto comma = s.find(',');
+    if (comma == string::npos)
+        throw runtime_error{"Expected <min,max>: " + s};
+    return make_pair( stoul( s.substr(0, comma) ), stoul( s.substr(comma + 1) ) );
+}
+
+BenchOptions parse(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const string key = argv[i];
+        const string value = argv[i + 1];
+        if (key == "--jobs")
+            options.jobs = stoul(value);
+        else if (key == "--hosts")
+            options.network.hosts = max<size_t>( stoul(value), 1 );
+        else if (key == "--size")
+            options.size = stoul(value);
+        else if (key == "--pareto")
+            options.pareto = stod(value);
+        else if (key == "--concurrency")
+            options.concurrency = stoul(value);
+        else if (key == "--per-host")
+            options.per_host = stoul(value);
+        else if (key == "--limit")
+            options.limit = stoul(value);
+        else if (key == "--access")
+            options.network.access = stoul(value);
+        else if (key == "--disk")
+            options.network.disk = stoul(value);
+        else if (key == "--rtt")
+        {
+            const auto rtt = parse_pair(value);
+            options.network.rtt_min = chrono::milliseconds{rtt.first};
+            options.network.rtt_max = chrono::milliseconds{rtt.second};
+        }
+        else if (key == "--bandwidth")
+        {
+            const auto bandwidth = parse_pair(value);
+            options.network.bandwidth_min = max<size_t>(bandwidth.first, 1);
+            options.network.bandwidth_max = bandwidth.second;
+        }
+        else if (key == "--connect-failure")
+            options.network.connect_failure = stod(value);
+        else if (key == "--seed")
+            options.network.seed = static_cast<unsigned int>( stoul(value) );
+        else
+            throw runtime_error{"Unknown option " + key};
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    try {
+        options = parse(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl
+             << "Usage: bench_sim [--jobs <n>] [--hosts <n>] [--size <bytes>] [--pareto <alpha>] [--concurrency <n>]" << endl
+             << "                 [--per-host <n>] [--limit <bytes/s>] [--access <bytes/s>] [--disk <bytes/s>]" << endl
+             << "                 [--rtt <min_ms,max_ms>] [--bandwidth <min,max bytes/s>] [--connect-failure <p>] [--seed <n>]" << endl;
+        return 1;
+    }
+
+    sim::Network network{options.network};
+    std::mt19937 random{ options.network.seed + 1 };
+    SimTaskList source{options, random};
+    unique_ptr<TaskListScheduler> scheduler;
+    if (options.per_host > 0)
+        scheduler = make_unique<TaskListScheduler>(source, options.per_host);
+    TaskList& task_list = scheduler ? static_cast<TaskList&>(*scheduler) : source;
+
+    auto loop = make_shared<sim::Loop>(network);
+    SimDashboard dashboard{*loop};
+    shared_ptr<aio::bandwidth::Controller> controller;
+    if (options.limit > 0)
+        controller = make_shared< aio::bandwidth::ControllerSimple<AIO_Sim> >( loop, options.limit, make_unique<sim::Time>(loop) );
+    auto factory_socket = make_shared<sim::FactorySocket>(loop, controller);
+    auto factory = make_shared<SimFactory>(loop, dashboard, factory_socket);
+
+    std::list<Job> job_list;
+    auto on_tick = make_shared<OnTickSimple>(job_list, factory, task_list, dashboard);
+    factory->set_OnTick(on_tick);
+
+    const auto wall_start = chrono::steady_clock::now();
+    on_tick->start(options.concurrency);
+    const auto events = loop->run();
+    const auto wall = chrono::duration<double>( chrono::steady_clock::now() - wall_start ).count();
+
+    const auto makespan = chrono::duration<double>(dashboard.makespan).count();
+    size_t done = 0, bytes = 0;
+    vector<double> seconds, job_rate;
+    vector<double> host_bytes( network.hosts().size(), 0 ), host_time( network.hosts().size(), 0 );
+    for (const auto& job : dashboard.finished)
+    {
+        seconds.push_back(job.seconds);
+        if (!job.done)
+            continue;
+        done++;
+        bytes += job.bytes;
+        if (job.seconds > 0)
+            job_rate.push_back( static_cast<double>(job.bytes) / job.seconds );
+        host_bytes[job.host] += static_cast<double>(job.bytes);
+        host_time[job.host] += job.seconds;
+    }
+    vector<double> host_rate;
+    for (size_t i = 0; i < host_bytes.size(); i++)
+        if (host_time[i] > 0)
+            host_rate.push_back( host_bytes[i] / host_time[i] );
+
+    // Whole seconds only, the last one is partial
+    vector<double> per_second;
+    const auto& written = network.written();
+    for (size_t i = 0; i + 1 < written.size(); i++)
+        per_second.push_back( static_cast<double>(written[i]) );
+
+    const double achieved = (makespan > 0) ? static_cast<double>(bytes) / makespan : 0;
+    const double limit = static_cast<double>(options.limit);
+    cout << "{\"benchmark\":\"simulation\",\"jobs\":" << options.jobs
+         << ",\"done\":" << done
+         << ",\"failed\":" << dashboard.finished.size() - done
+         << ",\"events\":" << events
+         << ",\"wall_seconds\":" << wall
+         << ",\"makespan_seconds\":" << makespan
+         << ",\n \"rate\":{\"limit\":" << options.limit
+         << ",\"achieved\":" << achieved
+         << ",\"ratio\":" << ( (limit > 0) ? achieved / limit : 0 )
+         << ",\"per_second_p5\":" << percentile(per_second, 0.05)
+         << ",\"per_second_p50\":" << percentile(per_second, 0.5)
+         << ",\"per_second_p95\":" << percentile(per_second, 0.95) << "}"
+         << ",\n \"fairness\":{\"jobs_jain\":" << jain(job_rate)
+         << ",\"hosts_jain\":" << jain(host_rate) << "}"
+         << ",\n \"job_seconds\":{\"p50\":" << percentile(seconds, 0.5)
+         << ",\"p99\":" << percentile(seconds, 0.99)
+         << ",\"max\":" << percentile(seconds, 1) << "}"
+         << "\n}" << endl;
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+/* Job completion time distribution against a faulty loopback origin and a stub resolver.
+ *
+ *   bench_tail [--tasks <file>] [--size <bytes>] [--count <files>] [--concurrency <n>] [--per-host <n>]
+ *              [--port <port>] [--latency <ms>] [--jitter <ms>] [--bandwidth <bytes/s>]
+ *              [--stall <p>] [--reset <p>] [--redirects <n>]
+ *              [--dns-delay <ms>] [--dns-jitter <ms>] [--dns-failure <p>] [--seed <n>] [--out <dir>]
+ *
+ * Any host name resolves to the origin. A task file holds the usual "<uri> <fname>" lines with
+ * the origin port, e.g. "http://origin.test:8090/1048576 file1" run with --port 8090; without it
+ * <count> files of <size> bytes are taken from "origin.test". Job time runs from the first
+ * downloader of a job to its final state, redirects included.
+ * Prints one JSON document to stdout. */
+
+#include "origin.h"
+#include "stub_resolver.h"
+
+#include "on_tick_simple.h"
+#include "downloader_simple.h"
+#include "task_simple.h"
+#include "task_scheduler.h"
+#include "metrics.h"
+#include "http.h"
+#include "aio/bandwidth_controller.h"
+#include "aio/factory_tcp_bandwidth.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchOptions
+{
+    string tasks;
+    size_t size = 1024 * 1024;
+    size_t count = 200;
+    size_t concurrency = 32;
+    size_t per_host = 0;
+    unsigned int port = 0;
+    Origin::Faults faults;
+    StubResolver::Config dns;
+    string out = "bench_tail_out";
+};
+
+class SyntheticTaskList final : public TaskList
+{
+public:
+    SyntheticTaskList(const Origin& origin_, size_t size_, size_t count_, string dir_)
+        : origin(origin_), size{size_}, count{count_}, dir{ move(dir_) }
+    {}
+
+    virtual unique_ptr<Task> get() override
+    {
+        if (next == count)
+            return nullptr;
+        const auto line = next++;
+        return make_unique<Task>( origin.uri(size, "origin.test"), dir + "/" + to_string(line), line );
+    }
+
+private:
+    const Origin& origin;
+    const size_t size;
+    const size_t count;
+    const string dir;
+    size_t next = 0;
+};
+
+const char* error_name(StatusDownloader::Error error)
+{
+    using Error = StatusDownloader::Error;
+
+    switch (error)
+    {
+    case Error::None:             return "none";
+    case Error::Abort:            return "abort";
+    case Error::UriParse:         return "uri_parse";
+    case Error::SocketCreate:     return "socket_create";
+    case Error::TimerCreate:      return "timer_create";
+    case Error::ResolverCreate:   return "resolver_create";
+    case Error::Resolve:          return "resolve";
+    case Error::Connect:          return "connect";
+    case Error::ConnectTimeout:   return "connect_timeout";
+    case Error::NetTimer:         return "net_timer";
+    case Error::Request:          return "request";
+    case Error::RequestTimeout:   return "request_timeout";
+    case Error::ResponseRead:     return "response_read";
+    case Error::ResponseTimeout:  return "response_timeout";
+    case Error::ConnectionClosed: return "connection_closed";
+    case Error::ResponseParse:    return "response_parse";
+    case Error::FileOpen:         return "file_open";
+    case Error::FileWrite:        return "file_write";
+    case Error::FileClose:        return "file_close";
+    case Error::MaxRedirect:      return "max_redirect";
+    case Error::Checksum:         return "checksum";
+    }
+    return "unknown";
+}
+
+class BenchDashboard final : public Dashboard
+{
+public:
+    virtual void update(size_t id, const StatusDownloader& status) override
+    {
+        using State = StatusDownloader::State;
+
+        const auto now = Clock::now();
+        const auto started = start.emplace(id, now).first->second;
+        if (status.state != State::Done && status.state != State::Failed)
+            return;
+
+        start.erase(id);
+        const auto ms = chrono::duration<double, milli>(now - started).count();
+        if (status.state == State::Done)
+        {
+            done.push_back(ms);
+        } else
+        {
+            failed.push_back(ms);
+            errors[ error_name(status.error) ]++;
+        }
+    }
+
+    vector<double> done;
+    vector<double> failed;
+    map<string, size_t> errors;
+
+private:
+    unordered_map<size_t, Clock::time_point> start;
+};
+
+/* FactorySimple with the stub resolver in place of uvw::GetAddrInfoReq */
+class BenchFactory final : public Factory
+{
+public:
+    BenchFactory(shared_ptr<uvw::Loop> loop_, Dashboard& dashboard_, shared_ptr<aio::FactoryTCPSocket> factory_socket_)
+        : loop{ move(loop_) },
+          dashboard{dashboard_},
+          factory_socket{ move(factory_socket_) }
+    {}
+
+    virtual shared_ptr<Downloader> create(size_t job_id, const string& uri, const string& fname) override
+    {
+        auto downloader = make_shared< DownloaderSimple<AIO_Stub, HttpParser> >(loop, on_tick, factory_socket);
+        bool runned = downloader->run(uri, fname);
+        dashboard.update(job_id, downloader->status());
+        return (runned) ? downloader : nullptr;
+    }
+    virtual void set_OnTick(shared_ptr<OnTick> on_tick_) override { on_tick = move(on_tick_); }
+
+private:
+    shared_ptr<uvw::Loop> loop;
+    Dashboard& dashboard;
+    shared_ptr<aio::FactoryTCPSocket> factory_socket;
+    shared_ptr<OnTick> on_tick;
+};
+
+void write_distribution(ostream& out, vector<double> values)
+{
+    sort( begin(values), end(values) );
+    const auto at = [&values](double q)
+    {
+        if ( values.empty() )
+            return 0.0;
+        const auto rank = static_cast<size_t>( q * static_cast<double>( values.size() - 1 ) + 0.5 );
+        return values[rank];
+    };
+    out << "{\"count\":" << values.size()
+        << ",\"p50\":" << at(0.5)
+        << ",\"p90\":" << at(0.9)
+        << ",\"p99\":" << at(0.99)
+        << ",\"p999\":" << at(0.999)
+        << ",\"max\":" << ( values.empty() ? 0.0 : values.back() ) << "}";
+}
+
+void write_phases(ostream& out, const metrics::Registry& r)
+{
+    static const pair<const char*, const metrics::LatencyHistogram metrics::Registry::*> phases[] = {
+        {"resolve", &metrics::Registry::resolve_latency},
+        {"connect", &metrics::Registry::connect_latency},
+        {"ttfb", &metrics::Registry::ttfb_latency},
+        {"transfer", &metrics::Registry::transfer_duration}
+    };
+
+    out << "{";
+    bool first = true;
+    for (const auto& phase : phases)
+    {
+        const auto& histogram = r.*(phase.second);
+        out << (first ? "" : ",") << "\"" << phase.first << "\":{\"count\":" << histogram.count()
+            << ",\"p50\":" << static_cast<double>( histogram.percentile(0.5) ) / 1000
+            << ",\"p99\":" << static_cast<double>( histogram.percentile(0.99) ) / 1000 << "}";
+        first = false;
+    }
+    out << "}";
+}
+
+BenchOptions parse(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const string key = argv[i];
+        const string value = argv[i + 1];
+        if (key == "--tasks")
+            options.tasks = value;
+        else if (key == "--size")
+            options.size = stoul(value);
+        else if (key == "--count")
+            options.count = stoul(value);
+        else if (key == "--concurrency")
+            options.concurrency = stoul(value);
+        else if (key == "--per-host")
+            options.per_host = stoul(value);
+        else if (key == "--port")
+            options.port = static_cast<unsigned int>( stoul(value) );
+        else if (key == "--latency")
+            options.faults.latency = chrono::milliseconds{ stol(value) };
+        else if (key == "--jitter")
+            options.faults.jitter = chrono::milliseconds{ stol(value) };
+        else if (key == "--bandwidth")
+            options.faults.bandwidth = stoul(value);
+        else if (key == "--stall")
+            options.faults.stall = stod(value);
+        else if (key == "--reset")
+            options.faults.reset = stod(value);
+        else if (key == "--redirects")
+            options.faults.redirects = stoul(value);
+        else if (key == "--dns-delay")
+            options.dns.delay = chrono::milliseconds{ stol(value) };
+        else if (key == "--dns-jitter")
+            options.dns.jitter = chrono::milliseconds{ stol(value) };
+        else if (key == "--dns-failure")
+            options.dns.failure = stod(value);
+        else if (key == "--seed")
+            options.faults.seed = options.dns.seed = static_cast<unsigned int>( stoul(value) );
+        else if (key == "--out")
+            options.out = value;
+        else
+            throw runtime_error{"Unknown option " + key};
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    try {
+        options = parse(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl
+             << "Usage: bench_tail [--tasks <file>] [--size <bytes>] [--count <files>] [--concurrency <n>] [--per-host <n>]" << endl
+             << "                  [--port <port>] [--latency <ms>] [--jitter <ms>] [--bandwidth <bytes/s>]" << endl
+             << "                  [--stall <p>] [--reset <p>] [--redirects <n>]" << endl
+             << "                  [--dns-delay <ms>] [--dns-jitter <ms>] [--dns-failure <p>] [--seed <n>] [--out <dir>]" << endl;
+        return 1;
+    }
+
+    StubResolver::config() = options.dns;
+    Origin origin{options.size, options.faults, options.port};
+
+    ::mkdir(options.out.c_str(), 0755);
+    ifstream task_file;
+    unique_ptr<TaskList> source;
+    if ( !options.tasks.empty() )
+    {
+        task_file.open(options.tasks);
+        if (!task_file)
+        {
+            cerr << "Can`t open task list <" << options.tasks << ">" << endl;
+            return 1;
+        }
+        source = make_unique<TaskListSimple>(task_file, options.out + "/");
+    } else
+    {
+        source = make_unique<SyntheticTaskList>(origin, options.size, options.count, options.out);
+    }
+    unique_ptr<TaskListScheduler> scheduler;
+    if (options.per_host > 0)
+        scheduler = make_unique<TaskListScheduler>(*source, options.per_host);
+    TaskList& task_list = scheduler ? static_cast<TaskList&>(*scheduler) : *source;
+
+    BenchDashboard dashboard;
+    auto loop = uvw::Loop::getDefault();
+    auto controller = make_shared< aio::bandwidth::ControllerSimple<AIO_UVW> >( loop, size_t{1} << 40, make_unique<aio::bandwidth::Time>() );
+    auto factory_socket = make_shared<aio::FactoryTCPSocketBandwidth>(loop, controller);
+    auto factory = make_shared<BenchFactory>(loop, dashboard, factory_socket);
+
+    std::list<Job> job_list;
+    auto on_tick = make_shared<OnTickSimple>(job_list, factory, task_list, dashboard);
+    factory->set_OnTick(on_tick);
+
+    const auto start = Clock::now();
+    on_tick->start(options.concurrency);
+    loop->run();
+    const auto seconds = chrono::duration<double>( Clock::now() - start ).count();
+
+    if ( options.tasks.empty() )
+        for (size_t i = 0; i < options.count; i++)
+            std::remove( (options.out + "/" + to_string(i)).c_str() );
+
+    vector<double> all = dashboard.done;
+    all.insert( end(all), begin(dashboard.failed), end(dashboard.failed) );
+
+    cout << "{\"benchmark\":\"tail_latency\",\"concurrency\":" << options.concurrency
+         << ",\"seconds\":" << seconds
+         << ",\"origin\":{\"served\":" << origin.served()
+         << ",\"redirected\":" << origin.redirected()
+         << ",\"stalled\":" << origin.stalled()
+         << ",\"reset\":" << origin.reset() << "}"
+         << ",\n \"jobs_ms\":";
+    write_distribution(cout, all);
+    cout << ",\n \"done_ms\":";
+    write_distribution(cout, dashboard.done);
+    cout << ",\n \"failed_ms\":";
+    write_distribution(cout, dashboard.failed);
+    cout << ",\n \"errors\":{";
+    bool first = true;
+    for (const auto& error : dashboard.errors)
+    {
+        cout << (first ? "" : ",") << "\"" << error.first << "\":" << error.second;
+        first = false;
+    }
+    cout << "},\n \"phases_ms\":";
+    write_phases( cout, metrics::registry() );
+    cout << "\n}" << endl;
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include "origin.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdlib>
+#include <sys/socket.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::shared_ptr;
+using ::std::weak_ptr;
+using ::std::make_shared;
+using ::std::make_unique;
+using ::std::runtime_error;
+using ::std::min;
+using ::std::chrono::milliseconds;
+
+namespace {
+
+// Body bytes are written straight from this buffer, uvw does not copy or free them
+const size_t body_chunk = 64 * 1024;
+
+// Pace of writes on a faulty connection, the bandwidth cap is spent in slices of this length
+const milliseconds tick{10};
+
+const char* body_data()
+{
+    static const auto data = []()
+    {
+        auto buffer = new char[body_chunk];
+        for (size_t i = 0; i < body_chunk; i++)
+            buffer[i] = static_cast<char>('a' + i % 26);
+        return buffer;
+    }();
+    return data;
+}
+
+// Number after the slash at pos, npos if there is none
+size_t parse_number(const string& s, size_t pos, size_t& end)
+{
+    end = pos;
+    if ( pos >= s.size() || s[pos] < '0' || s[pos] > '9' )
+        return string::npos;
+    char* stop = nullptr;
+    const auto n = std::strtoull(s.c_str() + pos, &stop, 10);
+    end = static_cast<size_t>(stop - s.c_str());
+    return static_cast<size_t>(n);
+}
+
+string header_value(const string& request, const string& name)
+{
+    const auto begin = request.find("\r\n" + name + ": ");
+    if (begin == string::npos)
+        return string{};
+    const auto value = begin + name.size() + 4;
+    return request.substr( value, request.find("\r\n", value) - value );
+}
+
+} // namespace
+
+struct Origin::Transfer
+{
+    enum class Cut { None, Stall, Reset };
+
+    shared_ptr<uvw::TcpHandle> client;
+    shared_ptr<uvw::TimerHandle> timer;
+    string head;
+    size_t total = 0;    // head and body
+    size_t sent = 0;
+    size_t cut_at = 0;   // offset of a stall or a reset
+    Cut cut = Cut::None;
+    size_t pending = 0;  // writes in flight
+    bool redirect = false;
+    bool done = false;
+};
+
+Origin::Origin(size_t default_size_)
+    : Origin{default_size_, Faults{}}
+{}
+
+Origin::Origin(size_t default_size_, Faults faults_, unsigned int port)
+    : default_size{default_size_},
+      faults{faults_},
+      random{faults_.seed},
+      loop{ uvw::Loop::create() }
+{
+    body_data();
+
+    listener = loop->resource<uvw::TcpHandle>();
+    stop_signal = loop->resource<uvw::AsyncHandle>();
+    if (!listener || !stop_signal)
+        throw runtime_error{"Origin: can`t create handles"};
+
+    bool failed = false;
+    listener->once<uvw::ErrorEvent>( [&failed](const auto&, auto&) { failed = true; } );
+    listener->bind("127.0.0.1", port);
+    listener->listen();
+    listener->clear<uvw::ErrorEvent>();
+    if (failed)
+        throw runtime_error{"Origin: can`t listen on 127.0.0.1:" + to_string(port)};
+    m_port = listener->sock().port;
+
+    listener->on<uvw::ListenEvent>( [this](const auto&, auto&) { on_connection(); } );
+    stop_signal->once<uvw::AsyncEvent>( [](const auto&, auto& handle)
+    {
+        handle.loop().walk( [](auto& h) { h.close(); } );
+    } );
+
+    thread = std::thread{ [loop = loop]() { loop->run(); } };
+}
+
+Origin::~Origin()
+{
+    stop_signal->send();
+    thread.join();
+}
+
+string Origin::uri(size_t size, const string& host) const
+{
+    return "http://" + host + ":" + to_string(m_port) + "/" + to_string(size);
+}
+
+void Origin::on_connection()
+{
+    auto client = loop->resource<uvw::TcpHandle>();
+    listener->accept(*client);
+
+    auto request = make_shared<string>();
+    weak_ptr<uvw::TcpHandle> weak = client;
+    client->once<uvw::ErrorEvent>( [](const auto&, auto& handle) { handle.close(); } );
+    client->once<uvw::EndEvent>( [](const auto&, auto& handle) { handle.close(); } );
+    client->on<uvw::DataEvent>( [this, request, weak](const auto& event, auto&)
+    {
+        auto client = weak.lock();
+        if (!client)
+            return;
+        request->append(event.data.get(), event.length);
+        if (request->find("\r\n\r\n") != string::npos)
+        {
+            client->clear<uvw::DataEvent>();
+            client->stop();
+            respond( std::move(client), *request );
+        }
+    } );
+    client->read();
+}
+
+void Origin::respond(shared_ptr<uvw::TcpHandle> client, const string& request)
+{
+    size_t size = default_size;
+    size_t hops = faults.redirects;
+    const auto path = request.find(" /");
+    if (path != string::npos && request.compare(0, 4, "GET ") == 0)
+    {
+        size_t end = 0;
+        const auto n = parse_number(request, path + 2, end);
+        if (n != string::npos)
+        {
+            size = n;
+            if (end < request.size() && request[end] == '/')
+                hops = parse_number(request, end + 1, end);
+            if (hops == string::npos)
+                hops = faults.redirects;
+        }
+    }
+
+    const bool redirect = hops > 0;
+    string head;
+    if (redirect)
+    {
+        auto host = header_value(request, "Host");
+        if ( host.empty() )
+            host = "127.0.0.1";
+        head = "HTTP/1.1 302 Found\r\n"
+               "Location: http://" + host + ":" + to_string(m_port) + "/" + to_string(size) + "/" + to_string(hops - 1) + "\r\n"
+               "Content-Length: 0\r\n"
+               "Connection: close\r\n"
+               "\r\n";
+        m_redirected.fetch_add(1, std::memory_order_relaxed);
+        size = 0;
+    } else
+    {
+        head = "HTTP/1.1 200 OK\r\n"
+               "Content-Type: application/octet-stream\r\n"
+               "Content-Length: " + to_string(size) + "\r\n"
+               "Connection: close\r\n"
+               "\r\n";
+    }
+
+    if ( faults.any() )
+        respond_faulty( std::move(client), std::move(head), size, redirect );
+    else
+        respond_fast( std::move(client), head, size, redirect );
+}
+
+void Origin::respond_fast(shared_ptr<uvw::TcpHandle> client, const string& head, size_t size, bool redirect)
+{
+    auto head_data = make_unique<char[]>( head.size() );
+    std::copy( head.begin(), head.end(), head_data.get() );
+
+    auto pending = make_shared<size_t>( 1 + (size + body_chunk - 1) / body_chunk );
+    client->on<uvw::WriteEvent>( [this, pending, redirect](const auto&, auto& handle)
+    {
+        if (--*pending == 0)
+        {
+            if (!redirect)
+                m_served.fetch_add(1, std::memory_order_relaxed);
+            handle.close();
+        }
+    } );
+
+    client->write( std::move(head_data), static_cast<unsigned int>( head.size() ) );
+    for (size_t offset = 0; offset < size; offset += body_chunk)
+    {
+        const auto length = min(body_chunk, size - offset);
+        client->write( const_cast<char*>( body_data() ), static_cast<unsigned int>(length) );
+    }
+}
+
+void Origin::respond_faulty(shared_ptr<uvw::TcpHandle> client, string head, size_t size, bool redirect)
+{
+    using Cut = Transfer::Cut;
+
+    auto t = make_shared<Transfer>();
+    t->client = std::move(client);
+    t->timer = loop->resource<uvw::TimerHandle>();
+    if (!t->timer)
+    {
+        t->client->close();
+        return;
+    }
+    t->total = head.size() + size;
+    t->cut_at = t->total;
+    t->redirect = redirect;
+
+    if (size > 0)
+    {
+        const double roll = std::uniform_real_distribution<double>{0, 1}(random);
+        if (roll < faults.reset)
+            t->cut = Cut::Reset;
+        else if (roll < faults.reset + faults.stall)
+            t->cut = Cut::Stall;
+        if (t->cut != Cut::None)
+            t->cut_at = head.size() + std::uniform_int_distribution<size_t>{0, size - 1}(random);
+    }
+    t->head = std::move(head);
+
+    auto delay = faults.latency;
+    if (faults.jitter.count() > 0)
+        delay += milliseconds{ std::uniform_int_distribution<milliseconds::rep>{0, faults.jitter.count()}(random) };
+
+    t->client->on<uvw::WriteEvent>( [this, t](const auto&, auto& handle)
+    {
+        if (--t->pending == 0 && t->done)
+        {
+            if (!t->redirect)
+                m_served.fetch_add(1, std::memory_order_relaxed);
+            handle.close();
+        }
+    } );
+    // Handlers hold the transfer, dropping them on close breaks the cycle
+    t->client->once<uvw::CloseEvent>( [t](const auto&, auto&)
+    {
+        t->timer->clear();
+        if ( !t->timer->closing() )
+            t->timer->close();
+        t->client->clear();
+    } );
+    // Keep reading to notice the peer giving up on a stalled connection
+    t->client->read();
+
+    t->timer->on<uvw::TimerEvent>( [this, t](const auto&, auto&) { pump(t); } );
+    t->timer->start(delay, tick);
+}
+
+void Origin::pump(const shared_ptr<Transfer>& t)
+{
+    using Cut = Transfer::Cut;
+
+    if ( t->client->closing() )
+        return;
+
+    const auto limit = min(t->total, t->cut_at);
+    auto quota = (faults.bandwidth > 0) ? std::max<size_t>( faults.bandwidth * static_cast<size_t>( tick.count() ) / 1000, 1 )
+                                        : std::numeric_limits<size_t>::max();
+    while (quota > 0 && t->sent < limit)
+    {
+        size_t length;
+        if (t->sent < t->head.size())
+        {
+            length = min( {quota, t->head.size() - t->sent, limit - t->sent} );
+            auto data = make_unique<char[]>(length);
+            std::copy_n( t->head.data() + t->sent, length, data.get() );
+            t->client->write( std::move(data), static_cast<unsigned int>(length) );
+        } else
+        {
+            length = min( {quota, body_chunk, limit - t->sent} );
+            t->client->write( const_cast<char*>( body_data() ), static_cast<unsigned int>(length) );
+        }
+        t->sent += length;
+        quota -= length;
+        t->pending++;
+    }
+
+    if (t->sent == t->total)
+    {
+        t->done = true;
+        t->timer->stop();
+    } else if (t->sent == t->cut_at)
+    {
+        t->timer->stop();
+        if (t->cut == Cut::Reset)
+        {
+            // Zero linger turns close() into a RST
+            linger option{1, 0};
+            ::setsockopt( t->client->fileno(), SOL_SOCKET, SO_LINGER, &option, sizeof(option) );
+            m_reset.fetch_add(1, std::memory_order_relaxed);
+            t->client->close();
+        } else
+        {
+            m_stalled.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <uvw/loop.hpp>
+#include <uvw/tcp.hpp>
+#include <uvw/timer.hpp>
+#include <uvw/async.hpp>
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+/* Loopback HTTP origin for benchmarks, runs its own uvw loop on a separate thread.
+ * "GET /<n>" is answered with a synthetic body of n bytes, any other path with
+ * the default body size. Each response carries Content-Length, the connection is closed after it.
+ * Faults (latency, bandwidth cap, stalls, resets, redirect chains) are injected per connection. */
+class Origin
+{
+public:
+    struct Faults
+    {
+        std::chrono::milliseconds latency{0}; // before the response head
+        std::chrono::milliseconds jitter{0};  // uniform extra latency, 0..jitter
+        std::size_t bandwidth = 0;            // bytes per second per connection (head included), 0 - unlimited
+        double stall = 0;                     // probability the body stops midway, the connection is left open
+        double reset = 0;                     // probability the connection is reset (RST) midway through the body
+        std::size_t redirects = 0;            // 302 hops in front of each file, "/<n>/<hops left>"
+        unsigned int seed = 1;
+
+        bool any() const noexcept
+        {
+            return latency.count() > 0 || jitter.count() > 0 || bandwidth > 0 || stall > 0 || reset > 0;
+        }
+    };
+
+    explicit Origin(std::size_t default_size_);
+    Origin(std::size_t default_size_, Faults faults_, unsigned int port = 0);
+
+    unsigned int port() const noexcept { return m_port; }
+    std::string uri(std::size_t size, const std::string& host = "127.0.0.1") const;
+    std::size_t served() const noexcept { return m_served.load(std::memory_order_relaxed); }
+    std::size_t redirected() const noexcept { return m_redirected.load(std::memory_order_relaxed); }
+    std::size_t stalled() const noexcept { return m_stalled.load(std::memory_order_relaxed); }
+    std::size_t reset() const noexcept { return m_reset.load(std::memory_order_relaxed); }
+
+    Origin() = delete;
+    Origin(const Origin&) = delete;
+    Origin(Origin&&) = delete;
+    Origin& operator= (const Origin&) = delete;
+    Origin& operator= (Origin&&) = delete;
+
+    ~Origin();
+
+private:
+    struct Transfer;
+
+    const std::size_t default_size;
+    const Faults faults;
+    std::mt19937 random;
+    std::shared_ptr<uvw::Loop> loop;
+    std::shared_ptr<uvw::TcpHandle> listener;
+    std::shared_ptr<uvw::AsyncHandle> stop_signal;
+    std::thread thread;
+    unsigned int m_port = 0;
+    std::atomic<std::size_t> m_served{0};
+    std::atomic<std::size_t> m_redirected{0};
+    std::atomic<std::size_t> m_stalled{0};
+    std::atomic<std::size_t> m_reset{0};
+
+    void on_connection();
+    void respond(std::shared_ptr<uvw::TcpHandle>, const std::string& request);
+    void respond_fast(std::shared_ptr<uvw::TcpHandle>, const std::string& head, std::size_t size, bool redirect);
+    void respond_faulty(std::shared_ptr<uvw::TcpHandle>, std::string head, std::size_t size, bool redirect);
+    void pump(const std::shared_ptr<Transfer>&);
+};
@@ -0,0 +1,419 @@
+#include "sim.h"
+#include "stub_resolver.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::shared_ptr;
+using ::std::make_shared;
+using ::std::unique_ptr;
+using ::std::function;
+using ::std::vector;
+using ::std::move;
+using ::std::max;
+using ::std::min;
+using ::std::chrono::duration_cast;
+using ::std::chrono::milliseconds;
+using ::std::chrono::seconds;
+
+using namespace sim;
+
+namespace {
+
+Duration transfer_time(size_t length, size_t rate)
+{
+    if (rate == 0)
+        return Duration{0};
+    return Duration{ static_cast<Duration::rep>( length * 1000000 / rate ) };
+}
+
+} // namespace
+
+
+/* Network */
+
+Network::Network(Config config_)
+    : m_config{ move(config_) },
+      engine{m_config.seed}
+{
+    std::uniform_int_distribution<Duration::rep> rtt{ m_config.rtt_min.count(), max(m_config.rtt_min, m_config.rtt_max).count() };
+    // Log-uniform, link speeds span orders of magnitude
+    std::uniform_real_distribution<double> bandwidth{ std::log( static_cast<double>(m_config.bandwidth_min) ),
+                                                      std::log( static_cast<double>( max(m_config.bandwidth_min, m_config.bandwidth_max) ) ) };
+    for (size_t i = 0; i < m_config.hosts; i++)
+    {
+        Host host;
+        host.name = "h" + to_string(i) + ".sim";
+        host.ip = "10." + to_string( (i >> 16) & 0xFF ) + "." + to_string( (i >> 8) & 0xFF ) + "." + to_string(i & 0xFF);
+        host.rtt = Duration{ rtt(engine) };
+        host.bandwidth = static_cast<size_t>( std::exp( bandwidth(engine) ) );
+        by_name.emplace(host.name, i);
+        by_ip.emplace(host.ip, i);
+        m_hosts.push_back( move(host) );
+    }
+}
+
+Host* Network::host_by_name(const string& name)
+{
+    auto it = by_name.find(name);
+    return (it != by_name.end()) ? &m_hosts[it->second] : nullptr;
+}
+
+Host* Network::host_by_ip(const string& ip)
+{
+    auto it = by_ip.find(ip);
+    return (it != by_ip.end()) ? &m_hosts[it->second] : nullptr;
+}
+
+void Network::send(Loop& loop, Flow& flow, size_t length)
+{
+    advance( loop.now() );
+    flow.left = static_cast<double>(length);
+    if (!flow.sending)
+    {
+        flow.sending = true;
+        flow.host->sending++;
+        flows.push_back(&flow);
+    }
+    reschedule(loop);
+}
+
+void Network::cancel(Loop& loop, Flow& flow)
+{
+    if (!flow.sending)
+        return;
+    advance( loop.now() );
+    flow.sending = false;
+    flow.host->sending--;
+    flows.erase( std::find( flows.begin(), flows.end(), &flow ) );
+    reschedule(loop);
+}
+
+void Network::advance(Duration now)
+{
+    const double elapsed = std::chrono::duration<double>(now - updated).count();
+    updated = now;
+    if (elapsed <= 0)
+        return;
+    for (auto flow : flows)
+        flow->left -= flow->rate * elapsed;
+}
+
+void Network::reschedule(Loop& loop)
+{
+    if ( completing || flows.empty() )
+        return;
+
+    double next = std::numeric_limits<double>::max();
+    const double access_share = (m_config.access > 0) ? static_cast<double>(m_config.access) / static_cast<double>( flows.size() ) : 0;
+    for (auto flow : flows)
+    {
+        flow->rate = static_cast<double>(flow->host->bandwidth) / static_cast<double>(flow->host->sending);
+        if (access_share > 0)
+            flow->rate = std::min(flow->rate, access_share);
+        next = std::min( next, std::max(flow->left, 0.0) / flow->rate );
+    }
+
+    // Rounded up, the segment is out by then. An earlier pending event is kept,
+    // it finds nothing finished and reschedules.
+    const auto at = loop.now() + Duration{ static_cast<Duration::rep>( std::ceil(next * 1e6) ) };
+    if (pending && deadline <= at)
+        return;
+    pending = true;
+    deadline = at;
+    loop.schedule( at - loop.now(), [this, &loop, at]()
+    {
+        if (!pending || deadline != at)
+            return;
+        pending = false;
+        complete(loop);
+    } );
+}
+
+void Network::complete(Loop& loop)
+{
+    advance( loop.now() );
+
+    // Fractions of a byte are rounding of the microsecond clock
+    vector<Flow*> done;
+    for (auto flow : flows)
+        if (flow->left < 1)
+            done.push_back(flow);
+    for (auto flow : done)
+    {
+        flow->sending = false;
+        flow->host->sending--;
+        flows.erase( std::find( flows.begin(), flows.end(), flow ) );
+    }
+
+    completing = true;
+    for (auto flow : done)
+        flow->segment_sent();
+    completing = false;
+    reschedule(loop);
+}
+
+Duration Network::disk_write(size_t length, Duration now)
+{
+    const auto done = max(now, disk_free) + transfer_time(length, m_config.disk);
+    disk_free = done;
+
+    const auto second = static_cast<size_t>( duration_cast<seconds>(done).count() );
+    if (m_written.size() <= second)
+        m_written.resize(second + 1, 0);
+    m_written[second] += length;
+    return done;
+}
+
+
+/* Loop */
+
+void Loop::schedule(Duration delay, function<void()> fn)
+{
+    queue.push( Event{m_now + delay, seq++, move(fn)} );
+}
+
+size_t Loop::run()
+{
+    size_t processed = 0;
+    while ( !queue.empty() )
+    {
+        auto& top = const_cast<Event&>( queue.top() );
+        m_now = top.time;
+        auto fn = move(top.fn);
+        queue.pop();
+        fn();
+        processed++;
+    }
+    return processed;
+}
+
+
+/* Timer */
+
+void Timer::start(Time timeout, Time repeat)
+{
+    interval = repeat;
+    arm(timeout, ++generation);
+}
+
+void Timer::arm(Time timeout, std::uint64_t armed)
+{
+    loop->schedule( duration_cast<Duration>(timeout), [self = shared_from_this(), armed]()
+    {
+        if (self->generation != armed)
+            return;
+        if (self->interval.count() > 0)
+            self->arm(self->interval, armed);
+        self->publish( ::uvw::TimerEvent{} );
+    } );
+}
+
+
+/* Resolver */
+
+void Resolver::nodeAddrInfo(string node)
+{
+    loop->schedule( loop->network().config().dns, [self = shared_from_this(), node = move(node)]()
+    {
+        if (self->cancelled)
+            return;
+        auto host = self->loop->network().host_by_name(node);
+        if (host)
+            self->publish( ::uvw::AddrInfoEvent{ make_addrinfo(host->ip) } );
+        else
+            self->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EAI_NONAME) } );
+    } );
+}
+
+
+/* File */
+
+template< typename Event, typename... Args >
+void File::complete(Duration at, Args... args)
+{
+    loop->schedule( at - loop->now(), [self = shared_from_this(), armed = generation, args...]()
+    {
+        if (self->generation == armed)
+            self->publish( Event{ self->path.c_str(), args... } );
+    } );
+}
+
+void File::open(string path_, int, int)
+{
+    path = move(path_);
+    complete< ::uvw::FsEvent<::uvw::FileReq::Type::OPEN> >( loop->now() );
+}
+
+void File::write(const char*, size_t length, std::int64_t)
+{
+    complete< ::uvw::FsEvent<::uvw::FileReq::Type::WRITE> >( loop->network().disk_write(length, loop->now()), length );
+}
+
+void File::close()
+{
+    complete< ::uvw::FsEvent<::uvw::FileReq::Type::CLOSE> >( loop->now() );
+}
+
+
+/* Work */
+
+void Work::queue()
+{
+    loop->schedule( Duration{0}, [self = shared_from_this()]()
+    {
+        if (self->cancelled)
+            return;
+        self->task();
+        self->publish( ::uvw::WorkEvent{} );
+    } );
+}
+
+
+/* Socket */
+
+template< typename Event >
+void Socket::later(Duration delay, Event event)
+{
+    loop->schedule( delay, [self = shared_from_this(), event = move(event)]() mutable
+    {
+        if (!self->closed)
+            self->publish( move(event) );
+    } );
+}
+
+void Socket::connect(const string& ip, unsigned short)
+{
+    auto& network = loop->network();
+    host = network.host_by_ip(ip);
+    if (!host)
+        return later( Duration{0}, ::uvw::ErrorEvent{ static_cast<int>(UV_EHOSTUNREACH) } );
+
+    const bool refused = std::uniform_real_distribution<double>{0, 1}( network.random() ) < network.config().connect_failure;
+    if (refused)
+        later( host->rtt, ::uvw::ErrorEvent{ static_cast<int>(UV_ECONNREFUSED) } );
+    else
+        later( host->rtt, ::uvw::ConnectEvent{} );
+}
+
+void Socket::connect6(const string&, unsigned short)
+{
+    later( Duration{0}, ::uvw::ErrorEvent{ static_cast<int>(UV_EAFNOSUPPORT) } );
+}
+
+void Socket::write(unique_ptr<char[]> data, size_t length)
+{
+    const string request{ data.get(), length };
+    size_t size = 0;
+    const auto path = request.find(" /");
+    if (path != string::npos)
+        size = static_cast<size_t>( std::strtoull(request.c_str() + path + 2, nullptr, 10) );
+
+    head = "HTTP/1.1 200 OK\r\n"
+           "Content-Length: " + to_string(size) + "\r\n"
+           "\r\n";
+    total = head.size() + size;
+
+    later( host->rtt / 2, ::uvw::WriteEvent{} );
+    // The host answers once the request has reached it
+    loop->schedule( host->rtt / 2, [self = shared_from_this()]() { self->send(); } );
+}
+
+void Socket::read()
+{
+    reading = true;
+    loop->schedule( Duration{0}, [self = shared_from_this()]() { self->deliver(); } );
+}
+
+void Socket::shutdown()
+{
+    later( Duration{0}, ::uvw::ShutdownEvent{} );
+}
+
+void Socket::close() noexcept
+{
+    if (closed)
+        return;
+    closed = true;
+    reading = false;
+    loop->network().cancel(*loop, *this);
+    segment = 0;
+    loop->schedule( Duration{0}, [self = shared_from_this()]() { self->publish( ::uvw::CloseEvent{} ); } );
+}
+
+Socket::~Socket()
+{
+    loop->network().cancel(*loop, *this);
+}
+
+// Keeps the window full: segments in transit and segments received but not read yet
+void Socket::send()
+{
+    const auto& config = loop->network().config();
+    if (closed || segment > 0 || sent == total || in_transit + arrived.size() >= config.window)
+        return;
+    segment = min(config.segment, total - sent);
+    loop->network().send(*loop, *this, segment);
+}
+
+void Socket::segment_sent()
+{
+    const auto length = segment;
+    sent += length;
+    segment = 0;
+    in_transit++;
+    loop->schedule( host->rtt / 2, [self = shared_from_this(), length]()
+    {
+        self->in_transit--;
+        self->arrived.push(length);
+        self->deliver();
+    } );
+    send();
+}
+
+void Socket::deliver()
+{
+    while ( reading && !closed && !arrived.empty() )
+    {
+        const auto length = arrived.front();
+        arrived.pop();
+
+        unique_ptr<char[]> data{ new char[length] };
+        if (delivered < head.size())
+        {
+            const auto n = min(length, head.size() - delivered);
+            std::memcpy( data.get(), head.data() + delivered, n );
+            std::memset( data.get() + n, 'x', length - n );
+        }
+        delivered += length;
+        publish( ::uvw::DataEvent{ move(data), length } );
+    }
+    send();
+}
+
+
+/* FactorySocket */
+
+shared_ptr<aio::TCPSocket> FactorySocket::tcp()
+{
+    auto socket = make_shared<Socket>(loop);
+    if (!controller)
+        return socket;
+    return aio::TCPSocketBandwidth::create(nullptr, controller, socket);
+}
+
+
+/* Time */
+
+milliseconds Time::elapsed() noexcept
+{
+    const auto diff = duration_cast<milliseconds>( loop->now() - last );
+    last += duration_cast<sim::Duration>(diff);
+    return diff;
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "aio_uvw.h"
+#include "aio/tcp.h"
+#include "aio/bandwidth.h"
+#include "aio/factory_tcp.h"
+
+#include <uvw/emitter.hpp>
+#include <uvw/dns.hpp>
+#include <uvw/timer.hpp>
+#include <uvw/stream.hpp>
+#include <uvw/fs.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Discrete-event simulation of the loop, resolver, timers, files and TCP links.
+ * Types have the shape of the test mocks (test/mock/uvw, test/mock/aio) but are driven by
+ * a virtual clock instead of expectations, so OnTickSimple, ControllerSimple and DownloaderSimple
+ * run unchanged on top of them (AIO_Sim). Events at equal time fire in scheduling order,
+ * a run is reproducible for a given seed. */
+
+namespace sim {
+
+using Duration = std::chrono::microseconds;
+
+class Loop;
+
+struct Host
+{
+    std::string name;
+    std::string ip;
+    Duration rtt;
+    std::size_t bandwidth;       // bytes per second, shared by all connections to the host
+    std::size_t sending = 0;     // connections sending at the moment
+};
+
+/* A sender on the network, gets a share of its host link and of the access link */
+class Flow
+{
+public:
+    virtual ~Flow() = default;
+
+protected:
+    Host* host = nullptr;
+
+private:
+    friend class Network;
+    double left = 0;             // bytes of the current segment
+    double rate = 0;             // bytes per second
+    bool sending = false;
+
+    virtual void segment_sent() = 0;
+};
+
+/* Hosts, the client access link and the disk. Links are shared equally between the flows
+ * sending over them (processor sharing): rates are recomputed whenever a flow starts or
+ * finishes a segment, and an event is kept scheduled for the earliest segment end. */
+class Network
+{
+public:
+    struct Config
+    {
+        std::size_t hosts = 16;
+        Duration rtt_min{10000};
+        Duration rtt_max{200000};
+        std::size_t bandwidth_min = 128 * 1024;
+        std::size_t bandwidth_max = 8 * 1024 * 1024;
+        std::size_t access = 0;       // client downlink, bytes per second, 0 - unlimited
+        std::size_t disk = 0;         // disk write rate, bytes per second, 0 - unlimited
+        double connect_failure = 0;   // probability a connect is refused
+        Duration dns{2000};
+        std::size_t segment = 16 * 1024;
+        std::size_t window = 8;       // segments sent but not read yet, per connection
+        unsigned int seed = 1;
+    };
+
+    explicit Network(Config config_);
+
+    const Config& config() const noexcept { return m_config; }
+    std::mt19937& random() noexcept { return engine; }
+
+    Host* host_by_name(const std::string&);
+    Host* host_by_ip(const std::string&);
+    const std::vector<Host>& hosts() const noexcept { return m_hosts; }
+
+    // Starts sending a segment of length bytes, Flow::segment_sent() is called once it is out
+    void send(Loop&, Flow&, std::size_t length);
+    void cancel(Loop&, Flow&);
+    // Completion time of a disk write issued now
+    Duration disk_write(std::size_t length, Duration now);
+
+    // Bytes written to disk per second of virtual time
+    const std::vector<std::size_t>& written() const noexcept { return m_written; }
+
+    Network(const Network&) = delete;
+    Network& operator= (const Network&) = delete;
+
+private:
+    const Config m_config;
+    std::mt19937 engine;
+    std::vector<Host> m_hosts;
+    std::unordered_map<std::string, std::size_t> by_name;
+    std::unordered_map<std::string, std::size_t> by_ip;
+
+    std::vector<Flow*> flows;
+    Duration updated{0};
+    Duration deadline{0};        // of the pending completion event
+    bool pending = false;
+    bool completing = false;
+
+    Duration disk_free{0};
+    std::vector<std::size_t> m_written;
+
+    void advance(Duration now);
+    void reschedule(Loop&);
+    void complete(Loop&);
+};
+
+class Loop : public std::enable_shared_from_this<Loop>
+{
+public:
+    explicit Loop(Network& network_) noexcept
+        : m_network(network_)
+    {}
+
+    Duration now() const noexcept { return m_now; }
+    Network& network() noexcept { return m_network; }
+
+    void schedule(Duration delay, std::function<void()>);
+    // Runs until no event is left, returns the count of processed events
+    std::size_t run();
+
+    template< typename R, typename... Args >
+    std::shared_ptr<R> resource(Args&&... args) { return R::create( this->shared_from_this(), std::forward<Args>(args)... ); }
+
+    Loop(const Loop&) = delete;
+    Loop& operator= (const Loop&) = delete;
+
+private:
+    struct Event
+    {
+        Duration time;
+        std::uint64_t seq;
+        std::function<void()> fn;
+    };
+    struct Later
+    {
+        bool operator() (const Event& a, const Event& b) const noexcept
+        {
+            return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+        }
+    };
+
+    Network& m_network;
+    Duration m_now{0};
+    std::uint64_t seq = 0;
+    std::priority_queue<Event, std::vector<Event>, Later> queue;
+};
+
+class Timer final : public ::uvw::Emitter<Timer>, public std::enable_shared_from_this<Timer>
+{
+public:
+    using Time = ::uvw::TimerHandle::Time;
+
+    explicit Timer(std::shared_ptr<Loop> loop_) noexcept
+        : loop{ std::move(loop_) }
+    {}
+    static std::shared_ptr<Timer> create(std::shared_ptr<Loop> loop) { return std::make_shared<Timer>( std::move(loop) ); }
+
+    void start(Time timeout, Time repeat);
+    void stop() noexcept { generation++; }
+    void close() noexcept { stop(); }
+
+private:
+    std::shared_ptr<Loop> loop;
+    std::uint64_t generation = 0;
+    Time interval{0};
+
+    void arm(Time, std::uint64_t);
+};
+
+class Resolver final : public ::uvw::Emitter<Resolver>, public std::enable_shared_from_this<Resolver>
+{
+public:
+    explicit Resolver(std::shared_ptr<Loop> loop_) noexcept
+        : loop{ std::move(loop_) }
+    {}
+    static std::shared_ptr<Resolver> create(std::shared_ptr<Loop> loop) { return std::make_shared<Resolver>( std::move(loop) ); }
+
+    void nodeAddrInfo(std::string node);
+    bool cancel() noexcept { cancelled = true; return true; }
+
+private:
+    std::shared_ptr<Loop> loop;
+    bool cancelled = false;
+};
+
+/* Writes go nowhere, they only take the disk time */
+class File final : public ::uvw::Emitter<File>, public std::enable_shared_from_this<File>
+{
+public:
+    explicit File(std::shared_ptr<Loop> loop_) noexcept
+        : loop{ std::move(loop_) }
+    {}
+    static std::shared_ptr<File> create(std::shared_ptr<Loop> loop) { return std::make_shared<File>( std::move(loop) ); }
+
+    void open(std::string path, int, int);
+    void write(const char*, std::size_t, std::int64_t);
+    void close();
+    bool cancel() noexcept { generation++; return true; }
+
+private:
+    std::shared_ptr<Loop> loop;
+    std::string path;
+    std::uint64_t generation = 0;
+
+    template< typename Event, typename... Args >
+    void complete(Duration at, Args... args);
+};
+
+class FsReq final : public ::uvw::Emitter<FsReq>
+{
+public:
+    static std::shared_ptr<FsReq> create(std::shared_ptr<Loop>) { return std::make_shared<FsReq>(); }
+    void unlink(std::string) noexcept {}
+};
+
+/* CPU time is not modeled, the task runs on the loop at the current time */
+class Work final : public ::uvw::Emitter<Work>, public std::enable_shared_from_this<Work>
+{
+public:
+    Work(std::shared_ptr<Loop> loop_, std::function<void()> task_) noexcept
+        : loop{ std::move(loop_) },
+          task{ std::move(task_) }
+    {}
+    static std::shared_ptr<Work> create(std::shared_ptr<Loop> loop, std::function<void()> task) { return std::make_shared<Work>( std::move(loop), std::move(task) ); }
+
+    void queue();
+    bool cancel() noexcept { cancelled = true; return true; }
+
+private:
+    std::shared_ptr<Loop> loop;
+    std::function<void()> task;
+    bool cancelled = false;
+};
+
+/* Client side of a connection to a modeled host. The request names the body size ("GET /<n>"),
+ * the host answers with a Content-Length response after one RTT and keeps the connection open. */
+class Socket final : public aio::TCPSocket, public Flow, public std::enable_shared_from_this<Socket>
+{
+public:
+    explicit Socket(std::shared_ptr<Loop> loop_) noexcept
+        : loop{ std::move(loop_) }
+    {}
+    virtual ~Socket();
+
+    virtual void connect(const std::string& ip, unsigned short port) override;
+    virtual void connect6(const std::string& ip, unsigned short port) override;
+    virtual void read() override;
+    virtual void stop() noexcept override { reading = false; }
+    virtual void write(std::unique_ptr<char[]>, std::size_t) override;
+    virtual void shutdown() override;
+    virtual bool active() const noexcept override { return reading; }
+    virtual void close() noexcept override;
+
+private:
+    std::shared_ptr<Loop> loop;
+    bool reading = false;
+    bool closed = false;
+
+    std::string head;
+    std::size_t total = 0;      // response bytes, head included
+    std::size_t sent = 0;
+    std::size_t segment = 0;    // being sent, 0 - none
+    std::size_t in_transit = 0; // segments sent, not arrived yet
+    std::size_t delivered = 0;
+    std::queue<std::size_t> arrived;
+
+    template< typename Event >
+    void later(Duration, Event);
+    void send();
+    virtual void segment_sent() override;
+    void deliver();
+};
+
+class FactorySocket final : public aio::FactoryTCPSocket
+{
+public:
+    FactorySocket(std::shared_ptr<Loop> loop_, std::shared_ptr<aio::bandwidth::Controller> controller_ = nullptr)
+        : aio::FactoryTCPSocket{nullptr},
+          loop{ std::move(loop_) },
+          controller{ std::move(controller_) }
+    {}
+
+    virtual std::shared_ptr<aio::TCPSocket> tcp() override;
+    virtual std::shared_ptr<aio::TCPSocket> tcp_tls() override { return tcp(); }
+
+private:
+    std::shared_ptr<Loop> loop;
+    std::shared_ptr<aio::bandwidth::Controller> controller;
+};
+
+/* bandwidth::Time on the virtual clock, sub-millisecond remainders carry over */
+class Time final : public aio::bandwidth::Time
+{
+public:
+    explicit Time(std::shared_ptr<Loop> loop_)
+        : loop{ std::move(loop_) },
+          last{ loop->now() }
+    {}
+
+    virtual std::chrono::milliseconds elapsed() noexcept override;
+
+private:
+    std::shared_ptr<Loop> loop;
+    sim::Duration last;
+};
+
+} // namespace sim
+
+struct AIO_Sim : public AIO_UVW
+{
+    using Loop = sim::Loop;
+    using GetAddrInfoReq = sim::Resolver;
+    using TimerHandle = sim::Timer;
+    using FileReq = sim::File;
+    using FsReq = sim::FsReq;
+    using WorkReq = sim::Work;
+};
@@ -0,0 +1,90 @@
+#include "stub_resolver.h"
+
+#include <random>
+
+using ::std::string;
+using ::std::shared_ptr;
+using ::std::make_shared;
+using ::std::unique_ptr;
+using ::std::chrono::milliseconds;
+
+namespace {
+
+// addrinfo and its address in one allocation, released by the AddrInfoEvent deleter
+struct Resolved
+{
+    addrinfo info;
+    sockaddr_in address;
+};
+
+void free_resolved(addrinfo* info)
+{
+    delete reinterpret_cast<Resolved*>(info);
+}
+
+std::mt19937& random_engine()
+{
+    static std::mt19937 engine{ StubResolver::config().seed };
+    return engine;
+}
+
+} // namespace
+
+unique_ptr<addrinfo, ::uvw::AddrInfoEvent::Deleter> make_addrinfo(const string& ip)
+{
+    auto resolved = new Resolved{};
+    uv_ip4_addr(ip.c_str(), 0, &resolved->address);
+    resolved->info.ai_family = AF_INET;
+    resolved->info.ai_socktype = SOCK_STREAM;
+    resolved->info.ai_addrlen = sizeof(sockaddr_in);
+    resolved->info.ai_addr = reinterpret_cast<sockaddr*>(&resolved->address);
+    return unique_ptr<addrinfo, ::uvw::AddrInfoEvent::Deleter>{ &resolved->info, &free_resolved };
+}
+
+StubResolver::Config& StubResolver::config()
+{
+    static Config instance;
+    return instance;
+}
+
+shared_ptr<StubResolver> StubResolver::create(shared_ptr<::uvw::Loop> loop)
+{
+    auto timer = loop->resource<::uvw::TimerHandle>();
+    if (!timer)
+        return nullptr;
+    return make_shared<StubResolver>( std::move(timer) );
+}
+
+void StubResolver::nodeAddrInfo(string)
+{
+    const auto& c = config();
+    auto delay = c.delay;
+    if (c.jitter.count() > 0)
+        delay += milliseconds{ std::uniform_int_distribution<milliseconds::rep>{0, c.jitter.count()}(random_engine()) };
+    const bool fail = std::uniform_real_distribution<double>{0, 1}(random_engine()) < c.failure;
+
+    timer->once<::uvw::TimerEvent>( [self = shared_from_this(), fail](const auto&, auto&)
+    {
+        self->release();
+        if (fail)
+            self->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EAI_AGAIN) } );
+        else
+            self->publish( ::uvw::AddrInfoEvent{ make_addrinfo("127.0.0.1") } );
+    } );
+    timer->start(delay, milliseconds{0});
+}
+
+bool StubResolver::cancel()
+{
+    release();
+    return true;
+}
+
+void StubResolver::release()
+{
+    if (!timer)
+        return;
+    timer->clear();
+    timer->close();
+    timer.reset();
+}
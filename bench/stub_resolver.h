@@ -0,0 +1,56 @@
+#pragma once
+
+#include "aio_uvw.h"
+
+#include <uvw/emitter.hpp>
+#include <uvw/dns.hpp>
+#include <uvw/timer.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+/* Drop-in for uvw::GetAddrInfoReq: every name resolves to 127.0.0.1 after an injected delay,
+ * or fails with EAI_AGAIN. Made by Loop::resource<StubResolver>() as the real request is,
+ * so settings are process-wide. */
+class StubResolver final : public ::uvw::Emitter<StubResolver>, public std::enable_shared_from_this<StubResolver>
+{
+public:
+    struct Config
+    {
+        std::chrono::milliseconds delay{0};
+        std::chrono::milliseconds jitter{0}; // uniform extra delay, 0..jitter
+        double failure = 0;                  // probability of EAI_AGAIN
+        unsigned int seed = 1;
+    };
+    static Config& config();
+
+    explicit StubResolver(std::shared_ptr<::uvw::TimerHandle> timer_) noexcept
+        : timer{ std::move(timer_) }
+    {}
+    static std::shared_ptr<StubResolver> create(std::shared_ptr<::uvw::Loop>);
+
+    void nodeAddrInfo(std::string node);
+    bool cancel();
+
+    StubResolver() = delete;
+    StubResolver(const StubResolver&) = delete;
+    StubResolver(StubResolver&&) = delete;
+    StubResolver& operator= (const StubResolver&) = delete;
+    StubResolver& operator= (StubResolver&&) = delete;
+
+    ~StubResolver() { release(); }
+
+private:
+    std::shared_ptr<::uvw::TimerHandle> timer;
+
+    void release();
+};
+
+// addrinfo holding one IPv4 address, as AddrInfoEvent carries it
+std::unique_ptr<addrinfo, ::uvw::AddrInfoEvent::Deleter> make_addrinfo(const std::string& ip);
+
+struct AIO_Stub : public AIO_UVW
+{
+    using GetAddrInfoReq = StubResolver;
+};
@@ -40,6 +40,14 @@ private:
     Clock::time_point last;
 };
 
+/* Upper bound of transfer rate imposed by the consumer side (bytes per second, 0 - unknown) */
+class Ceiling
+{
+public:
+    virtual std::size_t ceiling() const noexcept = 0;
+    virtual ~Ceiling() = default;
+};
+
 class Controller
 {
 public:
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "bandwidth.h"
+#include "metrics.h"
+#include "trace.h"
 #include <uvw/timer.hpp>
 
 #include <list>
+#include <algorithm>
 #include <cassert>
 #include <exception>
 
@@ -18,9 +21,10 @@ private:
     using TimerHandle = typename AIO::TimerHandle;
 
 public:
-    ControllerSimple(std::shared_ptr<Loop>loop, std::size_t limit_, std::unique_ptr<Time> time_)
+    ControllerSimple(std::shared_ptr<Loop>loop, std::size_t limit_, std::unique_ptr<Time> time_, std::shared_ptr<Ceiling> ceiling_ = nullptr)
         : limit{limit_},
           time{ std::move(time_) },
+          ceiling{ std::move(ceiling_) },
           timer{ loop->template resource<TimerHandle>() }
     {
         if (!timer)
@@ -42,6 +46,7 @@ public:
 private:
     const std::size_t limit;
     std::unique_ptr<Time> time;
+    std::shared_ptr<Ceiling> ceiling;
     std::shared_ptr<TimerHandle> timer;
 
     StreamsList streams;
@@ -49,6 +54,7 @@ private:
 
     void transfer();
     void defer_transfer();
+    std::size_t effective_limit() const noexcept;
 };
 
 /* Implementation */
@@ -87,14 +93,20 @@ void ControllerSimple<AIO>::transfer()
     if (pending_streams == 0)
         return;
 
+    auto& counters = metrics::registry();
+    counters.bandwidth_cycles.add();
+
     const auto elapsed = time->elapsed().count();
     assert(elapsed >= 0);
-    std::size_t total_to_transfer = ( limit * static_cast<size_t>(elapsed) ) / 1000;
+    const std::size_t current_limit = effective_limit();
+    counters.bandwidth_effective_limit.set( static_cast<std::int64_t>(current_limit) );
+    std::size_t total_to_transfer = ( current_limit * static_cast<size_t>(elapsed) ) / 1000;
     if (total_to_transfer == 0)
     {
         defer_transfer();
         return;
     }
+    const std::size_t granted = total_to_transfer;
 
     do {
         std::size_t chunk = std::max( total_to_transfer / pending_streams, 1ul );
@@ -110,7 +122,8 @@ void ControllerSimple<AIO>::transfer()
                 ++it;
 
                 std::size_t available = stream->available();
-                std::size_t to_transfer = std::min(available, chunk);
+                // A stopped stream keeps its data and is charged again on the next pass
+                std::size_t to_transfer = std::min( {available, chunk, total_to_transfer} );
                 if (to_transfer == 0)
                     continue;
 
@@ -126,6 +139,20 @@ void ControllerSimple<AIO>::transfer()
             }
         }
     } while (total_to_transfer > 0 && pending_streams > 0);
+    counters.bandwidth_granted_bytes.add(granted - total_to_transfer);
+
+    if ( trace::enabled() )
+    {
+        std::size_t queued = 0;
+        for (const auto& weak : streams)
+        {
+            auto stream = weak.lock();
+            if (stream)
+                queued += stream->available();
+        }
+        trace::counter( "bandwidth budget", static_cast<std::int64_t>(granted) );
+        trace::counter( "queued bytes", static_cast<std::int64_t>(queued) );
+    }
 
     if (pending_streams > 0)
         defer_transfer();
@@ -137,9 +164,20 @@ void ControllerSimple<AIO>::defer_transfer()
     using namespace std::literals::chrono_literals;
 
     sheduled = true;
+    metrics::registry().bandwidth_deferred.add();
     timer->template once<::uvw::TimerEvent>( [self = this->template shared_from_this()](const auto&, const auto&) { self->transfer(); } );
     timer->start(50ms, 0ms);
 }
 
+template< typename AIO >
+std::size_t ControllerSimple<AIO>::effective_limit() const noexcept
+{
+    if (!ceiling)
+        return limit;
+
+    const std::size_t c = ceiling->ceiling();
+    return (c > 0) ? std::min(limit, c) : limit;
+}
+
 } // namespace bandwidth
 } // namespace aio
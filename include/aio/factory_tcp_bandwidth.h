@@ -2,15 +2,17 @@
 
 #include "aio/factory_tcp.h"
 #include "aio/bandwidth.h"
+#include "aio/memory.h"
 
 namespace aio {
 
 class FactoryTCPSocketBandwidth : public FactoryTCPSocket
 {
 public:
-    FactoryTCPSocketBandwidth(std::shared_ptr<uvw::Loop> loop_, std::shared_ptr<bandwidth::Controller> controller_) noexcept
+    FactoryTCPSocketBandwidth(std::shared_ptr<uvw::Loop> loop_, std::shared_ptr<bandwidth::Controller> controller_, std::shared_ptr<memory::Budget> budget_ = nullptr) noexcept
         : FactoryTCPSocket{ std::move(loop_) },
-          controller{ std::move(controller_) }
+          controller{ std::move(controller_) },
+          budget{ std::move(budget_) }
     {}
 
     virtual std::shared_ptr<TCPSocket> tcp() override;
@@ -26,6 +28,7 @@ public:
 
 private:
     std::shared_ptr<bandwidth::Controller> controller;
+    std::shared_ptr<memory::Budget> budget;
 };
 
 } // namespace aio
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <list>
+
+namespace aio {
+namespace memory {
+
+class Consumer
+{
+public:
+    virtual std::size_t buffered() const noexcept = 0;
+    virtual void throttle() = 0;
+    virtual void unthrottle() = 0;
+    virtual ~Consumer() = default;
+};
+
+class Budget
+{
+public:
+    using ConsumersList = std::list< std::weak_ptr<Consumer> >;
+    using ConsumerConnection = ConsumersList::iterator;
+
+    virtual ConsumerConnection add_consumer(std::weak_ptr<Consumer>) = 0;
+    virtual void remove_consumer(ConsumerConnection) = 0;
+    virtual void acquire(std::size_t) = 0;
+    virtual void release(std::size_t) = 0;
+    virtual ~Budget() = default;
+};
+
+} // namespace memory
+} // namespace aio
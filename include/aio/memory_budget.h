@@ -0,0 +1,53 @@
+#pragma once
+
+#include "memory.h"
+
+#include <algorithm>
+
+namespace aio {
+namespace memory {
+
+/* Process-wide accounting of queued DataChunk bytes.
+ * When usage exceeds the limit, the consumers holding the most memory are throttled
+ * until usage drops below the low watermark (3/4 of the limit). */
+class BudgetSimple final : public Budget
+{
+public:
+    explicit BudgetSimple(std::size_t limit_);
+
+    virtual ConsumerConnection add_consumer(std::weak_ptr<Consumer>) override;
+    virtual void remove_consumer(ConsumerConnection) override;
+    virtual void acquire(std::size_t) override;
+    virtual void release(std::size_t) override;
+
+    std::size_t used() const noexcept { return m_used; }
+    std::size_t peak() const noexcept { return m_peak; }
+    std::size_t capacity() const noexcept { return limit; }
+    std::size_t consumers_count() const noexcept { return consumers.size(); }
+
+    BudgetSimple() = delete;
+    BudgetSimple(const BudgetSimple&) = delete;
+    BudgetSimple(BudgetSimple&&) = delete;
+    BudgetSimple& operator= (const BudgetSimple&) = delete;
+    BudgetSimple& operator= (BudgetSimple&&) = delete;
+
+    virtual ~BudgetSimple() = default;
+
+private:
+    const std::size_t limit;
+    const std::size_t low_watermark;
+    const std::size_t step;
+
+    ConsumersList consumers;
+    std::size_t m_used = 0;
+    std::size_t m_peak = 0;
+
+    bool throttled = false;
+    std::size_t next_throttle = 0;
+
+    void throttle();
+    void unthrottle();
+};
+
+} // namespace memory
+} // namespace aio
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "aio/bandwidth.h"
+
+namespace aio {
+namespace storage {
+
+/* Sink of file write completions, estimates sustainable write speed */
+class Estimator : public bandwidth::Ceiling
+{
+public:
+    virtual void write_begin() = 0;
+    virtual void write_end(std::size_t) = 0;
+    virtual void write_abort() = 0;
+    virtual ~Estimator() = default;
+};
+
+} // namespace storage
+} // namespace aio
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "aio/storage.h"
+
+namespace aio {
+namespace storage {
+
+/* Write throughput is measured over the time when at least one write is in flight,
+ * so idle storage does not lower the estimate. Samples shorter than the window are
+ * accumulated, complete samples are smoothed with EWMA (alpha = 1/4). */
+class EstimatorSimple final : public Estimator
+{
+public:
+    explicit EstimatorSimple(std::unique_ptr<bandwidth::Time> time_, std::chrono::milliseconds window_ = std::chrono::milliseconds{200})
+        : time{ std::move(time_) },
+          window{ window_ }
+    {}
+
+    virtual void write_begin() override;
+    virtual void write_end(std::size_t) override;
+    virtual void write_abort() override;
+    virtual std::size_t ceiling() const noexcept override { return throughput; }
+
+    EstimatorSimple() = delete;
+    EstimatorSimple(const EstimatorSimple&) = delete;
+    EstimatorSimple(EstimatorSimple&&) = delete;
+    EstimatorSimple& operator= (const EstimatorSimple&) = delete;
+    EstimatorSimple& operator= (EstimatorSimple&&) = delete;
+
+    virtual ~EstimatorSimple() = default;
+
+private:
+    std::unique_ptr<bandwidth::Time> time;
+    const std::chrono::milliseconds window;
+
+    std::size_t in_flight = 0;
+    std::size_t sample_bytes = 0;
+    std::chrono::milliseconds sample_time{0};
+    std::size_t throughput = 0;
+};
+
+} // namespace storage
+} // namespace aio
@@ -2,6 +2,7 @@
 
 #include "aio/tcp.h"
 #include "aio/bandwidth.h"
+#include "aio/memory.h"
 #include "data_chunk.h"
 
 #include <uvw/stream.hpp>
@@ -10,17 +11,19 @@
 
 namespace aio {
 
-class TCPSocketBandwidth final : public TCPSocket, public bandwidth::Stream, public std::enable_shared_from_this<TCPSocketBandwidth>
+class TCPSocketBandwidth final : public TCPSocket, public bandwidth::Stream, public memory::Consumer, public std::enable_shared_from_this<TCPSocketBandwidth>
 {
 private:
     using Controller = bandwidth::Controller;
+    using Budget = memory::Budget;
 
 public:
-    TCPSocketBandwidth(ConstructorAccess, std::shared_ptr<Controller> c, std::shared_ptr<TCPSocket>&& s) noexcept
+    TCPSocketBandwidth(ConstructorAccess, std::shared_ptr<Controller> c, std::shared_ptr<TCPSocket>&& s, std::shared_ptr<Budget> b = nullptr) noexcept
         : controller{ std::move(c) },
-          socket{ std::move(s) }
+          socket{ std::move(s) },
+          budget{ std::move(b) }
     {}
-    static std::shared_ptr<TCPSocketBandwidth> create(std::shared_ptr<void>, std::shared_ptr<Controller>, std::shared_ptr<TCPSocket>);
+    static std::shared_ptr<TCPSocketBandwidth> create(std::shared_ptr<void>, std::shared_ptr<Controller>, std::shared_ptr<TCPSocket>, std::shared_ptr<Budget> = nullptr);
 
     virtual void connect(const std::string&, unsigned short) override;
     virtual void connect6(const std::string&, unsigned short) override;
@@ -35,6 +38,10 @@ public:
     virtual std::size_t available() const noexcept override;
     virtual void transfer(std::size_t) override;
 
+    virtual std::size_t buffered() const noexcept override;
+    virtual void throttle() override;
+    virtual void unthrottle() override;
+
     TCPSocketBandwidth() = delete;
     TCPSocketBandwidth(const TCPSocketBandwidth&) = delete;
     TCPSocketBandwidth(TCPSocketBandwidth&&) = delete;
@@ -45,8 +52,10 @@ public:
 private:
     std::shared_ptr<Controller> controller;
     std::shared_ptr<TCPSocket> socket;
+    std::shared_ptr<Budget> budget;
 
     Controller::StreamConnection conn;
+    Budget::ConsumerConnection budget_conn;
 
     bool closed = false;
 
@@ -62,6 +71,7 @@ private:
     std::size_t buffer_used = 0;
     std::size_t buffer_max_length = 0;
     bool paused = false;
+    bool throttled = false;
     bool stopped = true;
     bool eof = false;
     std::queue<DataChunk> buffer;
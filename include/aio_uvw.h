@@ -5,6 +5,7 @@
 #include <uvw/timer.hpp>
 #include <uvw/tcp.hpp>
 #include <uvw/fs.hpp>
+#include <uvw/work.hpp>
 
 #include "aio/tcp_simple.h"
 #include "aio/tcp_bandwidth.h"
@@ -40,6 +41,7 @@ struct AIO_UVW
     using TimerHandle = uvw::TimerHandle;
     using FileReq = uvw::FileReq;
     using FsReq = uvw::FsReq;
+    using WorkReq = uvw::WorkReq;
 };
 
 inline const AIO_UVW::IPAddress AIO_UVW::addrinfo2IPAddress(const addrinfo* addr)
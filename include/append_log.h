@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <functional>
+
+/* Append-only text file, one record per line, under the journal and the persistent stores.
+ * A record torn by crash has no newline: load() cuts it off, so that appending does not complete it.
+ * rewrite() replaces the file atomically by rename, for compaction before open(). */
+class AppendLog
+{
+public:
+    using OnRecord = std::function<void(const std::string&)>;
+
+    AppendLog() = default;
+
+    // Creates the file if missing. False if it can`t be opened
+    bool open(const std::string& fname);
+    bool is_open() const noexcept { return fd >= 0; }
+    // Interrupted writes are resumed, data is synced unless sync is false.
+    // Touches the file only: safe on the threadpool, one call at a time
+    bool append(const std::string& data, bool sync = true) const noexcept;
+
+    // Calls on_record with every complete record, returns count of them. Throws runtime_error if a torn record can`t be cut off
+    static std::size_t load(const std::string& fname, const OnRecord& on_record);
+    static bool rewrite(const std::string& fname, const std::string& data);
+
+    AppendLog(const AppendLog&) = delete;
+    AppendLog(AppendLog&&) = delete;
+    AppendLog& operator= (const AppendLog&) = delete;
+    AppendLog& operator= (AppendLog&&) = delete;
+
+    ~AppendLog();
+
+private:
+    int fd = -1;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+/* Records buffered on the loop, appended off it by JournalWriter */
+class BufferedLog
+{
+public:
+    // Called when a batch is full, the interval is left to the writer
+    virtual void set_OnDue(std::function<void()>) = 0;
+    virtual std::chrono::milliseconds flush_interval() const noexcept = 0;
+    // Pending records, cleared
+    virtual std::string take() = 0;
+    // Records taken but not written go back in front of the pending ones
+    virtual void put_back(std::string) = 0;
+    // Appends and syncs, touches the file only: safe on the threadpool, one call at a time
+    virtual bool write(const std::string&) const noexcept = 0;
+    virtual ~BufferedLog() = default;
+};
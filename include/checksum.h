@@ -0,0 +1,58 @@
+#pragma once
+
+#include "stage.h"
+#include "sha256.h"
+#include "crc32c.h"
+
+#include <string>
+#include <memory>
+
+/* Digest of a file computed while it is written, checked against the expected one of the task.
+ * Spec is "<algorithm>:<hex>", algorithm sha256 or crc32c, hex may be empty for computing only */
+class Checksum : public Stage
+{
+public:
+    enum class Algorithm { Sha256, Crc32c };
+
+    // nullptr for an unknown algorithm or malformed hex
+    static std::unique_ptr<Checksum> parse(const std::string& spec, bool sidecar = false);
+
+    explicit Checksum(Algorithm algorithm_, std::string expected_ = std::string{}, bool sidecar_ = false)
+        : algorithm{algorithm_},
+          expected{ std::move(expected_) },
+          m_sidecar{sidecar_}
+    {}
+
+    void update(const void* data, std::size_t length) noexcept;
+    virtual void process(DataChunk& chunk) override final { update( chunk.data.get() + chunk.offset, chunk.length - chunk.offset ); }
+    // Lowercase hex, the state is finalized on the first call
+    const std::string& hex();
+    // True if nothing is expected
+    bool verify() { return expected.empty() || hex() == expected; }
+    const std::string& expected_hex() const noexcept { return expected; }
+    const char* name() const noexcept { return (algorithm == Algorithm::Sha256) ? "sha256" : "crc32c"; }
+
+    // Feeds the content of fname, false if it can`t be read
+    bool update(const std::string& fname);
+    // Next to fname as <fname>.<algorithm>, "<hex>  <basename>" like sha256sum.
+    // Touches the file only once hex() is called: safe on the threadpool then
+    bool write(const std::string& fname);
+    // The digest is written next to the file once verified
+    bool sidecar() const noexcept { return m_sidecar; }
+
+    Checksum() = delete;
+    Checksum(const Checksum&) = delete;
+    Checksum(Checksum&&) = delete;
+    Checksum& operator= (const Checksum&) = delete;
+    Checksum& operator= (Checksum&&) = delete;
+
+    virtual ~Checksum() = default;
+
+private:
+    const Algorithm algorithm;
+    const std::string expected;
+    const bool m_sidecar;
+    Sha256 sha256;
+    Crc32c crc32c;
+    std::string result;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/* CRC-32C (Castagnoli), incremental. SSE4.2 crc32 instruction when the CPU has it, slicing-by-8 otherwise */
+class Crc32c
+{
+public:
+    void update(const void* data, std::size_t length) noexcept;
+    std::uint32_t value() const noexcept { return ~crc; }
+    // Lowercase hex of value(), big-endian as printed by the usual tools
+    std::string hex() const;
+
+private:
+    std::uint32_t crc = 0xFFFFFFFF;
+};
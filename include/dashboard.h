@@ -5,6 +5,11 @@
 class Dashboard
 {
 public:
+    // Job is made for the file, before its first update()
+    virtual void started(std::size_t, const std::string& /*fname*/) {}
     virtual void update(std::size_t, const StatusDownloader&) = 0;
+    // Periodic sweep over running jobs: progress() for each one, then sweep_done()
+    virtual void progress(std::size_t, const StatusDownloader&) {}
+    virtual void sweep_done() {}
     virtual ~Dashboard() = default;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "dashboard.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/* Dashboard whose update() only appends a record to a fixed size ring.
+ * A writer thread formats the records (text or JSON lines) and flushes
+ * the stream once per interval, so the event loop never waits on terminal I/O.
+ * When the ring is full, the writer is woken early and new records are dropped and counted. */
+class DashboardBuffered final : public Dashboard
+{
+    using State = StatusDownloader::State;
+    using Clock = std::chrono::system_clock;
+
+public:
+    enum class Format { Text, Json };
+
+    explicit DashboardBuffered(std::ostream& out_, Format format_ = Format::Text,
+                               std::size_t capacity_ = 4096,
+                               std::chrono::milliseconds interval_ = std::chrono::milliseconds{200});
+
+    virtual void started(std::size_t, const std::string&) override;
+    virtual void update(std::size_t, const StatusDownloader&) override;
+    std::pair<std::size_t, std::size_t> status() { return std::pair<std::size_t, std::size_t>{done_tasks, total_downloaded}; }
+
+    // Blocks until everything appended so far is written
+    void flush();
+
+    std::size_t dropped() const;
+
+    DashboardBuffered() = delete;
+    DashboardBuffered(const DashboardBuffered&) = delete;
+    DashboardBuffered(DashboardBuffered&&) = delete;
+    DashboardBuffered& operator= (const DashboardBuffered&) = delete;
+    DashboardBuffered& operator= (DashboardBuffered&&) = delete;
+
+    virtual ~DashboardBuffered();
+
+private:
+    // Raw status fields, the text is made from them in the writer thread
+    struct Record
+    {
+        Clock::time_point time;
+        std::size_t job_id;
+        State state;
+        StatusDownloader::Phase phase;
+        StatusDownloader::Error error;
+        int error_code;
+        unsigned int http_status;
+        std::size_t downloaded;
+        std::string detail;
+        std::string redirect_uri;
+        std::string fname;
+    };
+
+    std::ostream& out;
+    const Format format;
+    const std::chrono::milliseconds interval;
+
+    std::size_t done_tasks = 0;
+    std::size_t total_downloaded = 0;
+    // Files of running jobs, by job id
+    std::unordered_map<std::size_t, std::string> files;
+
+    // Guarded by guard
+    std::vector<Record> ring;
+    std::size_t head = 0;
+    std::size_t count = 0;
+    std::size_t m_dropped = 0;
+    std::size_t reported_dropped = 0;
+    std::size_t appended = 0;
+    std::size_t written = 0;
+    bool stopping = false;
+    bool flush_requested = false;
+
+    mutable std::mutex guard;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::thread writer;
+
+    void run();
+    void write(const std::vector<Record>&);
+    void write_text(const Record&);
+    void write_json(const Record&);
+    void write_dropped(std::size_t);
+    static std::string str(const Record&);
+};
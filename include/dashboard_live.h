@@ -0,0 +1,71 @@
+#pragma once
+
+#include "dashboard.h"
+#include "aio/bandwidth.h"
+
+#include <ostream>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+/* Decorator that forwards job events to the wrapped dashboard and redraws a status
+ * view once per progress sweep: running/queued jobs, aggregate rate, top-N slowest
+ * jobs and ETA. Rates are EWMA (alpha = 1/4) over sweep intervals, so the cost depends
+ * on the sweep rate and the number of running jobs, not on the packet rate.
+ * ETA covers remaining bytes of running jobs plus queued tasks at the average size of done ones. */
+class DashboardLive final : public Dashboard
+{
+public:
+    using Queued = std::function<std::size_t()>;
+
+    DashboardLive(Dashboard& inner_, std::ostream& out_, std::unique_ptr<aio::bandwidth::Time> time_,
+                  Queued queued_ = Queued{}, std::size_t top_ = 3, bool redraw_ = true);
+
+    virtual void started(std::size_t job_id, const std::string& fname) override { inner.started(job_id, fname); }
+    virtual void update(std::size_t, const StatusDownloader&) override;
+    virtual void progress(std::size_t, const StatusDownloader&) override;
+    virtual void sweep_done() override;
+
+    std::size_t rate() const noexcept { return aggregate_rate; }
+    // Seconds, 0 - unknown
+    std::size_t eta() const noexcept { return m_eta; }
+
+    DashboardLive() = delete;
+    DashboardLive(const DashboardLive&) = delete;
+    DashboardLive(DashboardLive&&) = delete;
+    DashboardLive& operator= (const DashboardLive&) = delete;
+    DashboardLive& operator= (DashboardLive&&) = delete;
+
+    virtual ~DashboardLive() = default;
+
+private:
+    struct JobRate
+    {
+        std::size_t last = 0;
+        std::size_t current = 0;
+        std::size_t size = 0;
+        std::size_t rate = 0;
+        std::size_t generation = 0;
+    };
+
+    Dashboard& inner;
+    std::ostream& out;
+    std::unique_ptr<aio::bandwidth::Time> time;
+    const Queued queued;
+    const std::size_t top;
+    const bool redraw;
+
+    std::unordered_map<std::size_t, JobRate> jobs;
+    std::size_t generation = 0;
+    std::size_t finished_bytes = 0;
+    std::size_t aggregate_rate = 0;
+    std::size_t m_eta = 0;
+    std::size_t queued_tasks = 0;
+
+    std::size_t done_count = 0;
+    std::size_t done_bytes = 0;
+
+    std::size_t drawn_lines = 0;
+
+    void render();
+};
@@ -44,10 +44,10 @@ void DashboardSimple::update(std::size_t job_it, const StatusDownloader& status)
         total_downloaded += status.downloaded;
         break;
     case State::Failed:
-        std::cout << std::put_time(std::localtime(&time_), "%H:%M:%S  ") << "#" << job_it << " State: Failed, error: " << status.state_str << std::endl;
+        std::cout << std::put_time(std::localtime(&time_), "%H:%M:%S  ") << "#" << job_it << " State: Failed, error: " << status.str() << std::endl;
         break;
     case State::Redirect:
-        std::cout << std::put_time(std::localtime(&time_), "%H:%M:%S  ") << "#" << job_it << " State: Redirect, status: " << status.state_str << std::endl;
+        std::cout << std::put_time(std::localtime(&time_), "%H:%M:%S  ") << "#" << job_it << " State: Redirect, status: " << status.str() << std::endl;
         break;
     default:
         break;
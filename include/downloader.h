@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <chrono>
 
 class StatusDownloader
 {
@@ -9,16 +10,53 @@ public:
         downloaded{0},
         size{0},
         state{State::Init},
-        state_str{},
-        redirect_uri{}
+        phase{Phase::Init},
+        error{Error::None},
+        error_code{0},
+        http_status{0},
+        redirect_uri{},
+        detail{}
     {}
 
     std::size_t downloaded;
     std::size_t size;
-    enum class State { Init, OnTheGo, Done, Failed, Redirect };
+    enum class State { Init, OnTheGo, Done, Failed, Redirect, Suspended };
     State state;
-    std::string state_str;
+
+    enum class Phase { Init, Resolve, Connect, Request, Response, Receive };
+    Phase phase;
+
+    enum class Error {
+        None, Abort, UriParse,
+        SocketCreate, TimerCreate, ResolverCreate,
+        Resolve, Connect, ConnectTimeout, NetTimer,
+        Request, RequestTimeout,
+        ResponseRead, ResponseTimeout, ConnectionClosed, ResponseParse,
+        FileOpen, FileWrite, FileClose,
+        MaxRedirect, Checksum
+    };
+    Error error;
+    int error_code;           // libuv error code, 0 - none
+    unsigned int http_status; // 0 - response not received
+
     std::string redirect_uri;
+    std::string detail;       // subject of error (host, file name, parser message), set on failure only
+
+    // Monotonic timestamps of phase boundaries, default (epoch) - not reached
+    struct Timing
+    {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point resolve_start;
+        Clock::time_point resolve_end;
+        Clock::time_point connected;
+        Clock::time_point request_written;
+        Clock::time_point first_byte;
+        Clock::time_point done;
+    };
+    Timing timing;
+
+    // Human readable state, formatted on demand
+    std::string str() const;
 };
 
 class Downloader
@@ -29,3 +67,28 @@ public:
     virtual const StatusDownloader& status() const = 0;
     virtual ~Downloader() = default;
 };
+
+/* Downloader able to continue a partial file, for switching between sources */
+class DownloaderResumable : public Downloader
+{
+public:
+    // File the parts are cut from, every source must serve the same one
+    struct Entity
+    {
+        std::size_t size = 0; // of the whole file, 0 - unknown
+        std::string etag;
+        std::string last_modified;
+
+        bool empty() const noexcept { return size == 0 && etag.empty() && last_modified.empty(); }
+    };
+
+    // Continues fname from offset with a Range request, the partial file is left on failure.
+    // The response must start at offset and match the fields of entity that both sides know
+    virtual bool resume(const std::string& uri, const std::string& fname, std::size_t offset, const Entity& entity) = 0;
+    // Of the response, empty until the headers are received
+    virtual const Entity& entity() const = 0;
+    // Stops receiving, writes out the buffered data and reports Suspended. False if there is nothing to stop
+    virtual bool suspend() = 0;
+    // End of data written to the file, the next source continues from here
+    virtual std::size_t offset() const = 0;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "downloader.h"
+#include "on_tick.h"
+#include "object_cache.h"
+#include "checksum.h"
+#include "metrics.h"
+
+#include <uvw/work.hpp>
+#include <uvw/fs.hpp>
+
+#include <unordered_set>
+#include <cerrno>
+
+/* Satisfies a job from ObjectCache: the cached object is copied to the output file on the threadpool.
+ * If the copy fails, the entry is forgotten and the job is redirected to the same URI,
+ * so the next create() goes to the network. An existing output file keeps the entry: its name is put
+ * into bypass, the factory sends the redirected job to the network.
+ * A digest file (checksum given) is written from the restored file by the same work. */
+template< typename AIO >
+class DownloaderCached : public Downloader, public std::enable_shared_from_this< DownloaderCached<AIO> >
+{
+    using State = StatusDownloader::State;
+    using Error = StatusDownloader::Error;
+
+    using Loop = typename AIO::Loop;
+    using WorkReq = typename AIO::WorkReq;
+    using FsReq = typename AIO::FsReq;
+
+public:
+    using Bypass = std::unordered_set<std::string>;
+
+    DownloaderCached(std::shared_ptr<Loop> loop_, std::shared_ptr<OnTick> on_tick_, std::shared_ptr<ObjectCache> cache_, ObjectCache::Entry entry_, std::shared_ptr<Bypass> bypass_, std::shared_ptr<Checksum> checksum_ = nullptr)
+        : loop{ std::move(loop_) },
+          on_tick{ std::move(on_tick_) },
+          cache{ std::move(cache_) },
+          entry{ std::move(entry_) },
+          bypass{ std::move(bypass_) },
+          checksum{ std::move(checksum_) }
+    {}
+
+    virtual bool run(const std::string&, const std::string&) override final;
+    virtual void stop() override final;
+    virtual const StatusDownloader& status() const override final { return m_status; }
+
+    DownloaderCached() = delete;
+    DownloaderCached(const DownloaderCached&) = delete;
+    DownloaderCached(DownloaderCached&&) = delete;
+    DownloaderCached& operator= (const DownloaderCached&) = delete;
+    DownloaderCached& operator= (DownloaderCached&&) = delete;
+
+    virtual ~DownloaderCached() = default;
+
+private:
+    std::shared_ptr<Loop> loop;
+    std::shared_ptr<OnTick> on_tick;
+    std::shared_ptr<ObjectCache> cache;
+    const ObjectCache::Entry entry;
+    std::shared_ptr<Bypass> bypass;
+    std::shared_ptr<Checksum> checksum;
+
+    std::string uri;
+    std::string fname;
+    StatusDownloader m_status;
+    std::shared_ptr<WorkReq> work;
+
+    void on_restored(bool restored, bool exists, bool digest_written);
+};
+
+/* -- implementation, because template( -- */
+
+template< typename AIO >
+bool DownloaderCached<AIO>::run(const std::string& uri_, const std::string& fname_)
+{
+    uri = uri_;
+    fname = fname_;
+    m_status.state = State::Init;
+
+    // Written on the threadpool, read on the loop after WorkEvent. The output file is checked there too
+    auto restored = std::make_shared<bool>(false);
+    auto exists = std::make_shared<bool>(false);
+    auto digest_written = std::make_shared<bool>(false);
+    work = loop->template resource<WorkReq>( [cache = cache, entry = entry, fname = fname, checksum = checksum, restored, exists, digest_written]()
+    {
+        *restored = cache->restore(entry, fname);
+        *exists = !*restored && errno == EEXIST;
+        if (*restored && checksum)
+            *digest_written = checksum->update(fname) && checksum->write(fname);
+    } );
+    if (!work)
+        return false;
+
+    auto self = this->template shared_from_this();
+    work->template once<::uvw::ErrorEvent>( [self](const auto&, const auto&) { self->on_restored(false, false, false); } );
+    work->template once<::uvw::WorkEvent>( [self, restored, exists, digest_written](const auto&, const auto&) { self->on_restored(*restored, *exists, *digest_written); } );
+
+    m_status.state = State::OnTheGo;
+    m_status.size = entry.validator.size;
+    metrics::registry().threadpool_requests.add();
+    work->queue();
+    return true;
+}
+
+template< typename AIO >
+void DownloaderCached<AIO>::stop()
+{
+    if (m_status.state != State::OnTheGo)
+        return;
+
+    // Already running work completes anyway, on_restored removes the file it made
+    work->cancel();
+    m_status.state = State::Failed;
+    m_status.error = Error::Abort;
+    metrics::registry().jobs_failed.add();
+    on_tick->invoke( this->template shared_from_this() );
+}
+
+template< typename AIO >
+void DownloaderCached<AIO>::on_restored(bool restored, bool exists, bool digest_written)
+{
+    work->clear();
+    metrics::registry().threadpool_requests.sub();
+
+    if (m_status.state != State::OnTheGo)
+    {
+        // Stopped, the file was never reported as Done
+        if (restored)
+        {
+            auto fs = loop->template resource<FsReq>();
+            if (fs)
+                fs->unlink(fname);
+        }
+        if (digest_written)
+        {
+            auto fs = loop->template resource<FsReq>();
+            if (fs)
+                fs->unlink( fname + "." + checksum->name() );
+        }
+        return;
+    }
+
+    auto& counters = metrics::registry();
+    if (restored && checksum && !digest_written)
+    {
+        // The file is complete, its digest file is not
+        m_status.state = State::Failed;
+        m_status.error = Error::FileWrite;
+        m_status.detail = fname + "." + checksum->name();
+        counters.jobs_failed.add();
+    } else if (restored)
+    {
+        m_status.state = State::Done;
+        m_status.timing.done = StatusDownloader::Timing::Clock::now();
+        counters.jobs_done.add();
+        counters.cache_hits.add();
+        counters.cache_bytes_saved.add(entry.validator.size);
+    } else
+    {
+        if (exists)
+        {
+            bypass->insert(fname);
+            counters.cache_misses.add();
+        } else
+        {
+            cache->forget(uri);
+        }
+        m_status.state = State::Redirect;
+        m_status.redirect_uri = uri;
+        counters.jobs_redirect.add();
+    }
+    on_tick->invoke( this->template shared_from_this() );
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include "downloader.h"
+#include "on_tick.h"
+#include "mirror_rates.h"
+#include "aio/bandwidth.h"
+#include "metrics.h"
+
+#include <uvw/timer.hpp>
+#include <uvw/fs.hpp>
+
+#include <vector>
+#include <functional>
+#include <limits>
+#include <sys/stat.h>
+
+/* Downloads one file from several mirrors, "uri|uri|..." in the task list.
+ * The source is the mirror with the best throughput measured so far by any job, a mirror not measured yet
+ * goes first (probe). Every interval the source is compared with the best measured mirror: a source
+ * <switch_ratio> times slower is suspended and the file continues from the other mirror by Range.
+ * A failed or redirected source continues the same way from the end of its data. A source serving
+ * another size or validator than the first one, or a part not starting at the offset, fails as a mirror. */
+template< typename AIO, typename Parser >
+class DownloaderMirrored : public Downloader, public std::enable_shared_from_this< DownloaderMirrored<AIO, Parser> >
+{
+    using State = StatusDownloader::State;
+    using Phase = StatusDownloader::Phase;
+    using Error = StatusDownloader::Error;
+
+    using Loop = typename AIO::Loop;
+    using Timer = typename AIO::TimerHandle;
+    using FsReq = typename AIO::FsReq;
+
+public:
+    using Source = std::function< std::shared_ptr<DownloaderResumable>(std::shared_ptr<OnTick>) >;
+
+    DownloaderMirrored(std::shared_ptr<Loop> loop_, std::shared_ptr<OnTick> on_tick_, Source make_source_, std::shared_ptr<MirrorRates> rates_, std::unique_ptr<aio::bandwidth::Time> time_, std::size_t max_redirect_ = 10)
+        : loop{ std::move(loop_) },
+          on_tick{ std::move(on_tick_) },
+          make_source{ std::move(make_source_) },
+          rates{ std::move(rates_) },
+          time{ std::move(time_) },
+          max_redirect{max_redirect_}
+    {}
+
+    virtual bool run(const std::string&, const std::string&) override final;
+    virtual void stop() override final;
+    virtual const StatusDownloader& status() const override final
+    {
+        if (source && m_status.state == State::OnTheGo)
+        {
+            const auto& part = source->status();
+            m_status.downloaded = done_bytes + part.downloaded;
+            if (part.size > 0)
+                m_status.size = offset + part.size;
+        }
+        return m_status;
+    }
+
+    static constexpr double switch_ratio = 2.0;
+    static constexpr std::chrono::milliseconds interval{1000};
+
+    static std::vector<std::string> split(const std::string&);
+
+    DownloaderMirrored() = delete;
+    DownloaderMirrored(const DownloaderMirrored&) = delete;
+    DownloaderMirrored(DownloaderMirrored&&) = delete;
+    DownloaderMirrored& operator= (const DownloaderMirrored&) = delete;
+    DownloaderMirrored& operator= (DownloaderMirrored&&) = delete;
+
+    virtual ~DownloaderMirrored() = default;
+
+private:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+    struct Mirror
+    {
+        std::string uri;
+        std::string host;
+        bool failed;
+    };
+
+    /* Sources report here, they don`t keep the downloader alive */
+    class Relay final : public OnTick
+    {
+    public:
+        explicit Relay(std::weak_ptr<DownloaderMirrored> self_)
+            : self{ std::move(self_) }
+        {}
+
+        virtual void invoke(std::shared_ptr<Downloader> downloader) override
+        {
+            if ( auto s = self.lock() )
+                s->on_source( downloader.get() );
+        }
+
+    private:
+        std::weak_ptr<DownloaderMirrored> self;
+    };
+
+    std::shared_ptr<Loop> loop;
+    std::shared_ptr<OnTick> on_tick;
+    Source make_source;
+    std::shared_ptr<MirrorRates> rates;
+    std::unique_ptr<aio::bandwidth::Time> time;
+    const std::size_t max_redirect;
+
+    std::vector<Mirror> mirrors;
+    std::string fname;
+    mutable StatusDownloader m_status;
+    std::shared_ptr<Timer> timer;
+
+    std::shared_ptr<DownloaderResumable> source;
+    std::size_t current = none;
+    std::size_t switch_to = none;
+    std::size_t offset = 0;     // end of data of released sources
+    std::size_t done_bytes = 0; // received by released sources
+    std::size_t redirect_count = 0;
+    bool stopping = false;
+    // Pinned by the first source that received the headers, the later ones must match it
+    DownloaderResumable::Entity entity;
+
+    // Measurement of the current source
+    std::size_t measured = 0;
+    std::size_t checks = 0;
+
+    static std::string host_of(const std::string& uri)
+    {
+        auto parsed = Parser::uri_parse(uri);
+        return (parsed) ? parsed->host : uri;
+    }
+
+    std::size_t pick(bool measured_only) const;
+    bool start(std::size_t);
+    bool start_next();
+    void release(const StatusDownloader&);
+    void fail(const StatusDownloader&);
+    void check();
+    void on_source(Downloader*);
+};
+
+/* -- implementation, because template( -- */
+
+template< typename AIO, typename Parser >
+constexpr double DownloaderMirrored<AIO, Parser>::switch_ratio;
+
+template< typename AIO, typename Parser >
+constexpr std::chrono::milliseconds DownloaderMirrored<AIO, Parser>::interval;
+
+template< typename AIO, typename Parser >
+constexpr std::size_t DownloaderMirrored<AIO, Parser>::none;
+
+template< typename AIO, typename Parser >
+std::vector<std::string> DownloaderMirrored<AIO, Parser>::split(const std::string& uri)
+{
+    std::vector<std::string> result;
+    std::size_t begin = 0;
+    while (begin <= uri.size())
+    {
+        auto end = uri.find('|', begin);
+        if (end == std::string::npos)
+            end = uri.size();
+        if (end > begin)
+            result.push_back( uri.substr(begin, end - begin) );
+        begin = end + 1;
+    }
+    return result;
+}
+
+template< typename AIO, typename Parser >
+bool DownloaderMirrored<AIO, Parser>::run(const std::string& uri, const std::string& fname_)
+{
+    fname = fname_;
+    m_status.state = State::Init;
+
+    for (auto& mirror : split(uri))
+        mirrors.push_back( Mirror{ mirror, host_of(mirror), false } );
+    if ( mirrors.empty() )
+    {
+        m_status.state = State::Failed;
+        m_status.error = Error::UriParse;
+        return false;
+    }
+
+    // Parts are written without O_EXCL, an existing file is checked once here
+    struct stat st;
+    if ( ::stat(fname.c_str(), &st) == 0 )
+    {
+        m_status.state = State::Failed;
+        m_status.error = Error::FileOpen;
+        m_status.detail = fname;
+        return false;
+    }
+
+    timer = loop->template resource<Timer>();
+    if (!timer)
+    {
+        m_status.state = State::Failed;
+        m_status.error = Error::TimerCreate;
+        return false;
+    }
+
+    m_status.state = State::OnTheGo;
+    if ( !start_next() )
+    {
+        m_status.state = State::Failed;
+        timer->close();
+        timer.reset();
+        return false;
+    }
+
+    std::weak_ptr<DownloaderMirrored> weak{ this->template shared_from_this() };
+    timer->template on<::uvw::TimerEvent>( [weak](const auto&, const auto&)
+    {
+        if ( auto self = weak.lock() )
+            self->check();
+    } );
+    timer->start(interval, interval);
+    return true;
+}
+
+template< typename AIO, typename Parser >
+void DownloaderMirrored<AIO, Parser>::stop()
+{
+    if (m_status.state != State::OnTheGo)
+        return;
+
+    stopping = true;
+    if (source)
+    {
+        // Reports Failed, on_source() finishes
+        source->stop();
+        return;
+    }
+    StatusDownloader status;
+    status.error = Error::Abort;
+    fail(status);
+}
+
+// Not measured first, then the fastest
+template< typename AIO, typename Parser >
+std::size_t DownloaderMirrored<AIO, Parser>::pick(bool measured_only) const
+{
+    std::size_t best = none;
+    double best_rate = -1;
+    for (std::size_t i = 0; i < mirrors.size(); i++)
+    {
+        if (mirrors[i].failed || i == current)
+            continue;
+        const double rate = rates->estimate(mirrors[i].host);
+        if (rate < 0 && !measured_only)
+            return i;
+        if (rate >= 0 && rate > best_rate)
+        {
+            best = i;
+            best_rate = rate;
+        }
+    }
+    return best;
+}
+
+template< typename AIO, typename Parser >
+bool DownloaderMirrored<AIO, Parser>::start(std::size_t i)
+{
+    current = i;
+    measured = 0;
+    checks = 0;
+    time->elapsed();
+
+    source = make_source( std::make_shared<Relay>( this->template shared_from_this() ) );
+    if ( source && source->resume(mirrors[i].uri, fname, offset, entity) )
+        return true;
+
+    if (source)
+    {
+        const auto& status = source->status();
+        m_status.error = status.error;
+        m_status.error_code = status.error_code;
+        m_status.detail = status.detail;
+        source.reset();
+    }
+    return false;
+}
+
+template< typename AIO, typename Parser >
+bool DownloaderMirrored<AIO, Parser>::start_next()
+{
+    for (;;)
+    {
+        current = none;
+        const auto next = pick(false);
+        if (next == none)
+            return false;
+        if ( start(next) )
+            return true;
+        mirrors[next].failed = true;
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderMirrored<AIO, Parser>::release(const StatusDownloader& status)
+{
+    using Clock = StatusDownloader::Timing::Clock;
+
+    const auto first_byte = status.timing.first_byte;
+    if ( first_byte != Clock::time_point{} && status.downloaded > 0 )
+    {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>( Clock::now() - first_byte ).count();
+        if (us > 0)
+            rates->record( mirrors[current].host, static_cast<double>(status.downloaded) * 1e6 / static_cast<double>(us) );
+    }
+
+    if ( entity.empty() )
+        entity = source->entity();
+    offset = source->offset();
+    done_bytes += status.downloaded;
+    source.reset();
+}
+
+template< typename AIO, typename Parser >
+void DownloaderMirrored<AIO, Parser>::fail(const StatusDownloader& status)
+{
+    m_status.state = State::Failed;
+    m_status.downloaded = done_bytes;
+    m_status.error = status.error;
+    m_status.error_code = status.error_code;
+    m_status.detail = status.detail;
+    if (timer)
+    {
+        timer->clear();
+        timer->close();
+        timer.reset();
+    }
+    // Parts written so far
+    auto fs = loop->template resource<FsReq>();
+    if (fs)
+        fs->unlink(fname);
+    on_tick->invoke( this->template shared_from_this() );
+}
+
+template< typename AIO, typename Parser >
+void DownloaderMirrored<AIO, Parser>::on_source(Downloader* downloader)
+{
+    if ( !source || downloader != source.get() )
+        return;
+
+    const StatusDownloader status = source->status();
+    switch (status.state)
+    {
+    case State::Init:
+    case State::OnTheGo:
+        m_status.phase = status.phase;
+        m_status.http_status = status.http_status;
+        if (status.size > 0)
+            m_status.size = offset + status.size;
+        on_tick->invoke( this->template shared_from_this() );
+        break;
+
+    case State::Done:
+        release(status);
+        m_status.state = State::Done;
+        m_status.downloaded = done_bytes;
+        m_status.size = offset;
+        m_status.http_status = status.http_status;
+        timer->clear();
+        timer->close();
+        timer.reset();
+        on_tick->invoke( this->template shared_from_this() );
+        break;
+
+    case State::Suspended:
+    {
+        release(status);
+        metrics::registry().mirror_switches.add();
+        const auto target = switch_to;
+        switch_to = none;
+        if ( target != none && start(target) )
+            break;
+        if (target != none)
+            mirrors[target].failed = true;
+        if ( !start_next() )
+            fail(status);
+        break;
+    }
+
+    case State::Failed:
+        // The whole file is wrong, not the mirror
+        if (!stopping && status.error != Error::Checksum)
+        {
+            release(status);
+            mirrors[current].failed = true;
+            rates->record(mirrors[current].host, 0);
+            if ( start_next() )
+                break;
+        } else
+        {
+            release(status);
+        }
+        fail(status);
+        break;
+
+    case State::Redirect:
+        release(status);
+        if (++redirect_count > max_redirect)
+        {
+            StatusDownloader max;
+            max.error = Error::MaxRedirect;
+            fail(max);
+            break;
+        }
+        mirrors[current].uri = status.redirect_uri;
+        mirrors[current].host = host_of(status.redirect_uri);
+        if ( start(current) )
+            break;
+        mirrors[current].failed = true;
+        if ( !start_next() )
+            fail(status);
+        break;
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderMirrored<AIO, Parser>::check()
+{
+    if (!source || switch_to != none)
+        return;
+
+    const auto& status = source->status();
+    const auto elapsed = time->elapsed();
+    if (status.phase != Phase::Receive || elapsed.count() <= 0)
+    {
+        measured = status.downloaded;
+        return;
+    }
+    const double rate = static_cast<double>(status.downloaded - measured) * 1000 / static_cast<double>( elapsed.count() );
+    measured = status.downloaded;
+    // The first interval holds connection slow start
+    if (++checks < 2)
+        return;
+    rates->record(mirrors[current].host, rate);
+
+    // Not worth a new connection for the tail
+    if ( status.size <= status.downloaded || static_cast<double>(status.size - status.downloaded) < rate * 2 )
+        return;
+    const auto best = pick(true);
+    if ( best == none || rates->estimate(mirrors[best].host) < rate * switch_ratio )
+        return;
+
+    // Suspended is reported when the buffered data is written, maybe right away
+    switch_to = best;
+    if ( !source->suspend() )
+        switch_to = none;
+}
@@ -3,12 +3,21 @@
 #include "downloader.h"
 #include "on_tick.h"
 #include "aio/factory_tcp.h"
+#include "aio/memory.h"
+#include "aio/storage.h"
 #include "data_chunk.h"
+#include "validator_store.h"
+#include "redirect_cache.h"
+#include "checksum.h"
+#include "stage.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include <uvw/dns.hpp>
 #include <uvw/stream.hpp>
 #include <uvw/timer.hpp>
 #include <uvw/fs.hpp>
+#include <uvw/work.hpp>
 
 #include <chrono>
 #include <queue>
@@ -17,33 +26,57 @@
 #include <limits>
 
 template< typename AIO, typename Parser >
-class DownloaderSimple : public Downloader, public std::enable_shared_from_this< DownloaderSimple<AIO, Parser> >
+class DownloaderSimple : public DownloaderResumable, public std::enable_shared_from_this< DownloaderSimple<AIO, Parser> >
 {
     using State = StatusDownloader::State;
+    using Phase = StatusDownloader::Phase;
+    using Error = StatusDownloader::Error;
 
     using Loop = typename AIO::Loop;
     using GetAddrInfoReq = typename AIO::GetAddrInfoReq;
     using Timer = typename AIO::TimerHandle;
     using FileReq = typename AIO::FileReq;
     using FsReq = typename AIO::FsReq;
+    using WorkReq = typename AIO::WorkReq;
     using FileOpenEvent = ::uvw::FsEvent<uvw::FileReq::Type::OPEN>;
     using FileWriteEvent = ::uvw::FsEvent<uvw::FileReq::Type::WRITE>;
     using FileCloseEvent = ::uvw::FsEvent<uvw::FileReq::Type::CLOSE>;
+    using FsRenameEvent = ::uvw::FsEvent<uvw::FsReq::Type::RENAME>;
 
     using UriParseResult = typename Parser::UriParseResult;
 
+    using Budget = aio::memory::Budget;
+    using Storage = aio::storage::Estimator;
+
+    using Clock = StatusDownloader::Timing::Clock;
+
 public:
-    DownloaderSimple(std::shared_ptr<Loop> loop_, std::shared_ptr<OnTick> on_tick_, std::shared_ptr<aio::FactoryTCPSocket> factory_socket_, std::size_t backlog_ = 10)
+    DownloaderSimple(std::shared_ptr<Loop> loop_, std::shared_ptr<OnTick> on_tick_, std::shared_ptr<aio::FactoryTCPSocket> factory_socket_, std::size_t backlog_ = 10, std::shared_ptr<Budget> budget_ = nullptr, std::shared_ptr<Storage> storage_ = nullptr, std::shared_ptr<ValidatorStore> validators_ = nullptr, std::shared_ptr<RedirectCache> redirects_ = nullptr, std::shared_ptr<Checksum> checksum_ = nullptr, bool overwrite_ = false)
         : loop{ std::move(loop_) },
           on_tick{ std::move(on_tick_) },
           factory_socket{ std::move(factory_socket_) },
-          backlog{backlog_}
+          backlog{backlog_},
+          budget{ std::move(budget_) },
+          storage{ std::move(storage_) },
+          validators{ std::move(validators_) },
+          redirects{ std::move(redirects_) },
+          checksum{ std::move(checksum_) },
+          overwrite{overwrite_}
     {}
 
     virtual bool run(const std::string&, const std::string&) override final;
-    virtual void stop() override final { on_error("Abort."); }
+    virtual void stop() override final { on_error(Error::Abort); }
     virtual const StatusDownloader& status() const override final { return m_status; }
 
+    virtual bool resume(const std::string&, const std::string&, std::size_t, const Entity&) override final;
+    virtual const Entity& entity() const override final { return m_entity; }
+    virtual bool suspend() override final;
+    virtual std::size_t offset() const override final { return offset_file; }
+
+
+    // Redirects within the origin followed on the open connection, then they go through OnTick
+    static constexpr std::size_t max_follow = 10;
+
     DownloaderSimple() = delete;
     DownloaderSimple(const DownloaderSimple&) = delete;
     DownloaderSimple(DownloaderSimple&&) = delete;
@@ -57,7 +90,19 @@ private:
     std::shared_ptr<OnTick> on_tick;
     std::shared_ptr<aio::FactoryTCPSocket> factory_socket;
     const std::size_t backlog;
-
+    std::shared_ptr<Budget> budget;
+    std::shared_ptr<Storage> storage;
+    std::shared_ptr<ValidatorStore> validators;
+    std::shared_ptr<RedirectCache> redirects;
+    // Fed with the data as it is written, in file order. Shared by the sources of a mirrored download
+    std::shared_ptr<Checksum> checksum;
+    // An existing file is replaced: a rerun after a crash finds the files of unfinished tasks
+    const bool overwrite;
+    // Between on_data and on_write, off the loop. A resumed part hashes as it writes:
+    // data processed but not written would be received again from the next source
+    std::shared_ptr<Stage> stage;
+
+    std::string uri;
     std::string fname;
     StatusDownloader m_status;
     std::unique_ptr<UriParseResult> uri_parsed;
@@ -70,44 +115,102 @@ private:
     bool receive_done = false;
     bool socket_connected = false;
 
+    // Validators of the file left by a previous run (conditional request) or of the response
+    ValidatorStore::Validator validator;
+    bool conditional = false;
+    // File written: a changed file goes beside the one of the previous run and replaces it on Done
+    std::string file_path;
+
     std::queue<DataChunk> buffer;
+    // Received, waiting for the stage, counted in backlog and buffered_bytes with buffer
+    std::queue<DataChunk> unprocessed;
+    std::shared_ptr<WorkReq> work;
+    // Resumed part of a file: Range request from range_offset, the file is not removed on failure
+    bool keep_partial = false;
+    std::size_t range_offset = 0;
+    Entity expected;
+    Entity m_entity;
+    bool entity_checked = false;
+    bool suspending = false;
+
+    std::size_t followed = 0;
+
     bool file_openned = false;
     bool file_operation_started = false;
+    bool write_pending = false;
     std::size_t offset_file = 0;
 
-    std::pair<bool, std::string> create_handles();
+    std::size_t buffered_bytes = 0;
+
+    // Metrics accounting
+    bool running_counted = false;
+    bool resolve_pending = false;
+
+    std::uint64_t trace_track = 0;
+    Clock::time_point write_start;
+
+    static void record(metrics::LatencyHistogram& histogram, Clock::time_point begin, Clock::time_point end)
+    {
+        if ( begin != Clock::time_point{} )
+            histogram.record( std::chrono::duration_cast<std::chrono::microseconds>(end - begin) );
+    }
+
+    Error create_handles();
     void terminate_handles();
     void close_handles(std::function<void()>);
     void open_file(const std::string&fname);
-
-    template< typename String >
-    std::enable_if_t< std::is_convertible<String, std::string>::value, void>
-    on_error_without_tick(String&& str)
+    bool check_entity(const typename Parser::ResponseParseResult&);
+    void abort_write();
+    void process_next();
+    void on_processed(DataChunk&);
+    void cancel_work();
+    void resolve_done();
+    void count_finished(State);
+    void store_validator();
+    bool verify_checksum();
+    void finish();
+    void write_sidecar();
+    void on_sidecar_written(bool);
+    std::string absolute(const std::string&) const;
+    bool follow(const std::string&);
+
+    void on_error_without_tick(Error error, int code = 0, std::string detail = std::string{})
     {
-        m_status.state = StatusDownloader::State::Failed;
-        m_status.state_str = std::forward<String>(str);
+        count_finished(State::Failed);
+        m_status.state = State::Failed;
+        m_status.error = error;
+        m_status.error_code = code;
+        m_status.detail = std::move(detail);
+        if ( trace::enabled() )
+            trace::instant( "error", trace_track, m_status.str() );
         terminate_handles();
     }
 
-    template< typename String >
-    std::enable_if_t< std::is_convertible<String, std::string>::value, void>
-    on_error(String&& str)
+    void on_error(Error error, int code = 0, std::string detail = std::string{})
     {
-        on_error_without_tick( std::forward<String>(str) );
+        on_error_without_tick( error, code, std::move(detail) );
         on_tick->invoke( this->template shared_from_this() );
     }
 
-    template< typename String >
-    std::enable_if_t< std::is_convertible<String, std::string>::value, void>
-    update_status(State state, String&& str)
+    void update_status(State state)
     {
+        if (state == State::Done)
+            store_validator();
+        if (state != State::OnTheGo)
+            count_finished(state);
         m_status.state = state;
-        m_status.state_str = std::forward<String>(str);
         on_tick->invoke( this->template shared_from_this() );
     }
 
+    void update_phase(Phase phase)
+    {
+        m_status.phase = phase;
+        update_status(State::OnTheGo);
+    }
+
     void on_resolve(const ::uvw::AddrInfoEvent&);
     void on_connect();
+    void request();
     void on_write_http_request();
     void on_read(std::unique_ptr<char[]>, std::size_t);
     void on_data(std::unique_ptr<char[]>, std::size_t);
@@ -118,31 +221,37 @@ private:
 
 /* -- implementation, because template( -- */
 
-template< typename ErrorEvent >
-inline std::string ErrorEvent2str(const ErrorEvent& err)
-{
-    return "Code => " + std::to_string(err.code()) + " Reason => " + err.what();
-}
+template< typename AIO, typename Parser >
+constexpr std::size_t DownloaderSimple<AIO, Parser>::max_follow;
 
 template< typename AIO, typename Parser >
-bool DownloaderSimple<AIO, Parser>::run(const std::string& uri, const std::string& fname_)
+bool DownloaderSimple<AIO, Parser>::run(const std::string& uri_, const std::string& fname_)
 {
+    uri = uri_;
     fname = fname_;
     m_status.state = State::Init;
+    if ( trace::enabled() )
+        trace_track = trace::new_track(fname);
 
     uri_parsed = Parser::uri_parse(uri);
     if (!uri_parsed)
     {
         m_status.state = State::Failed;
-        m_status.state_str = "URI can`t parse";
+        m_status.error = Error::UriParse;
+        metrics::registry().jobs_failed.add();
         return false;
     }
+    if (validators && !keep_partial)
+        conditional = validators->lookup(uri, fname, validator);
+    if (!keep_partial)
+        stage = checksum;
 
-    auto result = create_handles();
-    if (!result.first)
+    auto error = create_handles();
+    if (error != Error::None)
     {
         m_status.state = State::Failed;
-        m_status.state_str = std::move(result.second);
+        m_status.error = error;
+        metrics::registry().jobs_failed.add();
         return false;
     }
 
@@ -150,43 +259,105 @@ bool DownloaderSimple<AIO, Parser>::run(const std::string& uri, const std::strin
 
     resolver->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&)
     {
+        self->resolve_done();
         self->resolver.reset();
-        std::string err_str = "Host <" + self->uri_parsed->host + "> can`t resolve. " + ErrorEvent2str(err);
         if ( self->m_status.state == State::OnTheGo )
-            self->on_error( std::move(err_str) );
+            self->on_error( Error::Resolve, err.code(), self->uri_parsed->host );
         else
-            self->on_error_without_tick( std::move(err_str) );
+            self->on_error_without_tick( Error::Resolve, err.code(), self->uri_parsed->host );
     } );
     resolver->template once<::uvw::AddrInfoEvent>( [self](const auto& event, const auto&)
     {
+        self->resolve_done();
         self->resolver.reset();
         self->on_resolve(event);
     } );
 
+    resolve_pending = true;
+    metrics::registry().threadpool_requests.add();
+    m_status.timing.resolve_start = Clock::now();
     resolver->nodeAddrInfo(uri_parsed->host);
 
     if ( m_status.state == State::Init )
     {
         m_status.state = State::OnTheGo;
-        m_status.state_str = "Resolve host <" + uri_parsed->host + ">...";
+        m_status.phase = Phase::Resolve;
+        running_counted = true;
+        metrics::registry().jobs_running.add();
         return true;
     }
+    metrics::registry().jobs_failed.add();
     return false;
 }
 
+template< typename AIO, typename Parser >
+bool DownloaderSimple<AIO, Parser>::resume(const std::string& uri_, const std::string& fname_, std::size_t offset_, const Entity& entity_)
+{
+    keep_partial = true;
+    range_offset = offset_;
+    expected = entity_;
+    offset_file = offset_;
+    return run(uri_, fname_);
+}
+
+template< typename AIO, typename Parser >
+bool DownloaderSimple<AIO, Parser>::suspend()
+{
+    if (m_status.state != State::OnTheGo || receive_done)
+        return false;
+
+    // Network side is dropped at once, the file side drains the buffer and closes the file
+    suspending = true;
+    receive_done = true;
+    socket_connected = false;
+    if (resolver)
+    {
+        resolve_done();
+        resolver->clear();
+        resolver->cancel();
+        resolver.reset();
+    }
+    if (socket)
+    {
+        socket->clear();
+        socket->close();
+        socket.reset();
+    }
+    if (net_timer)
+    {
+        net_timer->clear();
+        net_timer->close();
+        net_timer.reset();
+    }
+
+    if (file_operation_started)
+        return true;
+    if (file_openned)
+    {
+        file_operation_started = true;
+        on_write();
+        return true;
+    }
+    update_status(State::Suspended);
+    return true;
+}
+
 template< typename AIO, typename Parser >
 void DownloaderSimple<AIO, Parser>::on_resolve(const ::uvw::AddrInfoEvent& event)
 {
     using namespace ::std::chrono_literals;
 
     const auto addr = AIO::addrinfo2IPAddress( event.data.get() );
-    update_status(State::OnTheGo, "Host Resolved. Connect to <" + addr.ip + ">");
+    m_status.timing.resolve_end = Clock::now();
+    record( metrics::registry().resolve_latency, m_status.timing.resolve_start, m_status.timing.resolve_end );
+    trace::span( "resolve", trace_track, m_status.timing.resolve_start, m_status.timing.resolve_end );
+    update_phase(Phase::Connect);
 
     auto self = this->template shared_from_this();
-    socket->template once<::uvw::ErrorEvent>( [self, addr](const auto& err, const auto&) { self->on_error("Host <" + addr.ip + "> can`t available. " + ErrorEvent2str(err) ); } );
+    socket->template once<::uvw::ErrorEvent>( [self, addr](const auto& err, const auto&) { self->on_error( Error::Connect, err.code(), addr.ip ); } );
     socket->template once<::uvw::ConnectEvent>( [self](const auto&, const auto&) { self->on_connect(); } );
-    net_timer->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error("Net_timer run failed! " + ErrorEvent2str(err) ); } );
-    net_timer->template once<::uvw::TimerEvent>( [self, addr](const auto&, const auto&) { self->on_error("Timeout connect to host <" + addr.ip + ">"); } );
+    net_timer->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error( Error::NetTimer, err.code() ); } );
+    net_timer->template once<::uvw::TimerEvent>( [self, addr](const auto&, const auto&) { self->on_error( Error::ConnectTimeout, 0, addr.ip ); } );
 
     if (addr.v6)
         socket->connect6(addr.ip, uri_parsed->port);
@@ -202,16 +373,27 @@ void DownloaderSimple<AIO, Parser>::on_connect()
     using namespace ::std::chrono_literals;
 
     socket_connected = true;
+    m_status.timing.connected = Clock::now();
+    record( metrics::registry().connect_latency, m_status.timing.resolve_end, m_status.timing.connected );
+    trace::span( "connect", trace_track, m_status.timing.resolve_end, m_status.timing.connected );
     socket->clear();
     net_timer->template clear<::uvw::TimerEvent>();
     net_timer->stop();
 
-    update_status(State::OnTheGo, "Connected, write request.");
+    request();
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::request()
+{
+    using namespace ::std::chrono_literals;
+
+    update_phase(Phase::Request);
 
     auto self = this->template shared_from_this();
-    socket->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error( "Request failed. " + ErrorEvent2str(err) ); } );
+    socket->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error( Error::Request, err.code() ); } );
     socket->template once<::uvw::WriteEvent>( [self](const auto&, const auto&) { self->on_write_http_request(); } );
-    net_timer->template once<::uvw::TimerEvent>( [self](const auto&, const auto&) { self->on_error("Timeout write request"); } );
+    net_timer->template once<::uvw::TimerEvent>( [self](const auto&, const auto&) { self->on_error(Error::RequestTimeout); } );
 
     auto request = make_request();
     socket->write( std::move(request.first), request.second );
@@ -229,11 +411,13 @@ void DownloaderSimple<AIO, Parser>::on_write_http_request()
     net_timer->template clear<::uvw::TimerEvent>();
     net_timer->stop();
 
-    update_status(State::OnTheGo, "Write request done. Wait response.");
+    m_status.timing.request_written = Clock::now();
+    trace::span( "request", trace_track, m_status.timing.connected, m_status.timing.request_written );
+    update_phase(Phase::Response);
 
     auto self = this->template shared_from_this();
-    socket->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error("Response read failed. " + ErrorEvent2str(err) ); } );
-    socket->template once<::uvw::EndEvent>( [self](const auto&, const auto&) { self->on_error("Connection it`s unexpecdly closed."); } );
+    socket->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&) { self->on_error( Error::ResponseRead, err.code() ); } );
+    socket->template once<::uvw::EndEvent>( [self](const auto&, const auto&) { self->on_error(Error::ConnectionClosed); } );
     socket->template once<::uvw::DataEvent>( [self](auto& event, const auto&)
     {
         self->socket->template clear<::uvw::EndEvent>();
@@ -241,10 +425,15 @@ void DownloaderSimple<AIO, Parser>::on_write_http_request()
 
         auto on_data = std::bind(&DownloaderSimple<AIO, Parser>::on_data, self, _1, _2);
         self->http_parser = Parser::create( std::move(on_data) );
+        self->m_status.phase = Phase::Receive;
+        auto& timing = self->m_status.timing;
+        timing.first_byte = Clock::now();
+        record( metrics::registry().ttfb_latency, timing.request_written, timing.first_byte );
+        trace::span( "wait", self->trace_track, timing.request_written, timing.first_byte );
 
         self->on_read( std::move(event.data), event.length );
     } );
-    net_timer->template once<::uvw::TimerEvent>( [self](const auto&, const auto&) { self->on_error("Timeout read response"); } );
+    net_timer->template once<::uvw::TimerEvent>( [self](const auto&, const auto&) { self->on_error(Error::ResponseTimeout); } );
 
     socket->read();
     if ( m_status.state != State::Failed )
@@ -263,38 +452,71 @@ void DownloaderSimple<AIO, Parser>::on_read(std::unique_ptr<char[]> data, std::s
         return;
 
     m_status.size = result.content_length;
+    m_status.http_status = result.http_status;
+
+    // A source ignoring Range would overwrite the part written before, body is not written yet: the file opens asynchronously
+    if ( range_offset > 0 && result.http_status != 206 && result.redirect_uri.empty() && (result.state == Result::InProgress || result.state == Result::Done) )
+    {
+        on_error( Error::ResponseParse, 0, "Range ignored, status " + std::to_string(result.http_status) );
+        return;
+    }
+    if ( result.headers_complete && !entity_checked && result.redirect_uri.empty() && result.http_status != 304
+         && (result.state == Result::InProgress || result.state == Result::Done) && !check_entity(result) )
+        return;
 
     auto self = this->template shared_from_this();
 
     switch (result.state)
     {
     case Result::InProgress:
+        // Progress is polled by OnTickSimple::sweep, no tick per packet
         socket->template once<::uvw::DataEvent>( [self](auto& event, const auto&) { self->on_read(std::move(event.data), event.length); } );
         net_timer->start(5s, 0s);
-        update_status(State::OnTheGo, "Data received.");
         break;
 
     case Result::Redirect:
-        m_status.redirect_uri = std::move(result.redirect_uri);
+    {
+        auto target = absolute(result.redirect_uri);
+        if ( redirects && (result.http_status == 301 || result.http_status == 308) )
+            redirects->record(uri, target);
+        if ( result.keep_alive && followed < max_follow && follow(target) )
+            break;
+
+        m_status.redirect_uri = std::move(target);
+        if ( trace::enabled() )
+            trace::instant( "redirect", trace_track, m_status.redirect_uri );
         socket->stop();
         close_handles( [self]()
         {
-            self->update_status(State::Redirect, "Redirect to <" + self->m_status.redirect_uri + ">");
+            self->update_status(State::Redirect);
         } );
         break;
+    }
 
     case Result::Done:
+        if (result.http_status == 304)
+        {
+            // The file of the previous run is left as is
+            m_status.size = validator.size;
+            auto& counters = metrics::registry();
+            counters.jobs_not_modified.add();
+            counters.bytes_not_modified.add(validator.size);
+        } else
+        {
+            validator = ValidatorStore::Validator{ std::move(result.etag), std::move(result.last_modified), 0 };
+        }
         receive_done = true;
+        trace::span( "receive", trace_track, m_status.timing.first_byte, Clock::now() );
         socket->stop();
         close_handles( [self]()
         {
             if ( !(self->file_openned) )
-                self->update_status(State::Done, "Downloading complete");
+                self->finish();
         } );
         break;
 
     case Result::Error:
-        on_error("Response parse failed. " + std::move(result.err_str) );
+        on_error( Error::ResponseParse, 0, std::move(result.err_str) );
         break;
     }
 }
@@ -303,10 +525,22 @@ template< typename AIO, typename Parser >
 void DownloaderSimple<AIO, Parser>::on_data(std::unique_ptr<char[]> data, std::size_t length)
 {
     m_status.downloaded += length;
-    buffer.emplace(std::move(data), length);
-    if ( buffer.size() >= backlog && socket->active() )
+    if (stage)
+        unprocessed.emplace(std::move(data), length);
+    else
+        buffer.emplace(std::move(data), length);
+    buffered_bytes += length;
+    auto& counters = metrics::registry();
+    counters.bytes_downloaded.add(length);
+    counters.downloader_buffered_bytes.add( static_cast<std::int64_t>(length) );
+    // Only accounted here, the budget throttles the sockets, which keep draining into this queue
+    if (budget)
+        budget->acquire(length);
+    if ( buffer.size() + unprocessed.size() + (work ? 1 : 0) >= backlog && socket->active() )
         socket->stop();
 
+    process_next();
+
     if (!file)
         open_file(fname);
 
@@ -320,6 +554,12 @@ void DownloaderSimple<AIO, Parser>::on_data(std::unique_ptr<char[]> data, std::s
 template< typename AIO, typename Parser >
 void DownloaderSimple<AIO, Parser>::on_write()
 {
+    if ( buffer.empty() && (work || !unprocessed.empty()) )
+    {
+        // Resumed by on_processed
+        file_operation_started = false;
+        return;
+    }
     if ( buffer.empty() )
     {
         if (receive_done)
@@ -330,15 +570,19 @@ void DownloaderSimple<AIO, Parser>::on_write()
             {
                 self->file_operation_started = false;
                 self->file.reset();
-                self->on_error("File <" + self->fname + "> close error! " + ErrorEvent2str(err) );
+                self->on_error( Error::FileClose, err.code(), self->fname );
             } );
             file->template once<FileCloseEvent>( [self](const auto&, const auto&)
             {
                 self->file_operation_started = false;
                 self->file_openned = false;
                 self->file->clear();
-                if ( !(self->socket_connected) )
-                    self->update_status(State::Done, "Downloading complete");
+                if ( self->socket_connected )
+                    return;
+                if (self->suspending)
+                    self->update_status(State::Suspended);
+                else
+                    self->finish();
             } );
             file->close();
         } else
@@ -356,9 +600,22 @@ void DownloaderSimple<AIO, Parser>::on_write()
         auto self = weak.lock();
         if (self)
         {
+            self->write_pending = false;
+            if (self->storage)
+                self->storage->write_end(event.size);
+            trace::span( "file write", self->trace_track, self->write_start, Clock::now() );
+            auto& counters = metrics::registry();
+            counters.threadpool_requests.sub();
+            counters.downloader_buffered_bytes.sub( static_cast<std::int64_t>(event.size) );
+
             self->offset_file += event.size;
+            self->buffered_bytes -= event.size;
+            if (self->budget)
+                self->budget->release(event.size);
 
             DataChunk& chunk = self->buffer.front();
+            if (self->checksum && !(self->stage))
+                self->checksum->update( chunk.data.get() + chunk.offset, event.size );
             chunk.offset += event.size;
             if (chunk.offset == chunk.length)
                 self->buffer.pop();
@@ -371,21 +628,27 @@ void DownloaderSimple<AIO, Parser>::on_write()
     std::size_t chunk_available = chunk.length - chunk.offset;
     char* chunk_ptr = chunk.data.get() + chunk.offset;
     assert( chunk_available <= std::numeric_limits<unsigned int>::max() );
+    write_pending = true;
+    if (storage)
+        storage->write_begin();
+    metrics::registry().threadpool_requests.add();
+    if ( trace::enabled() )
+        write_start = Clock::now();
     file->write(chunk_ptr, chunk_available, offset_file);
 }
 
 template< typename AIO, typename Parser >
-std::pair<bool, std::string> DownloaderSimple<AIO, Parser>::create_handles()
+StatusDownloader::Error DownloaderSimple<AIO, Parser>::create_handles()
 {
     socket = (uri_parsed->proto == "https") ? factory_socket->tcp_tls() : factory_socket->tcp();
     if (!socket)
-        return std::pair<bool, std::string>{false, "Socket can`t create"};
+        return Error::SocketCreate;
 
     net_timer = loop->template resource<Timer>();
     if (!net_timer)
     {
         socket->close();
-        return std::pair<bool, std::string>{false, "Net timer can`t create"};
+        return Error::TimerCreate;
     }
 
     resolver = loop->template resource<GetAddrInfoReq>();
@@ -393,17 +656,24 @@ std::pair<bool, std::string> DownloaderSimple<AIO, Parser>::create_handles()
     {
         socket->close();
         net_timer->close();
-        return std::pair<bool, std::string>{false, "Resolver can`t create"};
+        return Error::ResolverCreate;
     }
 
-    return std::pair<bool, std::string>{true, ""};
+    return Error::None;
 }
 
 template< typename AIO, typename Parser >
 void DownloaderSimple<AIO, Parser>::terminate_handles()
 {
+    if (budget)
+        budget->release(buffered_bytes);
+    metrics::registry().downloader_buffered_bytes.sub( static_cast<std::int64_t>(buffered_bytes) );
+    buffered_bytes = 0;
+    cancel_work();
+
     if (resolver)
     {
+        resolve_done();
         resolver->clear();
         resolver->cancel();
     }
@@ -420,12 +690,14 @@ void DownloaderSimple<AIO, Parser>::terminate_handles()
     if (file)
     {
         file->clear();
+        abort_write();
         if (file_operation_started)
             file->cancel();
 
         if (file_openned)
         {
-            file->template once<FileCloseEvent>( [fs = loop->template resource<FsReq>(), fname = fname](const auto&, const auto&) { fs->unlink(fname); } );
+            if (!keep_partial)
+                file->template once<FileCloseEvent>( [fs = loop->template resource<FsReq>(), path = file_path](const auto&, const auto&) { fs->unlink(path); } );
             file->close();
         }
     }
@@ -450,18 +722,101 @@ void DownloaderSimple<AIO, Parser>::close_handles(std::function<void()> cb)
     net_timer.reset();
 }
 
+// Location relative to the origin ("/path", "//host/path") is completed from the current URI
+template< typename AIO, typename Parser >
+std::string DownloaderSimple<AIO, Parser>::absolute(const std::string& location) const
+{
+    if ( location.compare(0, 2, "//") == 0 )
+        return uri_parsed->proto + ":" + location;
+    if ( location.empty() || location.front() != '/' )
+        return location;
+
+    const auto authority = uri.find("://");
+    const auto path = uri.find( '/', (authority != std::string::npos) ? authority + 3 : 0 );
+    return uri.substr(0, path) + location;
+}
+
+/* The redirect response is read to the end on a persistent connection:
+ * a target of the same origin is requested on it, without a new lookup, socket and timer */
+template< typename AIO, typename Parser >
+bool DownloaderSimple<AIO, Parser>::follow(const std::string& target)
+{
+    auto parsed = Parser::uri_parse(target);
+    if ( !parsed || parsed->proto != uri_parsed->proto || parsed->host != uri_parsed->host || parsed->port != uri_parsed->port )
+        return false;
+
+    if ( trace::enabled() )
+        trace::instant( "redirect", trace_track, target );
+    followed++;
+    metrics::registry().redirects_followed.add();
+
+    uri = target;
+    uri_parsed = std::move(parsed);
+    if (validators && !keep_partial)
+        conditional = validators->lookup(uri, fname, validator);
+    http_parser.reset();
+    m_status.http_status = 0;
+    m_status.size = 0;
+
+    socket->stop();
+    socket->clear();
+    net_timer->template clear<::uvw::TimerEvent>();
+    request();
+    return true;
+}
+
 template< typename AIO, typename Parser >
 std::pair<std::unique_ptr<char[]>, std::size_t> DownloaderSimple<AIO, Parser>::make_request() const
 {
-    const std::string query = ""
+    std::string query = ""
             "GET " + uri_parsed->query + " HTTP/1.1\r\n"
-            "Host: " + uri_parsed->host + "\r\n"
-            "\r\n";
+            "Host: " + uri_parsed->host + "\r\n";
+    if (range_offset > 0)
+        query += "Range: bytes=" + std::to_string(range_offset) + "-\r\n";
+    else if (conditional)
+    {
+        if ( !validator.etag.empty() )
+            query += "If-None-Match: " + validator.etag + "\r\n";
+        if ( !validator.last_modified.empty() )
+            query += "If-Modified-Since: " + validator.last_modified + "\r\n";
+    }
+    query += "\r\n";
     auto raw_ptr = new char[ query.size() ];
     std::copy( std::begin(query), std::end(query), raw_ptr );
     return std::make_pair( std::unique_ptr<char[]>{raw_ptr}, query.size() );
 }
 
+// A part of another file would be spliced into the parts written before, body is not written yet
+template< typename AIO, typename Parser >
+bool DownloaderSimple<AIO, Parser>::check_entity(const typename Parser::ResponseParseResult& result)
+{
+    entity_checked = true;
+    const bool length_known = result.content_length != std::numeric_limits<std::size_t>::max();
+    m_entity.size = (result.http_status == 206) ? result.range_total : (length_known) ? result.content_length : 0;
+    m_entity.etag = result.etag;
+    m_entity.last_modified = result.last_modified;
+    if (!keep_partial)
+        return true;
+
+    // Weak ETags may differ between servers for the same file
+    const auto strong = [](const std::string& etag) { return !etag.empty() && etag.compare(0, 2, "W/") != 0; };
+    std::string mismatch;
+    if ( range_offset > 0 && !(result.content_range && result.range_start == range_offset) )
+        mismatch = "Content-Range doesn`t start at " + std::to_string(range_offset);
+    else if ( expected.size != 0 && m_entity.size != 0 && expected.size != m_entity.size )
+        mismatch = "size " + std::to_string(m_entity.size) + ", expected " + std::to_string(expected.size);
+    else if ( strong(expected.etag) && strong(m_entity.etag) && expected.etag != m_entity.etag )
+        mismatch = "ETag " + m_entity.etag + ", expected " + expected.etag;
+    else if ( expected.etag.empty() && m_entity.etag.empty() && !expected.last_modified.empty()
+              && !m_entity.last_modified.empty() && expected.last_modified != m_entity.last_modified )
+        mismatch = "Last-Modified " + m_entity.last_modified + ", expected " + expected.last_modified;
+
+    if ( mismatch.empty() )
+        return true;
+    on_error( Error::ResponseParse, 0, "Part of another file, " + mismatch );
+    return false;
+}
+
 template< typename AIO, typename Parser >
 void DownloaderSimple<AIO, Parser>::open_file(const std::string& fname)
 {
@@ -471,7 +826,7 @@ void DownloaderSimple<AIO, Parser>::open_file(const std::string& fname)
     file->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&)
     {
         self->file_operation_started = false;
-        self->on_error("File <" + self->fname + "> can`t open! " + ErrorEvent2str(err) );
+        self->on_error( Error::FileOpen, err.code(), self->fname );
     } );
 
     file->template once<FileOpenEvent>( [self](const auto&, const auto&)
@@ -481,11 +836,241 @@ void DownloaderSimple<AIO, Parser>::open_file(const std::string& fname)
         self->file->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&)
         {
             self->file_operation_started = false;
-            self->on_error("File <" + self->fname + "> write error! " + ErrorEvent2str(err) );
+            self->abort_write();
+            self->on_error( Error::FileWrite, err.code(), self->fname );
         } );
         self->on_write();
     } );
 
     file_operation_started = true;
-    file->open(fname, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP);
+    // A changed file is written to <fname>.part, left over by a crash maybe, the file recorded by the store
+    // stays valid until Done. Any other existing file is an error unless overwrite is set.
+    // A resumed part goes into the file of the previous parts
+    file_path = (conditional && !keep_partial) ? fname + ".part" : fname;
+    const int exclusive = (keep_partial) ? 0 : (conditional || overwrite) ? O_TRUNC : O_EXCL;
+    file->open(file_path, O_CREAT | exclusive | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP);
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::abort_write()
+{
+    if (write_pending)
+    {
+        write_pending = false;
+        if (storage)
+            storage->write_abort();
+        metrics::registry().threadpool_requests.sub();
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::process_next()
+{
+    if ( work || unprocessed.empty() )
+        return;
+
+    // One chunk in flight keeps the order, the stage state is touched by one thread at a time
+    DataChunk& front = unprocessed.front();
+    auto chunk = std::make_shared<DataChunk>( std::move(front.data), front.length, front.offset );
+    unprocessed.pop();
+
+    work = loop->template resource<WorkReq>( [stage = stage, chunk]() { stage->process(*chunk); } );
+    if (!work)
+    {
+        // Threadpool unavailable, the loop does the work
+        stage->process(*chunk);
+        on_processed(*chunk);
+        return;
+    }
+
+    std::weak_ptr<DownloaderSimple> weak{ this->template shared_from_this() };
+    work->template once<::uvw::WorkEvent>( [weak, chunk](const auto&, const auto&)
+    {
+        auto self = weak.lock();
+        if (self)
+        {
+            self->work->clear();
+            self->work.reset();
+            metrics::registry().threadpool_requests.sub();
+            self->on_processed(*chunk);
+        }
+    } );
+
+    metrics::registry().threadpool_requests.add();
+    work->queue();
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::on_processed(DataChunk& chunk)
+{
+    buffer.emplace( std::move(chunk.data), chunk.length, chunk.offset );
+    process_next();
+    if (file_openned && !file_operation_started)
+    {
+        file_operation_started = true;
+        on_write();
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::cancel_work()
+{
+    // Work already running completes anyway, the chunk is dropped with it
+    if (work)
+    {
+        work->clear();
+        work->cancel();
+        work.reset();
+        metrics::registry().threadpool_requests.sub();
+    }
+    unprocessed = std::queue<DataChunk>{};
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::resolve_done()
+{
+    if (resolve_pending)
+    {
+        resolve_pending = false;
+        metrics::registry().threadpool_requests.sub();
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::count_finished(State state)
+{
+    if (!running_counted)
+        return;
+
+    running_counted = false;
+    auto& counters = metrics::registry();
+    counters.jobs_running.sub();
+    trace::span( "job", trace_track, m_status.timing.resolve_start, Clock::now() );
+    switch (state)
+    {
+    case State::Done:
+    {
+        counters.jobs_done.add();
+        auto& timing = m_status.timing;
+        timing.done = Clock::now();
+        record( counters.transfer_duration, timing.first_byte, timing.done );
+        record( counters.total_duration, timing.resolve_start, timing.done );
+        break;
+    }
+    case State::Redirect:
+        counters.jobs_redirect.add();
+        break;
+    case State::Suspended:
+        break;
+    default:
+        counters.jobs_failed.add();
+        break;
+    }
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::store_validator()
+{
+    if (!validators || m_status.http_status == 304)
+        return;
+    validator.size = m_status.downloaded;
+    validators->record(uri, validator);
+}
+
+// A corrupted file is removed, a part of a mirrored download is left to DownloaderMirrored
+template< typename AIO, typename Parser >
+bool DownloaderSimple<AIO, Parser>::verify_checksum()
+{
+    if (!checksum || m_status.http_status == 304)
+        return true;
+
+    if ( !checksum->verify() )
+    {
+        metrics::registry().checksum_failures.add();
+        if (!keep_partial)
+        {
+            auto fs = loop->template resource<FsReq>();
+            if (fs)
+                fs->unlink(file_path);
+        }
+        on_error( Error::Checksum, 0, "<" + fname + "> " + checksum->name() + " " + checksum->hex() + ", expected " + checksum->expected_hex() );
+        return false;
+    }
+    return true;
+}
+
+// A verified part replaces the file of the previous run, which is left as is on failure
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::finish()
+{
+    if ( !verify_checksum() )
+        return;
+    if ( file_path.empty() || file_path == fname )
+    {
+        write_sidecar();
+        return;
+    }
+
+    auto fs = loop->template resource<FsReq>();
+    if (!fs)
+    {
+        on_error( Error::FileClose, 0, fname );
+        return;
+    }
+    auto self = this->template shared_from_this();
+    fs->template once<::uvw::ErrorEvent>( [self](const auto& err, const auto&)
+    {
+        auto unlink = self->loop->template resource<FsReq>();
+        if (unlink)
+            unlink->unlink(self->file_path);
+        self->on_error( Error::FileClose, err.code(), self->fname );
+    } );
+    fs->template once<FsRenameEvent>( [self](const auto&, const auto&) { self->write_sidecar(); } );
+    fs->rename(file_path, fname);
+}
+
+// The digest file is written on the threadpool, the job is Done after it
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::write_sidecar()
+{
+    if ( !checksum || m_status.http_status == 304 || !checksum->sidecar() )
+    {
+        update_status(State::Done);
+        return;
+    }
+
+    checksum->hex();
+    auto written = std::make_shared<bool>(false);
+    work = loop->template resource<WorkReq>( [checksum = checksum, fname = fname, written]() { *written = checksum->write(fname); } );
+    if (!work)
+    {
+        // Threadpool unavailable, the loop does the work
+        on_sidecar_written( checksum->write(fname) );
+        return;
+    }
+
+    std::weak_ptr<DownloaderSimple> weak{ this->template shared_from_this() };
+    work->template once<::uvw::WorkEvent>( [weak, written](const auto&, const auto&)
+    {
+        auto self = weak.lock();
+        if (self)
+        {
+            self->work->clear();
+            self->work.reset();
+            metrics::registry().threadpool_requests.sub();
+            self->on_sidecar_written(*written);
+        }
+    } );
+
+    metrics::registry().threadpool_requests.add();
+    work->queue();
+}
+
+template< typename AIO, typename Parser >
+void DownloaderSimple<AIO, Parser>::on_sidecar_written(bool written)
+{
+    if (written)
+        update_status(State::Done);
+    else
+        on_error( Error::FileWrite, 0, fname + "." + checksum->name() );
 }
@@ -10,6 +10,11 @@ class Factory
 {
 public:
     virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri, const std::string& fname) = 0;
+    // Expected digest of the file, "<algorithm>:<hex>"
+    virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri, const std::string& fname, const std::string& /*digest*/)
+    {
+        return create(job_id, uri, fname);
+    }
     virtual void set_OnTick(std::shared_ptr<OnTick>) = 0;
     virtual ~Factory() = default;
 };
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "factory.h"
+#include "on_tick.h"
+#include "dashboard.h"
+#include "object_cache.h"
+#include "validator_store.h"
+#include "checksum.h"
+#include "downloader_cached.h"
+#include "metrics.h"
+
+#include <uvw/work.hpp>
+
+#include <unordered_map>
+#include <deque>
+
+/* Decorator of a Factory. A job whose URI is in ObjectCache is satisfied from it, provided the output
+ * file does not exist yet and the entry agrees with the validators recorded for the URI (when a store is given).
+ * Downloads of the inner factory are stored into the cache on the threadpool once done, at most <max_ingests>
+ * at a time, so that copies into the cache don`t take the threadpool from file writes.
+ * The inner downloaders report to OnTick through this factory. */
+template< typename AIO >
+class FactoryCached : public Factory, public std::enable_shared_from_this< FactoryCached<AIO> >
+{
+    using Loop = typename AIO::Loop;
+    using WorkReq = typename AIO::WorkReq;
+
+public:
+    FactoryCached(std::shared_ptr<Loop> loop_, Dashboard& dashboard_, std::shared_ptr<Factory> inner_, std::shared_ptr<ObjectCache> cache_, std::shared_ptr<ValidatorStore> validators_ = nullptr, std::string digest_files_ = std::string{}, std::size_t max_ingests_ = 2)
+        : loop{ std::move(loop_) },
+          dashboard{dashboard_},
+          inner{ std::move(inner_) },
+          cache{ std::move(cache_) },
+          validators{ std::move(validators_) },
+          digest_files{ std::move(digest_files_) },
+          max_ingests{max_ingests_},
+          bypass{ std::make_shared<typename DownloaderCached<AIO>::Bypass>() }
+    {}
+
+    virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri, const std::string& fname) override
+    {
+        return create( job_id, uri, fname, std::string{} );
+    }
+
+    virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri, const std::string& fname, const std::string& digest) override
+    {
+        ObjectCache::Entry entry;
+        if ( lookup(uri, fname, digest, entry) )
+        {
+            std::shared_ptr<Checksum> checksum;
+            if ( !digest_files.empty() )
+                checksum = Checksum::parse( (digest.empty()) ? digest_files : digest, true );
+            auto downloader = std::make_shared< DownloaderCached<AIO> >(loop, on_tick, cache, entry, bypass, std::move(checksum));
+            if ( downloader->run(uri, fname) )
+            {
+                dashboard.update(job_id, downloader->status());
+                return downloader;
+            }
+        }
+
+        auto downloader = inner->create(job_id, uri, fname, digest);
+        if (downloader)
+            downloads.emplace( downloader.get(), Download{uri, fname} );
+        return downloader;
+    }
+
+    virtual void set_OnTick(std::shared_ptr<OnTick> on_tick_) override
+    {
+        on_tick = std::move(on_tick_);
+        inner->set_OnTick( std::make_shared<Relay>(this->shared_from_this(), on_tick) );
+    }
+
+    FactoryCached() = delete;
+    FactoryCached(const FactoryCached&) = delete;
+    FactoryCached(FactoryCached&&) = delete;
+    FactoryCached& operator= (const FactoryCached&) = delete;
+    FactoryCached& operator= (FactoryCached&&) = delete;
+
+    virtual ~FactoryCached() = default;
+
+private:
+    struct Download
+    {
+        std::string uri;
+        std::string fname;
+    };
+
+    /* Holds the factory weakly: inner downloaders keep reporting to OnTick after the factory is released */
+    class Relay final : public OnTick
+    {
+    public:
+        Relay(std::weak_ptr<FactoryCached> factory_, std::shared_ptr<OnTick> target_)
+            : factory{ std::move(factory_) },
+              target{ std::move(target_) }
+        {}
+
+        virtual void invoke(std::shared_ptr<Downloader> downloader) override
+        {
+            // Before the target, it may release the downloader and reuse its address
+            if ( auto f = factory.lock() )
+                f->finished(*downloader);
+            target->invoke( std::move(downloader) );
+        }
+
+    private:
+        std::weak_ptr<FactoryCached> factory;
+        std::shared_ptr<OnTick> target;
+    };
+
+    std::shared_ptr<Loop> loop;
+    Dashboard& dashboard;
+    std::shared_ptr<Factory> inner;
+    std::shared_ptr<ObjectCache> cache;
+    std::shared_ptr<ValidatorStore> validators;
+    // Algorithm of digest files, written for cache hits as FactorySimple does for downloads
+    const std::string digest_files;
+    const std::size_t max_ingests;
+    std::shared_ptr<OnTick> on_tick;
+
+    std::unordered_map<const Downloader*, Download> downloads;
+    // Done downloads waiting for the threadpool
+    std::deque<Download> ingests;
+    std::size_t ingesting = 0;
+    // Output files found existing by DownloaderCached, their jobs go to the inner factory once
+    std::shared_ptr<typename DownloaderCached<AIO>::Bypass> bypass;
+
+    bool lookup(const std::string& uri, const std::string& fname, const std::string& digest, ObjectCache::Entry& entry)
+    {
+        auto& counters = metrics::registry();
+        if ( bypass->erase(fname) > 0 || !cache->find(uri, entry) )
+        {
+            counters.cache_misses.add();
+            return false;
+        }
+
+        // Objects are named by SHA-256, other digests are checked by the download
+        if ( !digest.empty() )
+        {
+            auto checksum = Checksum::parse(digest);
+            if ( !checksum || checksum->name() != std::string{"sha256"} || checksum->expected_hex() != entry.hash )
+            {
+                counters.cache_misses.add();
+                return false;
+            }
+        }
+
+        ValidatorStore::Validator validator;
+        if ( validators && validators->find(uri, validator)
+             && (validator.etag != entry.validator.etag || validator.last_modified != entry.validator.last_modified) )
+        {
+            cache->forget(uri);
+            counters.cache_misses.add();
+            return false;
+        }
+        return true;
+    }
+
+    void finished(const Downloader& downloader)
+    {
+        using State = StatusDownloader::State;
+
+        const auto& status = downloader.status();
+        if (status.state == State::Init || status.state == State::OnTheGo)
+            return;
+        auto it = downloads.find(&downloader);
+        if ( it == downloads.end() )
+            return;
+        auto download = std::move(it->second);
+        downloads.erase(it);
+
+        ObjectCache::Entry entry;
+        if ( status.state != State::Done || (status.http_status == 304 && cache->find(download.uri, entry)) )
+            return;
+        ingest( std::move(download) );
+    }
+
+    void ingest(Download download)
+    {
+        ingests.push_back( std::move(download) );
+        ingest_next();
+    }
+
+    void ingest_next()
+    {
+        while ( ingesting < max_ingests && !ingests.empty() )
+        {
+            auto download = std::move( ingests.front() );
+            ingests.pop_front();
+
+            auto entry = std::make_shared<ObjectCache::Entry>();
+            auto stored = std::make_shared<bool>(false);
+            auto work = loop->template resource<WorkReq>( [cache = cache, fname = download.fname, entry, stored]()
+            {
+                *stored = cache->store(fname, *entry);
+            } );
+            if (!work)
+                continue;
+
+            // Results are applied on the loop, even after the factory is released. Queued ones are dropped with it
+            std::weak_ptr<FactoryCached> weak = this->shared_from_this();
+            work->template once<::uvw::ErrorEvent>( [weak](const auto&, const auto&)
+            {
+                metrics::registry().threadpool_requests.sub();
+                if ( auto self = weak.lock() )
+                    self->ingested();
+            } );
+            work->template once<::uvw::WorkEvent>( [weak, cache = cache, validators = validators, uri = std::move(download.uri), entry, stored](const auto&, const auto&)
+            {
+                metrics::registry().threadpool_requests.sub();
+                if (*stored)
+                {
+                    ValidatorStore::Validator validator;
+                    if ( validators && validators->find(uri, validator) && validator.size == entry->validator.size )
+                    {
+                        entry->validator.etag = validator.etag;
+                        entry->validator.last_modified = validator.last_modified;
+                    }
+                    cache->insert(uri, *entry);
+                }
+                if ( auto self = weak.lock() )
+                    self->ingested();
+            } );
+            ingesting++;
+            metrics::registry().threadpool_requests.add();
+            work->queue();
+        }
+    }
+
+    void ingested()
+    {
+        ingesting--;
+        ingest_next();
+    }
+};
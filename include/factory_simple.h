@@ -3,22 +3,59 @@
 #include "factory.h"
 #include "dashboard.h"
 #include "aio/factory_tcp.h"
+#include "aio/memory.h"
+#include "aio/storage.h"
+#include "validator_store.h"
+#include "redirect_cache.h"
+#include "checksum.h"
+#include "metrics.h"
 #include "downloader_simple.h"
+#include "downloader_mirrored.h"
+#include "mirror_rates.h"
+#include "aio/bandwidth.h"
 #include "aio_uvw.h"
 #include "http.h"
 
 class FactorySimple : public Factory
 {
 public:
-    FactorySimple(std::shared_ptr<AIO_UVW::Loop> loop_, Dashboard& dashboard_, std::shared_ptr<aio::FactoryTCPSocket> factory_socket_)
+    FactorySimple(std::shared_ptr<AIO_UVW::Loop> loop_, Dashboard& dashboard_, std::shared_ptr<aio::FactoryTCPSocket> factory_socket_, std::shared_ptr<aio::memory::Budget> budget_ = nullptr, std::shared_ptr<aio::storage::Estimator> storage_ = nullptr, std::shared_ptr<ValidatorStore> validators_ = nullptr, std::shared_ptr<RedirectCache> redirects_ = nullptr, std::string digest_files_ = std::string{}, bool overwrite_ = false)
         : loop{ std::move(loop_) },
           dashboard{dashboard_},
-          factory_socket{ std::move(factory_socket_) }
+          factory_socket{ std::move(factory_socket_) },
+          budget{ std::move(budget_) },
+          storage{ std::move(storage_) },
+          validators{ std::move(validators_) },
+          redirects{ std::move(redirects_) },
+          digest_files{ std::move(digest_files_) },
+          overwrite{overwrite_},
+          rates{ std::make_shared<MirrorRates>() }
     {}
 
     virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri, const std::string& fname) override
     {
-        auto downloader = std::make_shared< DownloaderSimple<AIO_UVW, HttpParser> >(loop, on_tick, factory_socket);
+        return create( job_id, uri, fname, std::string{} );
+    }
+
+    virtual std::shared_ptr<Downloader> create(std::size_t job_id, const std::string& uri_, const std::string& fname, const std::string& digest) override
+    {
+        std::shared_ptr<Checksum> checksum;
+        if ( !make_checksum(digest, checksum) )
+        {
+            StatusDownloader status;
+            status.state = StatusDownloader::State::Failed;
+            status.error = StatusDownloader::Error::Checksum;
+            status.detail = "invalid digest <" + digest + ">";
+            metrics::registry().jobs_failed.add();
+            dashboard.update(job_id, status);
+            return nullptr;
+        }
+
+        const auto uri = resolve(uri_);
+        if (uri.find('|') != std::string::npos)
+            return create_mirrored(job_id, uri, fname, std::move(checksum));
+
+        auto downloader = std::make_shared< DownloaderSimple<AIO_UVW, HttpParser> >(loop, on_tick, factory_socket, 10, budget, storage, validators, redirects, std::move(checksum), overwrite);
         bool runned = downloader->run(uri, fname);
         dashboard.update(job_id, downloader->status());
         return (runned) ? downloader : nullptr;
@@ -37,5 +74,59 @@ private:
     std::shared_ptr<AIO_UVW::Loop> loop;
     Dashboard& dashboard;
     std::shared_ptr<aio::FactoryTCPSocket> factory_socket;
+    std::shared_ptr<aio::memory::Budget> budget;
+    std::shared_ptr<aio::storage::Estimator> storage;
+    std::shared_ptr<ValidatorStore> validators;
+    std::shared_ptr<RedirectCache> redirects;
+    const std::string digest_files;
+    // Existing output files are replaced, set when the journal resumes a run
+    const bool overwrite;
+    std::shared_ptr<MirrorRates> rates;
     std::shared_ptr<OnTick> on_tick;
+
+    // Expected digest of the task, or the algorithm of digest files to compute. False if the digest is malformed
+    bool make_checksum(const std::string& digest, std::shared_ptr<Checksum>& checksum) const
+    {
+        const bool sidecar = !digest_files.empty();
+        if ( digest.empty() )
+        {
+            if (sidecar)
+                checksum = Checksum::parse(digest_files, true);
+            return true;
+        }
+        checksum = Checksum::parse(digest, sidecar);
+        return checksum != nullptr;
+    }
+
+    // Permanent redirects recorded before are skipped, for each mirror on its own
+    std::string resolve(const std::string& uri) const
+    {
+        if (!redirects || uri.empty())
+            return uri;
+
+        std::string resolved;
+        for (const auto& mirror : DownloaderMirrored<AIO_UVW, HttpParser>::split(uri))
+        {
+            std::string target;
+            if ( redirects->find(mirror, target) )
+                metrics::registry().redirects_cached.add();
+            else
+                target = mirror;
+            resolved += (resolved.empty()) ? target : "|" + target;
+        }
+        return resolved;
+    }
+
+    std::shared_ptr<Downloader> create_mirrored(std::size_t job_id, const std::string& uri, const std::string& fname, std::shared_ptr<Checksum> checksum)
+    {
+        // Parts are written one after another, the sources feed one checksum
+        auto source = [loop = loop, factory_socket = factory_socket, budget = budget, storage = storage, redirects = redirects, checksum, overwrite = overwrite](std::shared_ptr<OnTick> relay)
+        {
+            return std::make_shared< DownloaderSimple<AIO_UVW, HttpParser> >(loop, std::move(relay), factory_socket, 10, budget, storage, nullptr, redirects, checksum, overwrite);
+        };
+        auto downloader = std::make_shared< DownloaderMirrored<AIO_UVW, HttpParser> >( loop, on_tick, std::move(source), rates, std::make_unique<aio::bandwidth::Time>() );
+        bool runned = downloader->run(uri, fname);
+        dashboard.update(job_id, downloader->status());
+        return (runned) ? downloader : nullptr;
+    }
 };
@@ -28,8 +28,19 @@ public:
         enum class State { InProgress, Done, Redirect, Error };
         State state;
         std::string redirect_uri;
+        // Redirect response is read to the end and the connection stays open
+        bool keep_alive = false;
         std::string err_str;
         std::size_t content_length;
+        unsigned int http_status = 0;
+        std::string etag;
+        std::string last_modified;
+        // Set with the fields above once the headers are parsed
+        bool headers_complete = false;
+        // Content-Range of a 206: first byte of the part and size of the whole file, 0 - unknown ("*")
+        bool content_range = false;
+        std::size_t range_start = 0;
+        std::size_t range_total = 0;
     };
 
     const ResponseParseResult response_parse(std::unique_ptr<char[]>, std::size_t);
@@ -81,6 +92,8 @@ private:
     static int on_body(http_parser*, const char*, std::size_t);
     static int on_message_complete(http_parser*);
     void stop(ResponseParseResult::State);
+    std::string header(const std::string& name) const;
+    void parse_content_range(const std::string&);
 
 public:
     HttpParser() = delete;
@@ -9,15 +9,18 @@ class Job
 public:
     template< typename String,
               typename = std::enable_if_t< std::is_convertible<String, std::string>::value, String> >
-    Job(String&& fname_)
+    Job(String&& fname_, std::size_t line_ = 0)
         : id{ generate_id() },
           fname{ std::forward<String>(fname_) },
+          line{line_},
           redirect_count{0}
     {}
 
     const std::size_t id;
     const std::string fname;
+    const std::size_t line;
     std::size_t redirect_count;
+    std::string digest;
     std::shared_ptr<Downloader> downloader;
 
     Job() = delete;
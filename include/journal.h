@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+/* Terminal states of tasks keyed by task line number */
+class Journal
+{
+public:
+    virtual bool completed(std::size_t line) const noexcept = 0;
+    virtual void record(std::size_t line, bool success) = 0;
+    virtual ~Journal() = default;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "journal.h"
+#include "buffered_log.h"
+#include "append_log.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+/* Append-only text journal, one record per line: "<task line> D|F".
+ * Records are buffered and written with fdatasync() every <batch> records or
+ * once per <interval>, a crash loses at most the last unsynced batch.
+ * With set_OnDue() the owner writes instead (JournalWriter, off the loop and on a timer):
+ * record() only reports a full batch, take() and write() split flush(), put_back() returns a failed write.
+ * A record torn by crash at the end of file is cut off on load. */
+class JournalSimple final : public Journal, public BufferedLog
+{
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit JournalSimple(const std::string& fname, std::size_t batch_ = 256, std::chrono::milliseconds interval_ = std::chrono::milliseconds{1000});
+
+    virtual bool completed(std::size_t line) const noexcept override
+    {
+        return line < done.size() && done[line];
+    }
+    virtual void record(std::size_t line, bool success) override;
+    void flush();
+
+    virtual void set_OnDue(std::function<void()> cb) override { on_due = std::move(cb); }
+    virtual std::chrono::milliseconds flush_interval() const noexcept override { return interval; }
+    virtual std::string take() override;
+    virtual void put_back(std::string) override;
+    virtual bool write(const std::string&) const noexcept override;
+
+    std::size_t loaded() const noexcept { return loaded_count; }
+
+    JournalSimple() = delete;
+    JournalSimple(const JournalSimple&) = delete;
+    JournalSimple(JournalSimple&&) = delete;
+    JournalSimple& operator= (const JournalSimple&) = delete;
+    JournalSimple& operator= (JournalSimple&&) = delete;
+
+    virtual ~JournalSimple();
+
+private:
+    const std::size_t batch;
+    const std::chrono::milliseconds interval;
+
+    AppendLog log;
+    std::vector<bool> done;
+    std::size_t loaded_count = 0;
+
+    std::string pending;
+    std::size_t pending_count = 0;
+    Clock::time_point last_flush;
+    std::function<void()> on_due;
+
+    void load(const std::string&);
+    void mark(std::size_t line);
+};
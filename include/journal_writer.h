@@ -0,0 +1,49 @@
+#pragma once
+
+#include "buffered_log.h"
+#include "aio_uvw.h"
+
+#include <memory>
+#include <string>
+
+/* Writes the records of a BufferedLog (the journal, the validator store) off the loop: write and fdatasync
+ * run on the threadpool when a batch is full or the flush interval has passed, whichever comes first.
+ * One write at a time keeps the records in order, a failed one is put back and retried.
+ * The log must outlive the loop run, records left after close() are written by its flush(). */
+class JournalWriter final : public std::enable_shared_from_this<JournalWriter>
+{
+    using Loop = AIO_UVW::Loop;
+
+public:
+    JournalWriter(std::shared_ptr<Loop> loop_, BufferedLog& log_, std::string name_ = "Journal")
+        : loop{ std::move(loop_) },
+          log{log_},
+          name{ std::move(name_) }
+    {}
+
+    void start();
+    // Stops the timer, a write in flight completes
+    void close();
+
+    JournalWriter() = delete;
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter(JournalWriter&&) = delete;
+    JournalWriter& operator= (const JournalWriter&) = delete;
+    JournalWriter& operator= (JournalWriter&&) = delete;
+
+    ~JournalWriter() = default;
+
+private:
+    std::shared_ptr<Loop> loop;
+    BufferedLog& log;
+    // Of the log in the warning on a failed write
+    const std::string name;
+    std::shared_ptr<AIO_UVW::TimerHandle> timer;
+
+    bool writing = false;
+    bool again = false;
+    bool failed = false;
+
+    void write();
+    void on_written(bool, const std::shared_ptr<std::string>&);
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace metrics {
+
+/* Process-wide lock-free counters. Writers use relaxed atomics only,
+ * a reader (Prometheus endpoint) may see a slightly inconsistent snapshot. */
+
+class Counter
+{
+public:
+    void add(std::uint64_t n = 1) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> m_value{0};
+};
+
+class Gauge
+{
+public:
+    void add(std::int64_t n = 1) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    void sub(std::int64_t n = 1) noexcept { m_value.fetch_sub(n, std::memory_order_relaxed); }
+    void set(std::int64_t n) noexcept { m_value.store(n, std::memory_order_relaxed); }
+    std::int64_t value() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> m_value{0};
+};
+
+/* HDR-style latency histogram in microseconds: values below 128 are exact, above that
+ * each power of two is split into 64 linear sub-buckets (relative error < 1/64).
+ * Values are clamped to 2^37 us (about 38 hours). Recording is one relaxed atomic increment per field. */
+class LatencyHistogram
+{
+public:
+    enum : std::size_t { sub_buckets = 128, half = sub_buckets / 2, max_exponent = 30 };
+    enum : std::size_t { bucket_count = sub_buckets + max_exponent * half };
+
+    void record(std::chrono::microseconds duration) noexcept
+    {
+        auto us = static_cast<std::uint64_t>( duration.count() > 0 ? duration.count() : 0 );
+        if (us >= (std::uint64_t{sub_buckets} << max_exponent))
+            us = (std::uint64_t{sub_buckets} << max_exponent) - 1;
+        buckets[ index(us) ].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    // Highest value equivalent to the bucket holding the q-th quantile (0 < q <= 1), 0 if empty
+    std::uint64_t percentile(double q) const noexcept;
+
+    std::uint64_t count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+    std::uint64_t sum_us() const noexcept { return m_sum.load(std::memory_order_relaxed); }
+
+    static std::size_t index(std::uint64_t us) noexcept
+    {
+        if (us < sub_buckets)
+            return static_cast<std::size_t>(us);
+        std::size_t exponent = 0;
+        while ( (us >> exponent) >= sub_buckets )
+            exponent++;
+        return sub_buckets + (exponent - 1) * half + static_cast<std::size_t>( (us >> exponent) - half );
+    }
+    static std::uint64_t highest_equivalent(std::size_t i) noexcept
+    {
+        if (i < sub_buckets)
+            return i;
+        const std::size_t exponent = (i - sub_buckets) / half + 1;
+        const std::uint64_t sub = (i - sub_buckets) % half + half;
+        return ((sub + 1) << exponent) - 1;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+    std::atomic<std::uint64_t> m_count{0};
+    std::atomic<std::uint64_t> m_sum{0};
+};
+
+struct Registry
+{
+    // DownloaderSimple
+    Counter bytes_downloaded;
+    Counter jobs_done;
+    Counter jobs_failed;
+    Counter jobs_redirect;
+    Counter jobs_not_modified;
+    Counter bytes_not_modified;
+    Gauge jobs_running;
+    LatencyHistogram resolve_latency;
+    LatencyHistogram connect_latency;
+    LatencyHistogram ttfb_latency;
+    LatencyHistogram transfer_duration;
+    LatencyHistogram total_duration;
+    Gauge downloader_buffered_bytes;
+    Gauge threadpool_requests;
+    Counter redirects_followed;
+    Counter checksum_failures;
+
+    // FactorySimple
+    Counter redirects_cached;
+
+    // DownloaderMirrored
+    Counter mirror_switches;
+
+    // FactoryCached, DownloaderCached
+    Counter cache_hits;
+    Counter cache_misses;
+    Counter cache_bytes_saved;
+
+    // TCPSocketBandwidth
+    Counter socket_received_bytes;
+    Gauge socket_buffered_bytes;
+    Counter socket_throttled;
+
+    // BudgetSimple
+    Gauge memory_used;
+    Gauge memory_peak;
+    Gauge memory_limit;
+
+    // ControllerSimple
+    Counter bandwidth_cycles;
+    Counter bandwidth_deferred;
+    Counter bandwidth_granted_bytes;
+    Gauge bandwidth_effective_limit;
+};
+
+// Header-only, so header-only templates (ControllerSimple, DownloaderSimple) can use it
+inline Registry& registry() noexcept
+{
+    static Registry instance;
+    return instance;
+}
+
+void write_prometheus(std::ostream&, const Registry&);
+// Human readable p50/p99/p999 table of phase latencies, for the final summary
+void write_latency_summary(std::ostream&, const Registry&);
+
+} // namespace metrics
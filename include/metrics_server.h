@@ -0,0 +1,198 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <uvw/tcp.hpp>
+#include <uvw/timer.hpp>
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+
+namespace metrics {
+
+// Complete HTTP/1.0 response for a raw request head: registry in Prometheus text format on GET /metrics, 404 otherwise
+std::string http_response(const std::string& request, const Registry&);
+
+/* Minimal HTTP listener on the download loop. A connection is served once the request head
+ * is received, then closed; scrapes are rare and small, no keep-alive or pipelining.
+ * A client silent for timeout is dropped, close() drops all of them: the loop must be able to end. */
+template< typename AIO >
+class Server final : public std::enable_shared_from_this< Server<AIO> >
+{
+    using Loop = typename AIO::Loop;
+    using TcpHandle = typename AIO::TcpHandle;
+    using TimerHandle = typename AIO::TimerHandle;
+
+    struct ConstructorAccess { explicit ConstructorAccess(int) {} };
+
+public:
+    static constexpr std::size_t max_request = 8192;
+    static constexpr std::chrono::milliseconds::rep timeout_ms = 5000;
+
+    Server(ConstructorAccess, std::shared_ptr<Loop> loop_)
+        : loop{ std::move(loop_) }
+    {}
+    static std::shared_ptr<Server> create(std::shared_ptr<Loop>, const std::string& ip, unsigned int port);
+
+    void close();
+
+    Server() = delete;
+    Server(const Server&) = delete;
+    Server(Server&&) = delete;
+    Server& operator= (const Server&) = delete;
+    Server& operator= (Server&&) = delete;
+
+    ~Server() = default;
+
+private:
+    struct Client
+    {
+        std::shared_ptr<TcpHandle> handle;
+        std::shared_ptr<TimerHandle> timer;
+    };
+
+    std::shared_ptr<Loop> loop;
+    std::shared_ptr<TcpHandle> listener;
+    std::unordered_map<const TcpHandle*, Client> clients;
+
+    void on_connection();
+    void reply(const TcpHandle*, const std::string&);
+    void drop(const TcpHandle*);
+};
+
+/* Implementation */
+
+template< typename AIO >
+constexpr std::size_t Server<AIO>::max_request;
+
+template< typename AIO >
+constexpr std::chrono::milliseconds::rep Server<AIO>::timeout_ms;
+
+template< typename AIO >
+std::shared_ptr< Server<AIO> > Server<AIO>::create(std::shared_ptr<Loop> loop, const std::string& ip, unsigned int port)
+{
+    auto self = std::make_shared<Server>( ConstructorAccess{42}, loop );
+    self->listener = loop->template resource<TcpHandle>();
+    if (!self->listener)
+        throw std::runtime_error{"metrics::Server<AIO>: AIO::TcpHandle can`t create!"};
+
+    // Metrics are optional, a failed listener must not break the downloads
+    self->listener->template once<::uvw::ErrorEvent>( [](const auto& err, auto& handle)
+    {
+        std::cerr << "Metrics listener error: " << err.what() << std::endl;
+        handle.close();
+    } );
+    std::weak_ptr<Server> weak = self;
+    self->listener->template on<::uvw::ListenEvent>( [weak](const auto&, const auto&)
+    {
+        auto self = weak.lock();
+        if (self)
+            self->on_connection();
+    } );
+
+    self->listener->bind(ip, port);
+    self->listener->listen();
+    return self;
+}
+
+template< typename AIO >
+void Server<AIO>::close()
+{
+    if (listener)
+    {
+        listener->clear();
+        listener->close();
+        listener.reset();
+    }
+    while ( !clients.empty() )
+        drop( clients.begin()->first );
+}
+
+template< typename AIO >
+void Server<AIO>::on_connection()
+{
+    auto client = loop->template resource<TcpHandle>();
+    if (!client)
+        return;
+    auto timer = loop->template resource<TimerHandle>();
+    if (!timer)
+    {
+        client->close();
+        return;
+    }
+
+    listener->accept(*client);
+
+    const TcpHandle* key = client.get();
+    clients.emplace( key, Client{client, timer} );
+    std::weak_ptr<Server> weak = this->shared_from_this();
+    auto drop = [weak, key](const auto&, const auto&)
+    {
+        auto self = weak.lock();
+        if (self)
+            self->drop(key);
+    };
+
+    timer->template once<::uvw::TimerEvent>(drop);
+    timer->start( std::chrono::milliseconds{timeout_ms}, std::chrono::milliseconds{0} );
+
+    auto request = std::make_shared<std::string>();
+    client->template once<::uvw::ErrorEvent>(drop);
+    client->template once<::uvw::EndEvent>(drop);
+    client->template on<::uvw::DataEvent>( [request, weak, key](const auto& event, auto& handle)
+    {
+        auto self = weak.lock();
+        if (!self)
+            return;
+
+        request->append(event.data.get(), event.length);
+        if (request->find("\r\n\r\n") != std::string::npos || request->find("\n\n") != std::string::npos || request->size() > max_request)
+        {
+            handle.stop();
+            handle.template clear<::uvw::DataEvent>();
+            self->reply( key, http_response(*request, registry()) );
+        }
+    } );
+    client->read();
+}
+
+template< typename AIO >
+void Server<AIO>::reply(const TcpHandle* key, const std::string& response)
+{
+    auto it = clients.find(key);
+    if ( it == clients.end() )
+        return;
+
+    auto data = std::make_unique<char[]>( response.size() );
+    std::copy( std::begin(response), std::end(response), data.get() );
+    std::weak_ptr<Server> weak = this->shared_from_this();
+    it->second.handle->template once<::uvw::WriteEvent>( [weak, key](const auto&, const auto&)
+    {
+        auto self = weak.lock();
+        if (self)
+            self->drop(key);
+    } );
+    it->second.handle->write( std::move(data), static_cast<unsigned int>(response.size()) );
+}
+
+template< typename AIO >
+void Server<AIO>::drop(const TcpHandle* key)
+{
+    auto it = clients.find(key);
+    if ( it == clients.end() )
+        return;
+
+    auto client = std::move(it->second);
+    clients.erase(it);
+    client.timer->clear();
+    client.timer->close();
+    client.handle->clear();
+    client.handle->close();
+}
+
+} // namespace metrics
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+/* Throughput of hosts measured by the jobs so far, shared between mirrored downloads.
+ * Exponentially weighted moving average, a failure counts as zero rate. */
+class MirrorRates
+{
+public:
+    explicit MirrorRates(double weight_ = 0.3)
+        : weight{weight_}
+    {}
+
+    // Bytes per second, negative if the host is not measured yet
+    double estimate(const std::string& host) const;
+    void record(const std::string& host, double rate);
+
+    MirrorRates(const MirrorRates&) = delete;
+    MirrorRates(MirrorRates&&) = delete;
+    MirrorRates& operator= (const MirrorRates&) = delete;
+    MirrorRates& operator= (MirrorRates&&) = delete;
+
+    ~MirrorRates() = default;
+
+private:
+    const double weight;
+    std::unordered_map<std::string, double> rates;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "validator_store.h"
+
+#include <string>
+
+/* Response bodies kept across runs, stored once per content hash and indexed by URI */
+class ObjectCache
+{
+public:
+    struct Entry
+    {
+        std::string hash;                    // hex SHA-256 of the body
+        ValidatorStore::Validator validator; // of the response it came from, size - of the body
+    };
+
+    // False if uri is not cached or its object is gone, a hit counts as use for eviction
+    virtual bool find(const std::string& uri, Entry&) = 0;
+    // Entry filled by store(), may evict least recently used objects
+    virtual void insert(const std::string& uri, const Entry&) = 0;
+    virtual void forget(const std::string& uri) = 0;
+
+    // Touch files only, safe to run on the threadpool concurrently with the methods above.
+    // Copy of fname into the cache, fills hash and size
+    virtual bool store(const std::string& fname, Entry&) const = 0;
+    // Copy of the cached object to the new file fname, false with errno EEXIST if fname exists
+    virtual bool restore(const Entry&, const std::string& fname) const = 0;
+
+    virtual ~ObjectCache() = default;
+};
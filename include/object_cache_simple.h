@@ -0,0 +1,76 @@
+#pragma once
+
+#include "object_cache.h"
+#include "append_log.h"
+
+#include <string>
+#include <list>
+#include <unordered_map>
+
+/* Cache directory layout:
+ *  objects/<sha256> - bodies, deduplicated by content, least recently used objects are evicted over capacity.
+ *  uses             - append-only text, the hash of an object per line on each use, oldest first.
+ *                     Replayed on load for the recency order, rewritten once it outnumbers objects.
+ *                     Objects without a record (older cache) come first, ordered by mtime.
+ *  index            - append-only text, one record per line: "<sha256>\t<size>\t<etag>\t<last-modified>\t<uri>".
+ *                     The last record of a URI wins, a record without hash forgets it.
+ *                     Records of evicted objects are dropped on load once they outnumber live ones.
+ * Objects are cloned (reflink) where the file system supports it, copied otherwise. */
+class ObjectCacheSimple final : public ObjectCache
+{
+public:
+    ObjectCacheSimple(const std::string& dir_, std::size_t capacity_);
+
+    virtual bool find(const std::string& uri, Entry&) override;
+    virtual void insert(const std::string& uri, const Entry&) override;
+    virtual void forget(const std::string& uri) override;
+
+    virtual bool store(const std::string& fname, Entry&) const override;
+    virtual bool restore(const Entry&, const std::string& fname) const override;
+
+    void flush();
+
+    std::size_t capacity() const noexcept { return m_capacity; }
+    std::size_t used() const noexcept { return m_used; }
+    std::size_t loaded() const noexcept { return entries.size(); }
+
+    ObjectCacheSimple() = delete;
+    ObjectCacheSimple(const ObjectCacheSimple&) = delete;
+    ObjectCacheSimple(ObjectCacheSimple&&) = delete;
+    ObjectCacheSimple& operator= (const ObjectCacheSimple&) = delete;
+    ObjectCacheSimple& operator= (ObjectCacheSimple&&) = delete;
+
+    virtual ~ObjectCacheSimple();
+
+private:
+    struct Object
+    {
+        std::size_t size;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    const std::string dir;
+    const std::size_t m_capacity;
+    AppendLog log;
+    AppendLog log_uses;
+
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, Object> objects;
+    std::list<std::string> lru; // hashes, most recently used first
+    std::size_t m_used = 0;
+    std::string pending;
+    std::string pending_uses;
+
+    std::string object_path(const std::string& hash) const { return dir + "/objects/" + hash; }
+    std::string index_path() const { return dir + "/index"; }
+    std::string uses_path() const { return dir + "/uses"; }
+    static std::string format(const std::string& uri, const Entry&);
+
+    void scan();
+    std::size_t load();
+    std::size_t load_uses();
+    void compact();
+    void compact_uses();
+    void use(const std::string& hash, std::size_t size);
+    void evict();
+};
@@ -7,6 +7,9 @@
 #include "dashboard.h"
 
 #include <list>
+#include <unordered_map>
+#include <functional>
+#include <iosfwd>
 
 class OnTickSimple : public OnTick
 {
@@ -21,9 +24,19 @@ public:
           task_list{task_list_},
           dashboard{dashboard_},
           max_redirect{max_redirect_}
-    {}
+    {
+        for (auto it = std::begin(job_list); it != std::end(job_list); ++it)
+            index.emplace(it->downloader.get(), it);
+    }
 
     virtual void invoke(std::shared_ptr<Downloader>) override;
+    void start(std::size_t concurrency);
+    void sweep();
+    // Stop taking new tasks, running jobs (and their redirects) go on
+    void drain();
+    void snapshot(std::ostream&) const;
+    // Invoked once the job list runs empty
+    void set_OnComplete(std::function<void()> cb) { on_complete = std::move(cb); }
 
     OnTickSimple() = delete;
     OnTickSimple(const OnTickSimple&) = delete;
@@ -34,7 +47,9 @@ public:
     virtual ~OnTickSimple() = default;
 
 private:
-    void next_task(const ConstIt);
+    void next_task(const ConstIt, bool success);
+    void fill();
+    void check_complete();
     void redirect(It, const std::string&);
     It find_job(Downloader*);
 
@@ -43,4 +58,10 @@ private:
     TaskList& task_list;
     Dashboard& dashboard;
     const std::size_t max_redirect;
+    std::size_t vacant = 0;
+    bool draining = false;
+    std::function<void()> on_complete;
+
+    // Job lookup by Downloader, list iterators are stable
+    std::unordered_map<Downloader*, It> index;
 };
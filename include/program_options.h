@@ -8,6 +8,21 @@ struct ProgramOptions
     std::size_t limit;
     std::string path;
     std::string task_fname;
+    std::size_t memory_limit;
+    std::size_t per_host;
+    std::string journal_fname;
+    std::string validators_fname;
+    std::string cache_dir;
+    std::size_t cache_size;
+    std::string redirects_fname;
+    std::string digest_files;
+    std::size_t progress_rate;
+    std::size_t drain_timeout;
+    bool json_output;
+    bool live_view;
+    std::string metrics_ip;
+    unsigned int metrics_port;
+    std::string trace_fname;
 };
 
 const ProgramOptions parse_program_options(int argc, char* argv[]);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+/* Permanent redirects (301, 308) seen so far keyed by URI, later jobs go straight to the target */
+class RedirectCache
+{
+public:
+    // Final target of uri, recorded chains are followed. False if uri is not redirected
+    virtual bool find(const std::string& uri, std::string& target) = 0;
+    virtual void record(const std::string& uri, const std::string& target) = 0;
+    virtual ~RedirectCache() = default;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "redirect_cache.h"
+#include "append_log.h"
+
+#include <string>
+#include <list>
+#include <utility>
+#include <unordered_map>
+
+/* In-memory LRU of at most <capacity> redirects, optionally persisted to an append-only text file,
+ * one record per line: "<uri>\t<target>". The last record of a URI wins.
+ * Records are buffered and written with fdatasync() on flush(), at the latest on destruction.
+ * A record torn by crash is cut off on load, the file is compacted on load when mostly outdated. */
+class RedirectCacheSimple final : public RedirectCache
+{
+public:
+    explicit RedirectCacheSimple(std::size_t capacity, const std::string& fname = std::string{});
+
+    virtual bool find(const std::string& uri, std::string& target) override;
+    virtual void record(const std::string& uri, const std::string& target) override;
+    void flush();
+
+    std::size_t size() const noexcept { return entries.size(); }
+
+    static constexpr std::size_t max_chain = 10;
+
+    RedirectCacheSimple() = delete;
+    RedirectCacheSimple(const RedirectCacheSimple&) = delete;
+    RedirectCacheSimple(RedirectCacheSimple&&) = delete;
+    RedirectCacheSimple& operator= (const RedirectCacheSimple&) = delete;
+    RedirectCacheSimple& operator= (RedirectCacheSimple&&) = delete;
+
+    virtual ~RedirectCacheSimple();
+
+private:
+    using Entries = std::list< std::pair<std::string, std::string> >;
+
+    const std::size_t capacity;
+    AppendLog log;
+    // Most recently used first
+    Entries entries;
+    std::unordered_map<std::string, Entries::iterator> index;
+    std::string pending;
+
+    void insert(const std::string&, const std::string&);
+    std::size_t load(const std::string&);
+    void compact(const std::string&);
+};
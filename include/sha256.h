@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/* FIPS 180-4 SHA-256, incremental: update() any number of times, then hex() once.
+ * Blocks go through the x86 SHA extensions when the CPU has them */
+class Sha256
+{
+public:
+    Sha256() noexcept;
+
+    void update(const void* data, std::size_t length) noexcept;
+    // Lowercase hex of the digest, finalizes the state
+    std::string hex();
+
+    Sha256(const Sha256&) = default;
+    Sha256& operator= (const Sha256&) = default;
+
+private:
+    std::array<std::uint32_t, 8> state;
+    std::array<std::uint8_t, 64> block;
+    std::size_t block_length = 0;
+    std::uint64_t total = 0;
+
+    void transform(const std::uint8_t*, std::size_t blocks) noexcept;
+    void transform_scalar(const std::uint8_t*) noexcept;
+};
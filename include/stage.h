@@ -0,0 +1,14 @@
+#pragma once
+
+#include "data_chunk.h"
+
+/* CPU-heavy step over the received data before it is written (hashing, decompression).
+ * DownloaderSimple runs process() on the libuv threadpool: the chunks of one download
+ * one at a time and in the order received, the chunks of different downloads in parallel.
+ * Data from chunk.offset to chunk.length may be changed in place */
+class Stage
+{
+public:
+    virtual void process(DataChunk& chunk) = 0;
+    virtual ~Stage() = default;
+};
@@ -10,13 +10,17 @@ public:
     template< typename StringUri,  typename StringFname,
               typename = std::enable_if_t< std::is_convertible<StringUri, std::string>::value, StringUri>,
               typename = std::enable_if_t< std::is_convertible<StringFname, std::string>::value, StringFname> >
-    Task(StringUri&& uri_, StringFname&& fname_)
+    Task(StringUri&& uri_, StringFname&& fname_, std::size_t line_ = 0, std::string digest_ = std::string{})
         : uri{ std::forward<StringUri>(uri_) },
-          fname{ std::forward<StringFname>(fname_) }
+          fname{ std::forward<StringFname>(fname_) },
+          line{line_},
+          digest{ std::move(digest_) }
     {}
 
     const std::string uri;
     const std::string fname;
+    const std::size_t line;
+    const std::string digest; // expected digest of the file, "<algorithm>:<hex>", empty - not checked
 
     Task() = delete;
     Task(const Task&) = delete;
@@ -31,5 +35,6 @@ class TaskList
 {
 public:
     virtual std::unique_ptr<Task> get() = 0;
+    virtual void finish(std::size_t /*line*/, bool /*success*/) {}
     virtual ~TaskList() = default;
 };
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "task.h"
+#include "journal.h"
+
+/* Decorator over TaskList: skips tasks completed by a previous run
+ * and records terminal states of finished tasks */
+class TaskListJournaled final : public TaskList
+{
+public:
+    TaskListJournaled(TaskList& source_, Journal& journal_)
+        : source{source_},
+          journal{journal_}
+    {}
+
+    virtual std::unique_ptr<Task> get() override;
+    virtual void finish(std::size_t, bool) override;
+
+    std::size_t skipped() const noexcept { return skipped_count; }
+
+    TaskListJournaled() = delete;
+    TaskListJournaled(const TaskListJournaled&) = delete;
+    TaskListJournaled(TaskListJournaled&&) = delete;
+    TaskListJournaled& operator= (const TaskListJournaled&) = delete;
+    TaskListJournaled& operator= (TaskListJournaled&&) = delete;
+
+    virtual ~TaskListJournaled() = default;
+
+private:
+    TaskList& source;
+    Journal& journal;
+    std::size_t skipped_count = 0;
+};
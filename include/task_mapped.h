@@ -0,0 +1,41 @@
+#pragma once
+
+#include "task.h"
+
+/* TaskList over memory mapped task file. Lines are scanned in place with memchr,
+ * only uri and fname are copied out. A pipe or FIFO is read into memory instead. */
+class TaskListMapped : public TaskList
+{
+public:
+    template< typename String,
+              typename = std::enable_if_t< std::is_convertible<String, std::string>::value, String> >
+    TaskListMapped(const std::string& fname, String&& path_)
+        : path{ std::forward<String>(path_) }
+    {
+        map(fname);
+    }
+
+    virtual std::unique_ptr<Task> get() override final;
+
+    TaskListMapped() = delete;
+    TaskListMapped(const TaskListMapped&) = delete;
+    TaskListMapped(TaskListMapped&&) = delete;
+    TaskListMapped& operator= (const TaskListMapped&) = delete;
+    TaskListMapped& operator= (TaskListMapped&&) = delete;
+    virtual ~TaskListMapped();
+
+private:
+    const std::string path;
+    const char* data = nullptr;
+    std::size_t size = 0;
+    // Content of a file that can`t be mapped, data points into it
+    std::string owned;
+
+    std::size_t offset = 0;
+    std::size_t line = 0;
+
+    void map(const std::string&);
+    bool read_all(int fd);
+    std::size_t next_line(std::size_t) const noexcept;
+    std::unique_ptr<Task> parse(std::size_t begin, std::size_t end, std::size_t line) const;
+};
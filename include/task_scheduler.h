@@ -0,0 +1,54 @@
+#pragma once
+
+#include "task.h"
+
+#include <deque>
+#include <list>
+#include <unordered_map>
+
+/* Decorator over TaskList: reads ahead up to <window> tasks, hands them out
+ * round-robin across hosts and keeps at most <per_host> tasks of a host running
+ * (0 - unlimited). Returns nullptr while every buffered host is saturated. */
+class TaskListScheduler final : public TaskList
+{
+public:
+    TaskListScheduler(TaskList& source_, std::size_t per_host_, std::size_t window_ = 1000)
+        : source{source_},
+          per_host{per_host_},
+          window{window_}
+    {}
+
+    virtual std::unique_ptr<Task> get() override;
+    virtual void finish(std::size_t, bool) override;
+
+    std::size_t pending() const noexcept { return buffered; }
+    std::size_t active_hosts() const noexcept { return hosts.size(); }
+
+    TaskListScheduler() = delete;
+    TaskListScheduler(const TaskListScheduler&) = delete;
+    TaskListScheduler(TaskListScheduler&&) = delete;
+    TaskListScheduler& operator= (const TaskListScheduler&) = delete;
+    TaskListScheduler& operator= (TaskListScheduler&&) = delete;
+
+    virtual ~TaskListScheduler() = default;
+
+private:
+    struct Host
+    {
+        std::deque< std::unique_ptr<Task> > pending;
+        std::size_t running = 0;
+    };
+
+    TaskList& source;
+    const std::size_t per_host;
+    const std::size_t window;
+
+    std::unordered_map<std::string, Host> hosts;
+    std::list<std::string> rotation;
+    std::unordered_map<std::size_t, std::string> running;
+    std::size_t buffered = 0;
+    bool eof = false;
+
+    void read_ahead();
+    static std::string host_of(const std::string&);
+};
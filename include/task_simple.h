@@ -26,4 +26,5 @@ public:
 private:
     std::istream& stream;
     const std::string path;
+    std::size_t line = 0;
 };
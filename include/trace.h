@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace trace {
+
+/* Chrome trace-event recorder (chrome://tracing, Perfetto).
+ * Events are appended to a thread_local buffer without locking; when tracing is off
+ * every hook is a single relaxed load. Buffers are merged and written by write(),
+ * after the producing threads are done (the download loop has returned). */
+
+using Clock = std::chrono::steady_clock;
+
+namespace detail {
+inline std::atomic<bool>& enabled_flag() noexcept
+{
+    static std::atomic<bool> flag{false};
+    return flag;
+}
+} // namespace detail
+
+inline bool enabled() noexcept { return detail::enabled_flag().load(std::memory_order_relaxed); }
+
+void start();
+// Stops recording and writes collected events as JSON, false on I/O error
+bool write(const std::string& fname);
+
+// Track (row) per job, named once with the file name
+std::uint64_t new_track(const std::string& name);
+
+// Names must be string literals, they are stored by pointer
+void span(const char* name, std::uint64_t track, Clock::time_point begin, Clock::time_point end);
+void instant(const char* name, std::uint64_t track, std::string detail);
+void counter(const char* name, std::int64_t value);
+
+} // namespace trace
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/* Cache validators of downloaded files keyed by URI, for conditional GET */
+class ValidatorStore
+{
+public:
+    struct Validator
+    {
+        std::string etag;
+        std::string last_modified;
+        std::size_t size = 0;
+
+        bool empty() const noexcept { return etag.empty() && last_modified.empty(); }
+    };
+
+    // False if nothing is recorded for uri or fname is not the file it was recorded for
+    virtual bool lookup(const std::string& uri, const std::string& fname, Validator&) const = 0;
+    // Recorded for uri, whatever file it was recorded for
+    virtual bool find(const std::string& uri, Validator&) const = 0;
+    // Empty validator forgets uri
+    virtual void record(const std::string& uri, const Validator&) = 0;
+    virtual ~ValidatorStore() = default;
+};
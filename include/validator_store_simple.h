@@ -0,0 +1,57 @@
+#pragma once
+
+#include "validator_store.h"
+#include "buffered_log.h"
+#include "append_log.h"
+
+#include <string>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+/* Append-only text store, one record per line: "<size>\t<etag>\t<last-modified>\t<uri>".
+ * The last record of a URI wins, a record without etag and last-modified forgets it.
+ * Records are buffered and written with fdatasync() on flush(), at the latest on destruction,
+ * or by the owner (JournalWriter, off the loop every <interval>), as the journal ones are.
+ * A record torn by crash is cut off on load, the file is compacted on load when mostly outdated.
+ * A record is trusted only while the output file still has the recorded size. */
+class ValidatorStoreSimple final : public ValidatorStore, public BufferedLog
+{
+public:
+    explicit ValidatorStoreSimple(const std::string& fname, std::size_t batch_ = 256, std::chrono::milliseconds interval_ = std::chrono::milliseconds{1000});
+
+    virtual bool lookup(const std::string& uri, const std::string& fname, Validator&) const override;
+    virtual bool find(const std::string& uri, Validator&) const override;
+    virtual void record(const std::string& uri, const Validator&) override;
+    void flush();
+
+    virtual void set_OnDue(std::function<void()> cb) override { on_due = std::move(cb); }
+    virtual std::chrono::milliseconds flush_interval() const noexcept override { return interval; }
+    virtual std::string take() override;
+    virtual void put_back(std::string) override;
+    virtual bool write(const std::string&) const noexcept override;
+
+    std::size_t loaded() const noexcept { return validators.size(); }
+
+    ValidatorStoreSimple() = delete;
+    ValidatorStoreSimple(const ValidatorStoreSimple&) = delete;
+    ValidatorStoreSimple(ValidatorStoreSimple&&) = delete;
+    ValidatorStoreSimple& operator= (const ValidatorStoreSimple&) = delete;
+    ValidatorStoreSimple& operator= (ValidatorStoreSimple&&) = delete;
+
+    virtual ~ValidatorStoreSimple();
+
+private:
+    const std::size_t batch;
+    const std::chrono::milliseconds interval;
+
+    AppendLog log;
+    std::unordered_map<std::string, Validator> validators;
+    std::string pending;
+    std::size_t pending_count = 0;
+    std::function<void()> on_due;
+
+    static std::string format(const std::string& uri, const Validator&);
+    std::size_t load(const std::string&);
+    void compact(const std::string&);
+};
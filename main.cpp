@@ -1,16 +1,32 @@
 #include "program_options.h"
-#include "task_simple.h"
+#include "task_mapped.h"
+#include "task_scheduler.h"
+#include "task_journaled.h"
+#include "journal_simple.h"
+#include "journal_writer.h"
+#include "validator_store_simple.h"
+#include "object_cache_simple.h"
+#include "redirect_cache_simple.h"
 #include "factory_simple.h"
+#include "factory_cached.h"
 #include "aio/bandwidth_controller.h"
+#include "aio/memory_budget.h"
+#include "aio/storage_estimator.h"
 #include "aio/factory_tcp_bandwidth.h"
-#include "dashboard_simple.h"
+#include "dashboard_buffered.h"
+#include "dashboard_live.h"
 #include "on_tick_simple.h"
+#include "metrics_server.h"
+#include "trace.h"
 #include <uvw/signal.hpp>
-#include <uvw/idle.hpp>
+#include <uvw/timer.hpp>
 
-#include <fstream>
 #include <iostream>
 #include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -18,43 +34,102 @@ int main(int argc, char *argv[])
 {
     const auto program_options = parse_program_options(argc, argv);
 
-    ifstream task_stream{program_options.task_fname};
-    if ( !task_stream.is_open() )
-    {
+    // Chunk stages, file writes and getaddrinfo share the libuv threadpool (4 threads by default),
+    // it is started by the first request. A size set by the user is kept
+    const auto cores = max(4u, thread::hardware_concurrency());
+    setenv( "UV_THREADPOOL_SIZE", to_string(cores).c_str(), 0 );
+
+    unique_ptr<TaskListMapped> task_list_mapped;
+    try {
+        task_list_mapped = make_unique<TaskListMapped>(program_options.task_fname, program_options.path);
+    } catch (const runtime_error&) {
         cout << "Can`t open <" << program_options.task_fname << ">, break." << endl;
         return 1;
     }
 
-    TaskListSimple task_list{task_stream, program_options.path};
-    DashboardSimple dashboard{};
+    TaskList* task_source = task_list_mapped.get();
+    unique_ptr<JournalSimple> journal;
+    unique_ptr<TaskListJournaled> task_list_journaled;
+    if ( !program_options.journal_fname.empty() )
+    {
+        try {
+            journal = make_unique<JournalSimple>(program_options.journal_fname);
+        } catch (const runtime_error&) {
+            cout << "Can`t open journal <" << program_options.journal_fname << ">, break." << endl;
+            return 1;
+        }
+        task_list_journaled = make_unique<TaskListJournaled>(*task_list_mapped, *journal);
+        task_source = task_list_journaled.get();
+    }
+
+    shared_ptr<ValidatorStoreSimple> validators;
+    if ( !program_options.validators_fname.empty() )
+    {
+        try {
+            validators = make_shared<ValidatorStoreSimple>(program_options.validators_fname);
+        } catch (const runtime_error&) {
+            cout << "Can`t open validator store <" << program_options.validators_fname << ">, break." << endl;
+            return 1;
+        }
+    }
+
+    shared_ptr<ObjectCacheSimple> cache;
+    if ( !program_options.cache_dir.empty() )
+    {
+        try {
+            cache = make_shared<ObjectCacheSimple>(program_options.cache_dir, program_options.cache_size);
+        } catch (const runtime_error&) {
+            cout << "Can`t open cache <" << program_options.cache_dir << ">, break." << endl;
+            return 1;
+        }
+    }
+
+    // Permanent redirects are remembered within the run anyway, across runs with the file
+    shared_ptr<RedirectCacheSimple> redirects;
+    try {
+        redirects = make_shared<RedirectCacheSimple>(4096, program_options.redirects_fname);
+    } catch (const runtime_error&) {
+        cout << "Can`t open redirect file <" << program_options.redirects_fname << ">, break." << endl;
+        return 1;
+    }
+
+    TaskListScheduler task_list{*task_source, program_options.per_host};
+    DashboardBuffered dashboard{ cout, program_options.json_output ? DashboardBuffered::Format::Json : DashboardBuffered::Format::Text };
+    unique_ptr<DashboardLive> dashboard_live;
+    // Event lines are written by the dashboard thread, a view redrawn on the same terminal would be torn by them
+    struct stat out_stat, err_stat;
+    const bool err_tty = ::isatty(STDERR_FILENO);
+    const bool same_tty = err_tty && ::isatty(STDOUT_FILENO)
+                          && ::fstat(STDOUT_FILENO, &out_stat) == 0 && ::fstat(STDERR_FILENO, &err_stat) == 0
+                          && out_stat.st_rdev == err_stat.st_rdev;
+    if (program_options.live_view && same_tty)
+        cerr << "Live view needs stdout or stderr redirected, disabled" << endl;
+    else if (program_options.live_view)
+        dashboard_live = make_unique<DashboardLive>( dashboard, cerr, make_unique<aio::bandwidth::Time>(),
+                                                     [&task_list]() { return task_list.pending(); }, 3, err_tty );
+    Dashboard& events = dashboard_live ? static_cast<Dashboard&>(*dashboard_live) : dashboard;
 
     auto loop = uvw::Loop::getDefault();
-    auto controller = make_shared< aio::bandwidth::ControllerSimple<AIO_UVW> >( loop, program_options.limit, make_unique<aio::bandwidth::Time>() );
-    auto factory_socket = make_shared<aio::FactoryTCPSocketBandwidth>(loop, controller);
-    auto factory = make_shared<FactorySimple>(loop, dashboard, factory_socket);
+    auto storage = make_shared<aio::storage::EstimatorSimple>( make_unique<aio::bandwidth::Time>() );
+    auto controller = make_shared< aio::bandwidth::ControllerSimple<AIO_UVW> >( loop, program_options.limit, make_unique<aio::bandwidth::Time>(), storage );
+    shared_ptr<aio::memory::BudgetSimple> budget;
+    if (program_options.memory_limit > 0)
+        budget = make_shared<aio::memory::BudgetSimple>(program_options.memory_limit);
+    auto factory_socket = make_shared<aio::FactoryTCPSocketBandwidth>(loop, controller, budget);
+    shared_ptr<Factory> factory = make_shared<FactorySimple>(loop, events, factory_socket, budget, storage, validators, redirects, program_options.digest_files, static_cast<bool>(journal));
+    if (cache)
+        factory = make_shared< FactoryCached<AIO_UVW> >(loop, events, factory, cache, validators, program_options.digest_files);
 
     std::list<Job> job_list;
-    auto on_tick = make_shared<OnTickSimple>(job_list, factory, task_list, dashboard);
+    auto on_tick = make_shared<OnTickSimple>(job_list, factory, task_list, events);
     factory->set_OnTick(on_tick);
 
-    for (size_t i = 1; i <= program_options.concurrency; i++)
-    {
-        auto task = task_list.get();
-        if (!task)
-            break;
-
-        Job job{task->fname};
-        job.downloader = factory->create(job.id, task->uri, task->fname);
-        if ( !(job.downloader) )
-            continue;
-
-        job_list.push_back( move(job) );
-    }
+    using Clock = chrono::steady_clock;
+    using Duration = chrono::seconds;
+    auto start_time = Clock::now();
 
-    auto signal = loop->resource<uvw::SignalHandle>();
-    auto signal_handler = [&factory, &job_list](const auto&, auto&)
+    auto abort = [&factory, &job_list]()
     {
-        cout << "Break" << endl;
         std::list< shared_ptr<Downloader> > downloader_list;
         for (auto it = begin(job_list); it != end(job_list); ++it)
             downloader_list.push_back(it->downloader);
@@ -62,34 +137,166 @@ int main(int argc, char *argv[])
         for (auto it = begin(downloader_list); it != end(downloader_list); ++it)
             (*it)->stop();
     };
-    signal->once<uvw::SignalEvent>(signal_handler);
-    signal->oneShot(SIGINT);
 
-    auto idle = loop->resource<uvw::IdleHandle>();
-    auto idle_handler = [&job_list, &signal](const auto&, auto& idle)
+    // First SIGINT/SIGTERM drains running jobs until the deadline, second one aborts them
+    auto drain_timer = loop->resource<uvw::TimerHandle>();
+    drain_timer->once<uvw::TimerEvent>( [&abort](const auto&, const auto&)
+    {
+        cerr << "Drain timeout, abort" << endl;
+        abort();
+    } );
+    size_t signal_count = 0;
+    auto stop_handler = [&](const auto&, const auto&)
     {
-        if( job_list.empty() )
+        if (++signal_count == 1)
         {
-            signal->stop();
-            idle.stop();
+            cerr << "Drain: no new tasks, waiting for " << job_list.size() << " running jobs" << endl;
+            drain_timer->start( chrono::duration_cast<uvw::TimerHandle::Time>( Duration{program_options.drain_timeout} ), uvw::TimerHandle::Time{0} );
+            on_tick->drain();
+        } else
+        {
+            cerr << "Break" << endl;
+            abort();
         }
     };
-    idle->on<uvw::IdleEvent>(idle_handler);
-    idle->start();
+    auto signal_int = loop->resource<uvw::SignalHandle>();
+    signal_int->on<uvw::SignalEvent>(stop_handler);
+    signal_int->start(SIGINT);
+    auto signal_term = loop->resource<uvw::SignalHandle>();
+    signal_term->on<uvw::SignalEvent>(stop_handler);
+    signal_term->start(SIGTERM);
 
-    using Clock = chrono::steady_clock;
-    using Duration = chrono::seconds;
-    auto start_time = Clock::now();
+    auto signal_usr1 = loop->resource<uvw::SignalHandle>();
+    signal_usr1->on<uvw::SignalEvent>( [&](const auto&, const auto&)
+    {
+        const auto elapsed = chrono::duration_cast<chrono::milliseconds>(Clock::now() - start_time).count();
+        const auto done = dashboard.status();
+        size_t running_downloaded = 0;
+        for (const auto& job : job_list)
+            if (job.downloader)
+                running_downloaded += job.downloader->status().downloaded;
+
+        cerr << "--------------- snapshot" << endl;
+        on_tick->snapshot(cerr);
+        cerr << "Tasks: " << done.first << " done, " << task_list.pending() << " queued over " << task_list.active_hosts() << " hosts" << endl;
+        if (elapsed > 0)
+            cerr << "Rate: " << (done.second + running_downloaded) * 1000 / static_cast<size_t>(elapsed) << " bytes/s average, storage ceiling: " << storage->ceiling() << " bytes/s" << endl;
+        if (budget)
+            cerr << "Buffered data: " << budget->used() << " bytes, peak: " << budget->peak() << " bytes, limit: " << budget->capacity() << " bytes" << endl;
+        cerr << "---------------" << endl;
+    } );
+    signal_usr1->start(SIGUSR1);
+
+    shared_ptr< metrics::Server<AIO_UVW> > metrics_server;
+    if (program_options.metrics_port > 0)
+    {
+        try {
+            metrics_server = metrics::Server<AIO_UVW>::create(loop, program_options.metrics_ip, program_options.metrics_port);
+        } catch (const runtime_error& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    // Journal records are synced on the threadpool, on a timer even without completions
+    shared_ptr<JournalWriter> journal_writer;
+    if (journal)
+    {
+        journal_writer = make_shared<JournalWriter>(loop, *journal);
+        journal_writer->start();
+    }
+    // Validators of the files written so far survive a crash the same way
+    shared_ptr<JournalWriter> validators_writer;
+    if (validators)
+    {
+        validators_writer = make_shared<JournalWriter>(loop, *validators, "Validator store");
+        validators_writer->start();
+    }
+
+    auto progress_timer = loop->resource<uvw::TimerHandle>();
+    progress_timer->on<uvw::TimerEvent>( [&on_tick](const auto&, const auto&) { on_tick->sweep(); } );
+    const auto progress_interval = uvw::TimerHandle::Time{ 1000 / program_options.progress_rate };
+    progress_timer->start(progress_interval, progress_interval);
+
+    // Loop runs out of active handles after the last job
+    on_tick->set_OnComplete( [&]()
+    {
+        signal_int->close();
+        signal_term->close();
+        signal_usr1->close();
+        drain_timer->clear();
+        drain_timer->close();
+        progress_timer->clear();
+        progress_timer->close();
+        if (metrics_server)
+            metrics_server->close();
+        if (journal_writer)
+            journal_writer->close();
+        if (validators_writer)
+            validators_writer->close();
+    } );
+    if ( !program_options.trace_fname.empty() )
+        trace::start();
+    on_tick->start(program_options.concurrency);
 
     loop->run();
-    signal->close();
-    idle->clear();
-    idle->close();
 
+    if ( !program_options.trace_fname.empty() && !trace::write(program_options.trace_fname) )
+        cerr << "Can`t write trace <" << program_options.trace_fname << ">" << endl;
+
+    if (journal)
+        journal->flush();
+    if (validators)
+    {
+        try {
+            validators->flush();
+        } catch (const runtime_error& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    try {
+        redirects->flush();
+    } catch (const runtime_error& e) {
+        cerr << e.what() << endl;
+    }
+
+    if (cache)
+    {
+        try {
+            cache->flush();
+        } catch (const runtime_error& e) {
+            cerr << e.what() << endl;
+        }
+    }
+
+    dashboard.flush();
+    // Keep JSON lines on stdout parseable
+    ostream& summary = program_options.json_output ? cerr : cout;
     auto elapsed = chrono::duration_cast<Duration>(Clock::now() - start_time);
     auto status = dashboard.status();
-    cout << "---------------" << endl;
-    cout << "Done tasks: " << status.first << ", total downloaded: " << status.second << " bytes, time elapsed: " << elapsed.count() << " seconds" << endl;
+    summary << "---------------" << endl;
+    summary << "Done tasks: " << status.first << ", total downloaded: " << status.second << " bytes, time elapsed: " << elapsed.count() << " seconds" << endl;
+    if (task_list_journaled)
+        summary << "Skipped by journal: " << task_list_journaled->skipped() << " tasks" << endl;
+    if (validators)
+        summary << "Not modified: " << metrics::registry().jobs_not_modified.value() << " tasks, "
+                << metrics::registry().bytes_not_modified.value() << " bytes skipped" << endl;
+    if (cache)
+    {
+        const auto hits = metrics::registry().cache_hits.value();
+        const auto lookups = hits + metrics::registry().cache_misses.value();
+        summary << "Cache: " << hits << " of " << lookups << " tasks hit (" << (lookups > 0 ? hits * 100 / lookups : 0) << "%), "
+                << metrics::registry().cache_bytes_saved.value() << " bytes saved, "
+                << cache->used() << " of " << cache->capacity() << " bytes used" << endl;
+    }
+    const auto redirects_cached = metrics::registry().redirects_cached.value();
+    const auto redirects_followed = metrics::registry().redirects_followed.value();
+    if (redirects_cached > 0 || redirects_followed > 0)
+        summary << "Redirects: " << redirects_cached << " hops skipped by cache, "
+                << redirects_followed << " followed on the open connection" << endl;
+    metrics::write_latency_summary(summary, metrics::registry());
+    if (budget)
+        summary << "Buffered data: " << budget->used() << " bytes, peak: " << budget->peak() << " bytes, limit: " << budget->capacity() << " bytes" << endl;
 
     return 0;
 }
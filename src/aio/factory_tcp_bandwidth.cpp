@@ -10,11 +10,11 @@ using ::aio::TCPSocketBandwidth;
 shared_ptr<TCPSocket> FactoryTCPSocketBandwidth::tcp()
 {
     auto socket = FactoryTCPSocket::tcp();
-    return (socket) ? TCPSocketBandwidth::create(nullptr, controller, socket) : nullptr;
+    return (socket) ? TCPSocketBandwidth::create(nullptr, controller, socket, budget) : nullptr;
 }
 
 shared_ptr<TCPSocket> FactoryTCPSocketBandwidth::tcp_tls()
 {
     auto socket = FactoryTCPSocket::tcp_tls();
-    return (socket) ? TCPSocketBandwidth::create(nullptr, controller, socket) : nullptr;
+    return (socket) ? TCPSocketBandwidth::create(nullptr, controller, socket, budget) : nullptr;
 }
@@ -0,0 +1,124 @@
+#include "aio/memory_budget.h"
+#include "metrics.h"
+
+#include <vector>
+
+using namespace aio::memory;
+
+using ::std::size_t;
+using ::std::shared_ptr;
+using ::std::weak_ptr;
+using ::std::pair;
+using ::std::vector;
+using ::std::min;
+using ::std::max;
+using ::std::sort;
+using ::std::begin;
+using ::std::end;
+
+BudgetSimple::BudgetSimple(size_t limit_)
+    : limit{limit_},
+      low_watermark{ limit_ - limit_ / 4 },
+      step{ max<size_t>(limit_ / 8, 1) }
+{
+    metrics::registry().memory_limit.set( static_cast<std::int64_t>(limit) );
+}
+
+Budget::ConsumerConnection BudgetSimple::add_consumer(weak_ptr<Consumer> weak)
+{
+    if ( weak.expired() )
+        return end(consumers);
+
+    return consumers.insert(end(consumers), weak);
+}
+
+void BudgetSimple::remove_consumer(ConsumerConnection conn)
+{
+    // throttle() and unthrottle() collect the consumers before calling them, erasing is safe
+    if ( conn != end(consumers) )
+        consumers.erase(conn);
+}
+
+void BudgetSimple::acquire(size_t length)
+{
+    m_used += length;
+    m_peak = max(m_peak, m_used);
+    auto& counters = metrics::registry();
+    counters.memory_used.set( static_cast<std::int64_t>(m_used) );
+    counters.memory_peak.set( static_cast<std::int64_t>(m_peak) );
+
+    if (m_used > limit && m_used >= next_throttle)
+        throttle();
+}
+
+void BudgetSimple::release(size_t length)
+{
+    m_used -= min(length, m_used);
+    metrics::registry().memory_used.set( static_cast<std::int64_t>(m_used) );
+
+    if (throttled && m_used <= low_watermark)
+        unthrottle();
+}
+
+void BudgetSimple::throttle()
+{
+    vector< pair< size_t, shared_ptr<Consumer> > > candidates;
+
+    auto it = begin(consumers);
+    while ( it != end(consumers) )
+    {
+        auto consumer = it->lock();
+        if (consumer)
+        {
+            ++it;
+            const size_t buffered = consumer->buffered();
+            if (buffered > 0)
+                candidates.emplace_back( buffered, std::move(consumer) );
+        } else
+        {
+            auto rm_it = it++;
+            consumers.erase(rm_it);
+        }
+    }
+
+    sort( begin(candidates), end(candidates), [](const auto& a, const auto& b) { return a.first > b.first; } );
+
+    throttled = true;
+    next_throttle = m_used + step;
+
+    // Already throttled consumers are still draining, count them as covering the excess
+    const size_t excess = m_used - low_watermark;
+    size_t covered = 0;
+    for (auto& candidate : candidates)
+    {
+        if (covered >= excess)
+            break;
+        candidate.second->throttle();
+        covered += candidate.first;
+    }
+}
+
+void BudgetSimple::unthrottle()
+{
+    throttled = false;
+    next_throttle = 0;
+
+    vector< shared_ptr<Consumer> > held;
+    auto it = begin(consumers);
+    while ( it != end(consumers) )
+    {
+        auto consumer = it->lock();
+        if (consumer)
+        {
+            ++it;
+            held.push_back( std::move(consumer) );
+        } else
+        {
+            auto rm_it = it++;
+            consumers.erase(rm_it);
+        }
+    }
+
+    for (auto& consumer : held)
+        consumer->unthrottle();
+}
@@ -0,0 +1,36 @@
+#include "aio/storage_estimator.h"
+
+using namespace aio::storage;
+
+using ::std::size_t;
+
+void EstimatorSimple::write_begin()
+{
+    if (in_flight++ == 0)
+        time->elapsed(); // idle time is not counted
+}
+
+void EstimatorSimple::write_end(size_t length)
+{
+    if (in_flight == 0)
+        return;
+    in_flight--;
+
+    sample_bytes += length;
+    sample_time += time->elapsed();
+    if (sample_time < window)
+        return;
+
+    const auto ms = static_cast<size_t>( sample_time.count() );
+    const size_t rate = sample_bytes * 1000 / ms;
+    throughput = (throughput == 0) ? rate : (throughput * 3 + rate) / 4;
+
+    sample_bytes = 0;
+    sample_time = sample_time.zero();
+}
+
+void EstimatorSimple::write_abort()
+{
+    if (in_flight > 0)
+        in_flight--;
+}
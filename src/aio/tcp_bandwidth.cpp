@@ -1,4 +1,5 @@
 #include "aio/tcp_bandwidth.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cassert>
@@ -26,10 +27,12 @@ using ::uvw::CloseEvent;
 
 /* TCPSocket implementation */
 
-shared_ptr<TCPSocketBandwidth> TCPSocketBandwidth::create(shared_ptr<void>, shared_ptr<Controller> controller, shared_ptr<TCPSocket> socket)
+shared_ptr<TCPSocketBandwidth> TCPSocketBandwidth::create(shared_ptr<void>, shared_ptr<Controller> controller, shared_ptr<TCPSocket> socket, shared_ptr<Budget> budget)
 {
-    auto self = make_shared<TCPSocketBandwidth>( ConstructorAccess{42}, controller, move(socket) );
+    auto self = make_shared<TCPSocketBandwidth>( ConstructorAccess{42}, controller, move(socket), budget );
     self->conn = controller->add_stream(self);
+    if (budget)
+        self->budget_conn = budget->add_consumer(self);
 
     self->socket->once<ErrorEvent>( bind_on_event<ErrorEvent>(self) );
     self->socket->once<ConnectEvent>( bind_on_event<ConnectEvent>(self) );
@@ -55,14 +58,14 @@ void TCPSocketBandwidth::connect6(const std::string& ip, unsigned short port)
 void TCPSocketBandwidth::read()
 {
     stopped = false;
-    if (!paused)
+    if (!paused && !throttled)
         socket->read();
 }
 
 void TCPSocketBandwidth::stop() noexcept
 {
     stopped = true;
-    if (!paused)
+    if (!paused && !throttled)
         socket->stop();
 }
 
@@ -88,6 +91,12 @@ void TCPSocketBandwidth::close() noexcept
     {
         closed = stopped = true;
         controller->remove_stream(conn);
+        if (budget)
+        {
+            budget->remove_consumer(budget_conn);
+            budget->release(buffer_used);
+        }
+        metrics::registry().socket_buffered_bytes.sub( static_cast<std::int64_t>(buffer_used) );
         socket->clear();
         socket->once<CloseEvent>( [self = shared_from_this()](auto& event, const auto&) { self->publish( move(event) ); } );
         socket->close();
@@ -115,6 +124,10 @@ void TCPSocketBandwidth::transfer(size_t length)
     length = min(length, buffer_used);
     auto data = pop_buffer(length);
     buffer_used -= length;
+    metrics::registry().socket_buffered_bytes.sub( static_cast<std::int64_t>(length) );
+    // Released before the receiver acquires the same bytes, so they are never counted twice
+    if (budget)
+        budget->release(length);
     publish( DataEvent{move(data), length} );
 
     if (eof && buffer_used == 0)
@@ -124,11 +137,41 @@ void TCPSocketBandwidth::transfer(size_t length)
     } else if (paused && buffer_used < buffer_max_length)
     {
         paused = false;
-        socket->read();
+        if (!throttled)
+            socket->read();
     }
 }
 
 
+/* memory::Consumer implementation */
+
+size_t TCPSocketBandwidth::buffered() const noexcept
+{
+    return buffer_used;
+}
+
+void TCPSocketBandwidth::throttle()
+{
+    if (throttled || closed)
+        return;
+
+    throttled = true;
+    metrics::registry().socket_throttled.add();
+    if (!stopped && !paused)
+        socket->stop();
+}
+
+void TCPSocketBandwidth::unthrottle()
+{
+    if (!throttled)
+        return;
+
+    throttled = false;
+    if (!closed && !stopped && !paused)
+        socket->read();
+}
+
+
 /* private implementation */
 
 template < typename Event >
@@ -177,6 +220,11 @@ void TCPSocketBandwidth::on_data(unique_ptr<char[]> data, size_t length)
 {
     buffer.emplace(move(data), length);
     buffer_used += length;
+    auto& counters = metrics::registry();
+    counters.socket_received_bytes.add(length);
+    counters.socket_buffered_bytes.add( static_cast<std::int64_t>(length) );
+    if (budget)
+        budget->acquire(length);
     if (buffer_used >= buffer_max_length)
     {
         paused = true;
@@ -0,0 +1,100 @@
+#include "append_log.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::ifstream;
+using ::std::getline;
+using ::std::runtime_error;
+
+namespace {
+
+bool write_all(int fd, const string& data)
+{
+    const char* ptr = data.data();
+    size_t left = data.size();
+    while (left > 0)
+    {
+        auto written = ::write(fd, ptr, left);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        left -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+AppendLog::~AppendLog()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool AppendLog::open(const string& fname)
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = ::open(fname.c_str(), O_CREAT | O_WRONLY | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP);
+    return fd >= 0;
+}
+
+bool AppendLog::append(const string& data, bool sync) const noexcept
+{
+    if ( data.empty() )
+        return true;
+    if ( !write_all(fd, data) )
+        return false;
+    return !sync || ::fdatasync(fd) == 0;
+}
+
+size_t AppendLog::load(const string& fname, const OnRecord& on_record)
+{
+    ifstream stream{fname};
+    if ( !stream.is_open() )
+        return 0;
+
+    size_t records = 0;
+    string buf;
+    std::streamoff complete = 0;
+    while ( getline(stream, buf) )
+    {
+        if ( stream.eof() )
+        {
+            stream.close();
+            if ( ::truncate(fname.c_str(), complete) != 0 )
+                throw runtime_error{"AppendLog: can`t truncate <" + fname + ">"};
+            break;
+        }
+        complete += static_cast<std::streamoff>( buf.size() ) + 1;
+        records++;
+        on_record(buf);
+    }
+    return records;
+}
+
+bool AppendLog::rewrite(const string& fname, const string& data)
+{
+    const string tmp = fname + ".tmp";
+    int tmp_fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP);
+    if (tmp_fd < 0)
+        return false;
+    const bool written = write_all(tmp_fd, data) && ::fdatasync(tmp_fd) == 0;
+    const bool closed = ::close(tmp_fd) == 0;
+    if ( written && closed && std::rename( tmp.c_str(), fname.c_str() ) == 0 )
+        return true;
+    ::unlink( tmp.c_str() );
+    return false;
+}
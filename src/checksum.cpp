@@ -0,0 +1,86 @@
+#include "checksum.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::make_unique;
+using ::std::ofstream;
+
+unique_ptr<Checksum> Checksum::parse(const string& spec, bool sidecar)
+{
+    const auto colon = spec.find(':');
+    const string name = spec.substr(0, colon);
+    string hex = (colon != string::npos) ? spec.substr(colon + 1) : string{};
+
+    Algorithm algorithm;
+    size_t length;
+    if (name == "sha256")
+    {
+        algorithm = Algorithm::Sha256;
+        length = 64;
+    } else if (name == "crc32c")
+    {
+        algorithm = Algorithm::Crc32c;
+        length = 8;
+    } else
+        return nullptr;
+
+    std::transform( hex.begin(), hex.end(), hex.begin(), [](char c) { return static_cast<char>( ::tolower( static_cast<unsigned char>(c) ) ); } );
+    if ( !hex.empty() && (hex.size() != length || !std::all_of( hex.begin(), hex.end(), [](char c) { return ::isxdigit( static_cast<unsigned char>(c) ); } )) )
+        return nullptr;
+
+    return make_unique<Checksum>( algorithm, std::move(hex), sidecar );
+}
+
+void Checksum::update(const void* data, size_t length) noexcept
+{
+    if (algorithm == Algorithm::Sha256)
+        sha256.update(data, length);
+    else
+        crc32c.update(data, length);
+}
+
+const string& Checksum::hex()
+{
+    if ( result.empty() )
+        result = (algorithm == Algorithm::Sha256) ? sha256.hex() : crc32c.hex();
+    return result;
+}
+
+bool Checksum::update(const string& fname)
+{
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    std::vector<char> buf(64 * 1024);
+    for (;;)
+    {
+        auto n = ::read( fd, buf.data(), buf.size() );
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            ::close(fd);
+            return n == 0;
+        }
+        update( buf.data(), static_cast<size_t>(n) );
+    }
+}
+
+bool Checksum::write(const string& fname)
+{
+    const auto slash = fname.rfind('/');
+    ofstream stream{ fname + "." + name(), std::ios::trunc };
+    stream << hex() << "  " << ( (slash != string::npos) ? fname.substr(slash + 1) : fname ) << "\n";
+    stream.close();
+    return !stream.fail();
+}
@@ -0,0 +1,109 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#define CRC32C_X86
+#endif
+
+using ::std::size_t;
+using ::std::uint8_t;
+using ::std::uint32_t;
+using ::std::uint64_t;
+using ::std::string;
+
+namespace {
+
+struct Table
+{
+    uint32_t t[8][256];
+
+    Table() noexcept
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int j = 0; j < 8; j++)
+                c = (c >> 1) ^ ( (c & 1) ? 0x82F63B78u : 0 );
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+            for (size_t s = 1; s < 8; s++)
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][ t[s - 1][i] & 0xFF ];
+    }
+};
+
+const Table table;
+
+uint32_t update_sw(uint32_t crc, const uint8_t* p, size_t length) noexcept
+{
+    const auto& t = table.t;
+    // Words are taken in host order, little-endian is assumed
+    for (; length >= 8; p += 8, length -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^ t[4][(word >> 24) & 0xFF]
+            ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+    }
+    for (; length > 0; p++, length--)
+        crc = (crc >> 8) ^ t[0][ (crc ^ *p) & 0xFF ];
+    return crc;
+}
+
+#ifdef CRC32C_X86
+
+__attribute__((target("sse4.2")))
+uint32_t update_hw(uint32_t crc, const uint8_t* p, size_t length) noexcept
+{
+    uint64_t c = crc;
+    for (; length >= 8; p += 8, length -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    crc = static_cast<uint32_t>(c);
+    for (; length > 0; p++, length--)
+        crc = _mm_crc32_u8(crc, *p);
+    return crc;
+}
+
+bool has_sse42() noexcept
+{
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2);
+}
+
+const bool hw = has_sse42();
+
+#endif
+
+} // namespace
+
+void Crc32c::update(const void* data, size_t length) noexcept
+{
+    auto ptr = static_cast<const uint8_t*>(data);
+#ifdef CRC32C_X86
+    if (hw)
+    {
+        crc = update_hw(crc, ptr, length);
+        return;
+    }
+#endif
+    crc = update_sw(crc, ptr, length);
+}
+
+string Crc32c::hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+    const uint32_t v = value();
+    string result;
+    result.reserve(8);
+    for (int shift = 28; shift >= 0; shift -= 4)
+        result.push_back( digits[(v >> shift) & 0xF] );
+    return result;
+}
@@ -0,0 +1,283 @@
+#include "dashboard_buffered.h"
+
+#include <iomanip>
+#include <ctime>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::vector;
+using ::std::ostream;
+using ::std::mutex;
+using ::std::unique_lock;
+using ::std::lock_guard;
+using ::std::move;
+using ::std::put_time;
+using ::std::chrono::milliseconds;
+
+DashboardBuffered::DashboardBuffered(ostream& out_, Format format_, size_t capacity_, milliseconds interval_)
+    : out(out_),
+      format{format_},
+      interval{interval_},
+      ring(capacity_ > 0 ? capacity_ : 1)
+{
+    writer = std::thread{ [this]() { run(); } };
+}
+
+DashboardBuffered::~DashboardBuffered()
+{
+    {
+        lock_guard<mutex> lock{guard};
+        stopping = true;
+    }
+    wakeup.notify_one();
+    writer.join();
+}
+
+void DashboardBuffered::started(size_t job_id, const string& fname)
+{
+    files[job_id] = fname;
+}
+
+void DashboardBuffered::update(size_t job_id, const StatusDownloader& status)
+{
+    switch (status.state)
+    {
+    case State::Done:
+        done_tasks++;
+        total_downloaded += status.downloaded;
+        break;
+    case State::Failed:
+    case State::Redirect:
+        break;
+    default:
+        return;
+    }
+
+    Record record{ Clock::now(), job_id, status.state, status.phase, status.error, status.error_code,
+                   status.http_status, status.downloaded, string{}, string{} };
+    if (status.state != State::Done)
+    {
+        record.detail = status.detail;
+        record.redirect_uri = status.redirect_uri;
+    }
+    // A redirected job goes on under the same id
+    auto file = files.find(job_id);
+    if ( file != files.end() )
+    {
+        record.fname = file->second;
+        if (status.state != State::Redirect)
+            files.erase(file);
+    }
+
+    bool wake;
+    {
+        lock_guard<mutex> lock{guard};
+        if (count == ring.size())
+        {
+            m_dropped++;
+            return;
+        }
+        ring[(head + count) % ring.size()] = move(record);
+        count++;
+        appended++;
+        wake = count == ring.size() / 2 + 1;
+    }
+    if (wake)
+        wakeup.notify_one();
+}
+
+void DashboardBuffered::flush()
+{
+    unique_lock<mutex> lock{guard};
+    const auto target = appended;
+    flush_requested = true;
+    wakeup.notify_one();
+    drained.wait( lock, [this, target]() { return written >= target || stopping; } );
+}
+
+size_t DashboardBuffered::dropped() const
+{
+    lock_guard<mutex> lock{guard};
+    return m_dropped;
+}
+
+void DashboardBuffered::run()
+{
+    vector<Record> batch;
+    batch.reserve( ring.size() );
+    unique_lock<mutex> lock{guard};
+    for (;;)
+    {
+        wakeup.wait_for( lock, interval, [this]() { return stopping || count > ring.size() / 2 || flush_requested; } );
+
+        while (count > 0)
+        {
+            batch.push_back( move(ring[head]) );
+            head = (head + 1) % ring.size();
+            count--;
+        }
+        const auto dropped_since = m_dropped - reported_dropped;
+        reported_dropped = m_dropped;
+        const bool stop = stopping;
+        flush_requested = false;
+
+        // Formatting and stream I/O run unlocked, update() does not wait for them
+        lock.unlock();
+        write(batch);
+        if (dropped_since > 0)
+            write_dropped(dropped_since);
+        out.flush();
+        const auto n = batch.size();
+        batch.clear();
+        lock.lock();
+
+        written += n;
+        drained.notify_all();
+        if (stop && count == 0)
+            return;
+    }
+}
+
+void DashboardBuffered::write(const vector<Record>& batch)
+{
+    for (const auto& record : batch)
+    {
+        if (format == Format::Json)
+            write_json(record);
+        else
+            write_text(record);
+    }
+}
+
+void DashboardBuffered::write_text(const Record& record)
+{
+    const auto time = Clock::to_time_t(record.time);
+    std::tm tm_;
+    ::localtime_r(&time, &tm_);
+    out << put_time(&tm_, "%H:%M:%S  ") << "#" << record.job_id;
+    switch (record.state)
+    {
+    case State::Done:
+        out << " State: Done";
+        break;
+    case State::Failed:
+        out << " State: Failed, error: " << str(record);
+        break;
+    case State::Redirect:
+        out << " State: Redirect, status: " << str(record);
+        break;
+    default:
+        break;
+    }
+    out << '\n';
+}
+
+string DashboardBuffered::str(const Record& record)
+{
+    StatusDownloader status;
+    status.state = record.state;
+    status.phase = record.phase;
+    status.error = record.error;
+    status.error_code = record.error_code;
+    status.http_status = record.http_status;
+    status.downloaded = record.downloaded;
+    status.detail = record.detail;
+    status.redirect_uri = record.redirect_uri;
+    return status.str();
+}
+
+static void json_string(ostream& out, const string& s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out << '"';
+    for (const unsigned char c : s)
+    {
+        switch (c)
+        {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20)
+                out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+            else
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+static const char* error_name(StatusDownloader::Error error)
+{
+    using Error = StatusDownloader::Error;
+
+    switch (error)
+    {
+    case Error::None:             return "none";
+    case Error::Abort:            return "abort";
+    case Error::UriParse:         return "uri_parse";
+    case Error::SocketCreate:     return "socket_create";
+    case Error::TimerCreate:      return "timer_create";
+    case Error::ResolverCreate:   return "resolver_create";
+    case Error::Resolve:          return "resolve";
+    case Error::Connect:          return "connect";
+    case Error::ConnectTimeout:   return "connect_timeout";
+    case Error::NetTimer:         return "net_timer";
+    case Error::Request:          return "request";
+    case Error::RequestTimeout:   return "request_timeout";
+    case Error::ResponseRead:     return "response_read";
+    case Error::ResponseTimeout:  return "response_timeout";
+    case Error::ConnectionClosed: return "connection_closed";
+    case Error::ResponseParse:    return "response_parse";
+    case Error::FileOpen:         return "file_open";
+    case Error::FileWrite:        return "file_write";
+    case Error::FileClose:        return "file_close";
+    case Error::MaxRedirect:      return "max_redirect";
+    case Error::Checksum:         return "checksum";
+    }
+    return "";
+}
+
+void DashboardBuffered::write_json(const Record& record)
+{
+    const auto ms = std::chrono::duration_cast<milliseconds>( record.time.time_since_epoch() ).count();
+    out << "{\"time_ms\":" << ms << ",\"job\":" << record.job_id << ",\"file\":";
+    if ( record.fname.empty() )
+        out << "null";
+    else
+        json_string(out, record.fname);
+    out << ",\"state\":";
+    switch (record.state)
+    {
+    case State::Done:
+        out << "\"done\",\"downloaded\":" << record.downloaded;
+        break;
+    case State::Failed:
+        out << "\"failed\",\"error\":\"" << error_name(record.error) << "\",\"error_code\":" << record.error_code << ",\"message\":";
+        json_string(out, str(record));
+        break;
+    case State::Redirect:
+        out << "\"redirect\",\"redirect_uri\":";
+        json_string(out, record.redirect_uri);
+        break;
+    default:
+        out << "null";
+        break;
+    }
+    out << ",\"http_status\":" << record.http_status << "}\n";
+}
+
+// A JSON object in JSON mode, the stream stays one object per line
+void DashboardBuffered::write_dropped(size_t n)
+{
+    if (format == Format::Json)
+    {
+        const auto ms = std::chrono::duration_cast<milliseconds>( Clock::now().time_since_epoch() ).count();
+        out << "{\"time_ms\":" << ms << ",\"dropped\":" << n << "}\n";
+    } else
+    {
+        out << "Dashboard: " << n << " records dropped" << '\n';
+    }
+}
@@ -0,0 +1,161 @@
+#include "dashboard_live.h"
+
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+using ::std::size_t;
+using ::std::ostream;
+using ::std::unique_ptr;
+using ::std::vector;
+using ::std::pair;
+using ::std::move;
+using ::std::partial_sort;
+using ::std::min;
+
+using State = StatusDownloader::State;
+
+DashboardLive::DashboardLive(Dashboard& inner_, ostream& out_, unique_ptr<aio::bandwidth::Time> time_,
+                             Queued queued_, size_t top_, bool redraw_)
+    : inner(inner_),
+      out(out_),
+      time{ move(time_) },
+      queued{ move(queued_) },
+      top{top_},
+      redraw{redraw_}
+{}
+
+static size_t ewma(size_t average, size_t sample)
+{
+    return (average == 0) ? sample : (average * 3 + sample) / 4;
+}
+
+void DashboardLive::update(size_t job_id, const StatusDownloader& status)
+{
+    inner.update(job_id, status);
+
+    if (status.state == State::OnTheGo)
+        return;
+
+    auto it = jobs.find(job_id);
+    if (status.state == State::Done)
+    {
+        done_count++;
+        done_bytes += status.downloaded;
+        // Bytes received after the last sweep still count toward the aggregate rate
+        const size_t last = (it != jobs.end()) ? it->second.last : 0;
+        if (status.downloaded > last)
+            finished_bytes += status.downloaded - last;
+    }
+    // A redirected job restarts with a new downloader, its counters start over
+    if (it != jobs.end())
+        jobs.erase(it);
+}
+
+void DashboardLive::progress(size_t job_id, const StatusDownloader& status)
+{
+    auto& job = jobs[job_id];
+    job.current = status.downloaded;
+    job.size = status.size;
+    job.generation = generation;
+}
+
+void DashboardLive::sweep_done()
+{
+    const auto ms = static_cast<size_t>( time->elapsed().count() );
+
+    size_t bytes = finished_bytes;
+    finished_bytes = 0;
+    size_t remaining = 0;
+    for (auto it = jobs.begin(); it != jobs.end();)
+    {
+        auto& job = it->second;
+        if (job.generation != generation)
+        {
+            it = jobs.erase(it);
+            continue;
+        }
+        const size_t delta = (job.current >= job.last) ? job.current - job.last : job.current;
+        bytes += delta;
+        job.last = job.current;
+        if (ms > 0)
+            job.rate = ewma(job.rate, delta * 1000 / ms);
+        if (job.size > job.current)
+            remaining += job.size - job.current;
+        ++it;
+    }
+    generation++;
+
+    if (ms > 0)
+        aggregate_rate = ewma(aggregate_rate, bytes * 1000 / ms);
+
+    queued_tasks = queued ? queued() : 0;
+    if (done_count > 0)
+        remaining += queued_tasks * (done_bytes / done_count);
+    m_eta = (aggregate_rate > 0) ? (remaining + aggregate_rate - 1) / aggregate_rate : 0;
+
+    render();
+}
+
+static void print_bytes(ostream& out, size_t bytes)
+{
+    static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit < 4)
+    {
+        value /= 1024;
+        unit++;
+    }
+    if (unit == 0)
+        out << bytes << " B";
+    else
+    {
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::fixed << std::setprecision(1) << value << " " << units[unit];
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
+
+void DashboardLive::render()
+{
+    if (redraw && drawn_lines > 0)
+        out << "\033[" << drawn_lines << "A\033[J"; // cursor up, clear to the end of screen
+
+    out << "Running: " << jobs.size();
+    if (queued)
+        out << ", queued: " << queued_tasks;
+    out << ", rate: ";
+    print_bytes(out, aggregate_rate);
+    out << "/s, ETA: ";
+    if (m_eta > 0)
+        out << m_eta << " s";
+    else
+        out << "unknown";
+    out << '\n';
+    drawn_lines = 1;
+
+    vector< pair<size_t, const JobRate*> > slowest;
+    slowest.reserve( jobs.size() );
+    for (const auto& job : jobs)
+        slowest.emplace_back(job.first, &job.second);
+    const auto n = min(top, slowest.size());
+    partial_sort( slowest.begin(), slowest.begin() + n, slowest.end(),
+                  [](const auto& a, const auto& b) { return a.second->rate < b.second->rate || (a.second->rate == b.second->rate && a.first < b.first); } );
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const auto& job = *slowest[i].second;
+        out << "  #" << slowest[i].first << " ";
+        print_bytes(out, job.rate);
+        out << "/s, ";
+        print_bytes(out, job.current);
+        if (job.size > 0)
+            out << ", " << job.current * 100 / job.size << "%";
+        out << '\n';
+        drawn_lines++;
+    }
+    out.flush();
+}
@@ -0,0 +1,79 @@
+#include "downloader.h"
+
+#include <uv.h>
+
+using ::std::string;
+using ::std::to_string;
+
+static const char* phase2str(StatusDownloader::Phase phase)
+{
+    using Phase = StatusDownloader::Phase;
+
+    switch (phase)
+    {
+    case Phase::Init:     return "Init.";
+    case Phase::Resolve:  return "Resolve host...";
+    case Phase::Connect:  return "Host Resolved. Connect...";
+    case Phase::Request:  return "Connected, write request.";
+    case Phase::Response: return "Write request done. Wait response.";
+    case Phase::Receive:  return "Data received.";
+    }
+    return "";
+}
+
+static string error2str(const StatusDownloader& status)
+{
+    using Error = StatusDownloader::Error;
+
+    const string& d = status.detail;
+    switch (status.error)
+    {
+    case Error::None:             return "";
+    case Error::Abort:            return "Abort.";
+    case Error::UriParse:         return "URI can`t parse";
+    case Error::SocketCreate:     return "Socket can`t create";
+    case Error::TimerCreate:      return "Net timer can`t create";
+    case Error::ResolverCreate:   return "Resolver can`t create";
+    case Error::Resolve:          return "Host <" + d + "> can`t resolve.";
+    case Error::Connect:          return "Host <" + d + "> can`t available.";
+    case Error::ConnectTimeout:   return "Timeout connect to host <" + d + ">";
+    case Error::NetTimer:         return "Net_timer run failed!";
+    case Error::Request:          return "Request failed.";
+    case Error::RequestTimeout:   return "Timeout write request";
+    case Error::ResponseRead:     return "Response read failed.";
+    case Error::ResponseTimeout:  return "Timeout read response";
+    case Error::ConnectionClosed: return "Connection it`s unexpecdly closed.";
+    case Error::ResponseParse:    return "Response parse failed. " + d;
+    case Error::FileOpen:         return "File <" + d + "> can`t open!";
+    case Error::FileWrite:        return "File <" + d + "> write error!";
+    case Error::FileClose:        return "File <" + d + "> close error!";
+    case Error::MaxRedirect:      return "Maximum count redirect";
+    case Error::Checksum:         return "Checksum failed, " + d;
+    }
+    return "";
+}
+
+string StatusDownloader::str() const
+{
+    switch (state)
+    {
+    case State::Init:
+    case State::OnTheGo:
+        return phase2str(phase);
+
+    case State::Done:
+        return "Downloading complete";
+
+    case State::Redirect:
+        return "Redirect to <" + redirect_uri + ">";
+
+    case State::Suspended:
+        return "Suspended";
+
+    case State::Failed:
+        if (error_code != 0)
+            return error2str(*this) + " Code => " + to_string(error_code) + " Reason => " + uv_strerror(error_code);
+        return error2str(*this);
+    }
+    return "";
+}
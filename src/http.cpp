@@ -3,6 +3,9 @@
 #include <cassert>
 #include <limits>
 #include <algorithm>
+#include <cctype>
+#include <climits>
+#include <regex>
 
 using namespace std;
 
@@ -26,17 +29,24 @@ const HttpParser::ResponseParseResult HttpParser::response_parse(unique_ptr<char
 int HttpParser::on_status(http_parser* parser, const char* data, size_t length)
 {
     auto self = static_cast<HttpParser*>(parser->data);
+    self->result.http_status = parser->status_code;
 
     switch (parser->status_code)
     {
     case 200:
     case 202:
     case 203:
+    // Answer to a Range request of a resumed download
+    case 206:
+    // Answer to a conditional request, no body
+    case 304:
         break;
 
     case 301:
     case 302:
     case 303:
+    case 307:
+    case 308:
         self->redirect = true;
         break;
 
@@ -101,7 +111,10 @@ int HttpParser::on_headers_complete(http_parser* parser)
         if ( it != std::end(self->headers) )
         {
             self->result.redirect_uri = std::move( self->headers["Location"] );
-            self->stop(State::Redirect);
+            // A framed body on a persistent connection is skipped, the connection can take the next request
+            const bool framed = (parser->flags & F_CHUNKED) || parser->content_length != ULLONG_MAX;
+            if ( !(http_should_keep_alive(parser) && framed) )
+                self->stop(State::Redirect);
         } else
         {
             self->result.err_str = "Invalid redirect, missing Location header";
@@ -109,19 +122,30 @@ int HttpParser::on_headers_complete(http_parser* parser)
         }
     } else
     {
-        assert( parser->content_length <= numeric_limits<std::size_t>::max() );
-        self->result.content_length = parser->content_length;
+        // Not set (ULLONG_MAX) for a bodyless 304
+        if (parser->status_code != 304)
+        {
+            assert( parser->content_length <= numeric_limits<std::size_t>::max() );
+            self->result.content_length = parser->content_length;
+        }
+        self->result.etag = self->header("ETag");
+        self->result.last_modified = self->header("Last-Modified");
+        if (parser->status_code == 206)
+            self->parse_content_range( self->header("Content-Range") );
     }
+    self->result.headers_complete = true;
 
     return 0;
 }
 
 int HttpParser::on_body(http_parser* parser, const char* data, size_t length)
 {
+    auto self = static_cast<HttpParser*>(parser->data);
+    if (self->redirect)
+        return 0;
+
     auto buffer = make_unique<char[]>(length);
     std::copy_n( data, length, buffer.get() );
-
-    auto self = static_cast<HttpParser*>(parser->data);
     self->cb_on_data(std::move(buffer), length);
 
     return 0;
@@ -130,6 +154,12 @@ int HttpParser::on_body(http_parser* parser, const char* data, size_t length)
 int HttpParser::on_message_complete(http_parser* parser)
 {
     auto self = static_cast<HttpParser*>(parser->data);
+    if (self->redirect)
+    {
+        self->result.keep_alive = http_should_keep_alive(parser);
+        self->stop(State::Redirect);
+        return 0;
+    }
     self->stop(State::Done);
     return 0;
 }
@@ -140,6 +170,36 @@ void HttpParser::stop(State state)
     http_parser_pause(&parser, 1u);
 }
 
+// Field names are case-insensitive
+string HttpParser::header(const string& name) const
+{
+    const auto equal = [](char a, char b) { return ::tolower( static_cast<unsigned char>(a) ) == ::tolower( static_cast<unsigned char>(b) ); };
+    for (const auto& h : headers)
+        if ( h.first.size() == name.size() && std::equal( h.first.begin(), h.first.end(), name.begin(), equal ) )
+            return h.second;
+    return string{};
+}
+
+// "bytes <first>-<last>/<total>", total may be "*". Left unset if malformed
+void HttpParser::parse_content_range(const string& value)
+{
+    static const regex re{"^bytes[ \t]+(\\d+)-(\\d+)/(\\d+|\\*)$", regex::icase};
+    smatch match;
+    if ( !regex_match(value, match, re) )
+        return;
+
+    try {
+        const size_t first = stoull( match[1].str() );
+        const size_t last = stoull( match[2].str() );
+        const size_t total = (match[3].str() == "*") ? 0 : stoull( match[3].str() );
+        if ( last < first || (total != 0 && last >= total) )
+            return;
+        result.content_range = true;
+        result.range_start = first;
+        result.range_total = total;
+    } catch (const exception&) {}
+}
+
 /* uri parser */
 
 static const map<string, unsigned short> proto_default_port{
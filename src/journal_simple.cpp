@@ -0,0 +1,104 @@
+#include "journal_simple.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::runtime_error;
+using ::std::chrono::milliseconds;
+
+JournalSimple::JournalSimple(const string& fname, size_t batch_, milliseconds interval_)
+    : batch{batch_},
+      interval{interval_},
+      last_flush{ Clock::now() }
+{
+    load(fname);
+
+    if ( !log.open(fname) )
+        throw runtime_error{"JournalSimple: can`t open <" + fname + ">"};
+}
+
+JournalSimple::~JournalSimple()
+{
+    try {
+        flush();
+    } catch (...) {}
+}
+
+void JournalSimple::record(size_t line, bool success)
+{
+    if (success)
+        mark(line);
+
+    pending += to_string(line);
+    pending += (success) ? " D\n" : " F\n";
+    pending_count++;
+
+    if (on_due)
+    {
+        if (pending_count >= batch)
+            on_due();
+        return;
+    }
+    if ( pending_count >= batch || Clock::now() - last_flush >= interval )
+        flush();
+}
+
+void JournalSimple::flush()
+{
+    if ( !write( take() ) )
+        throw runtime_error{"JournalSimple: write failed"};
+}
+
+string JournalSimple::take()
+{
+    last_flush = Clock::now();
+    pending_count = 0;
+    string data;
+    data.swap(pending);
+    return data;
+}
+
+void JournalSimple::put_back(string data)
+{
+    pending_count += static_cast<size_t>( std::count( data.begin(), data.end(), '\n' ) );
+    data += pending;
+    pending.swap(data);
+}
+
+bool JournalSimple::write(const string& data) const noexcept
+{
+    return log.append(data);
+}
+
+void JournalSimple::load(const string& fname)
+{
+    AppendLog::load( fname, [this](const string& buf)
+    {
+        const auto space = buf.find(' ');
+        if (space == string::npos || space == 0 || space + 2 != buf.size())
+            return;
+
+        size_t line;
+        try {
+            line = std::stoul( buf.substr(0, space) );
+        } catch (const std::exception&) {
+            return;
+        }
+
+        if (buf.back() == 'D')
+        {
+            mark(line);
+            loaded_count++;
+        }
+    } );
+}
+
+void JournalSimple::mark(size_t line)
+{
+    if ( line >= done.size() )
+        done.resize( std::max(line + 1, done.size() * 2) );
+    done[line] = true;
+}
@@ -0,0 +1,102 @@
+#include "journal_writer.h"
+#include "metrics.h"
+
+#include <iostream>
+
+using ::std::string;
+using ::std::weak_ptr;
+using ::std::shared_ptr;
+using ::std::make_shared;
+
+void JournalWriter::start()
+{
+    weak_ptr<JournalWriter> weak = shared_from_this();
+    log.set_OnDue( [weak]()
+    {
+        if ( auto self = weak.lock() )
+            self->write();
+    } );
+
+    timer = loop->resource<AIO_UVW::TimerHandle>();
+    if (!timer)
+        return;
+    timer->on<::uvw::TimerEvent>( [weak](const auto&, const auto&)
+    {
+        if ( auto self = weak.lock() )
+            self->write();
+    } );
+    const auto interval = AIO_UVW::TimerHandle::Time{ log.flush_interval().count() };
+    timer->start(interval, interval);
+}
+
+void JournalWriter::close()
+{
+    log.set_OnDue(nullptr);
+    if (timer)
+    {
+        timer->clear();
+        timer->close();
+        timer.reset();
+    }
+}
+
+void JournalWriter::write()
+{
+    if (writing)
+    {
+        again = true;
+        return;
+    }
+
+    auto data = make_shared<string>( log.take() );
+    if ( data->empty() )
+        return;
+
+    // Written on the threadpool, read on the loop after WorkEvent
+    auto written = make_shared<bool>(false);
+    auto work = loop->resource<AIO_UVW::WorkReq>( [&log = log, data, written]()
+    {
+        *written = log.write(*data);
+    } );
+    if (!work)
+    {
+        on_written( log.write(*data), data );
+        return;
+    }
+
+    // The log outlives the loop run, the writer may be released before the work completes
+    auto self = shared_from_this();
+    work->once<::uvw::ErrorEvent>( [self, data](const auto&, const auto&)
+    {
+        metrics::registry().threadpool_requests.sub();
+        self->on_written(false, data);
+    } );
+    work->once<::uvw::WorkEvent>( [self, written, data](const auto&, const auto&)
+    {
+        metrics::registry().threadpool_requests.sub();
+        self->on_written(*written, data);
+    } );
+    writing = true;
+    metrics::registry().threadpool_requests.add();
+    work->queue();
+}
+
+void JournalWriter::on_written(bool ok, const shared_ptr<string>& data)
+{
+    writing = false;
+    if (!ok)
+    {
+        // Retried with the next write, a record written twice is harmless
+        log.put_back( std::move(*data) );
+        if (!failed)
+        {
+            failed = true;
+            std::cerr << name << " write failed, retrying" << std::endl;
+        }
+    }
+    if (again)
+    {
+        again = false;
+        write();
+    }
+}
@@ -0,0 +1,150 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+
+using namespace metrics;
+
+using ::std::size_t;
+using ::std::uint64_t;
+using ::std::ostream;
+
+static void header(ostream& out, const char* name, const char* type, const char* help)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+static void write(ostream& out, const char* name, const char* help, const Counter& counter)
+{
+    header(out, name, "counter", help);
+    out << name << " " << counter.value() << "\n";
+}
+
+static void write(ostream& out, const char* name, const char* help, const Gauge& gauge)
+{
+    header(out, name, "gauge", help);
+    out << name << " " << gauge.value() << "\n";
+}
+
+uint64_t LatencyHistogram::percentile(double q) const noexcept
+{
+    const uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    auto rank = static_cast<uint64_t>( q * static_cast<double>(total) + 0.5 );
+    rank = std::max<uint64_t>( std::min(rank, total), 1 );
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        if (cumulative >= rank)
+            return highest_equivalent(i);
+    }
+    // Concurrent writers may bump count before bucket
+    return highest_equivalent(bucket_count - 1);
+}
+
+static void print_seconds(ostream& out, uint64_t us)
+{
+    const auto flags = out.flags();
+    const auto fill = out.fill();
+    out << us / 1000000 << "." << std::setw(6) << std::setfill('0') << us % 1000000;
+    out.flags(flags);
+    out.fill(fill);
+}
+
+static void write(ostream& out, const char* name, const char* help, const LatencyHistogram& histogram)
+{
+    header(out, name, "summary", help);
+    static const std::pair<double, const char*> quantiles[] = { {0.5, "0.5"}, {0.99, "0.99"}, {0.999, "0.999"} };
+    for (const auto& q : quantiles)
+    {
+        out << name << "{quantile=\"" << q.second << "\"} ";
+        print_seconds( out, histogram.percentile(q.first) );
+        out << "\n";
+    }
+    out << name << "_sum ";
+    print_seconds(out, histogram.sum_us());
+    out << "\n" << name << "_count " << histogram.count() << "\n";
+}
+
+void metrics::write_prometheus(ostream& out, const Registry& r)
+{
+    write(out, "downloader_bytes_total", "Bytes of response bodies received", r.bytes_downloaded);
+
+    header(out, "downloader_jobs_total", "counter", "Finished downloaders by final state");
+    out << "downloader_jobs_total{state=\"done\"} " << r.jobs_done.value() << "\n"
+        << "downloader_jobs_total{state=\"failed\"} " << r.jobs_failed.value() << "\n"
+        << "downloader_jobs_total{state=\"redirect\"} " << r.jobs_redirect.value() << "\n";
+    write(out, "downloader_jobs_running", "Downloaders on the go", r.jobs_running);
+    write(out, "downloader_not_modified_total", "Done downloaders answered 304 Not Modified", r.jobs_not_modified);
+    write(out, "downloader_not_modified_bytes_total", "Size of files left as is on 304 Not Modified", r.bytes_not_modified);
+
+    write(out, "downloader_resolve_seconds", "Time of getaddrinfo", r.resolve_latency);
+    write(out, "downloader_connect_seconds", "Time from resolved address to established connection", r.connect_latency);
+    write(out, "downloader_ttfb_seconds", "Time from written request to the first response byte", r.ttfb_latency);
+    write(out, "downloader_transfer_seconds", "Time from the first response byte to the closed file", r.transfer_duration);
+    write(out, "downloader_total_seconds", "Time from resolve start to the closed file of done downloaders", r.total_duration);
+
+    write(out, "downloader_buffered_bytes", "Bytes received and waiting for file write", r.downloader_buffered_bytes);
+    write(out, "downloader_threadpool_requests", "getaddrinfo, file write, chunk stage and object cache requests queued to the libuv threadpool", r.threadpool_requests);
+
+    write(out, "downloader_checksum_failures_total", "Files removed because their digest differed from the task", r.checksum_failures);
+    write(out, "redirects_followed_total", "Redirects within the origin followed on the open connection", r.redirects_followed);
+    write(out, "redirects_cached_total", "Redirect hops skipped by the permanent redirect cache", r.redirects_cached);
+
+    write(out, "mirror_switches_total", "Mirrored downloads moved to a faster mirror mid-file", r.mirror_switches);
+
+    write(out, "cache_hits_total", "Jobs satisfied from the object cache", r.cache_hits);
+    write(out, "cache_misses_total", "Jobs not found in the object cache, sent to the network", r.cache_misses);
+    write(out, "cache_saved_bytes_total", "Bytes restored from the object cache instead of downloaded", r.cache_bytes_saved);
+
+    write(out, "socket_received_bytes_total", "Bytes read from sockets, before bandwidth limit", r.socket_received_bytes);
+    write(out, "socket_buffered_bytes", "Bytes held by sockets until granted by the bandwidth controller", r.socket_buffered_bytes);
+    write(out, "socket_throttled_total", "Sockets paused by the memory budget", r.socket_throttled);
+
+    write(out, "memory_budget_used_bytes", "Queued chunk bytes accounted by the memory budget", r.memory_used);
+    write(out, "memory_budget_peak_bytes", "Highest memory_budget_used_bytes of the run", r.memory_peak);
+    write(out, "memory_budget_limit_bytes", "Memory budget limit, consumers are throttled above it", r.memory_limit);
+
+    write(out, "bandwidth_cycles_total", "Bandwidth controller transfer cycles", r.bandwidth_cycles);
+    write(out, "bandwidth_deferred_total", "Bandwidth controller cycles deferred by timer", r.bandwidth_deferred);
+    write(out, "bandwidth_granted_bytes_total", "Bytes granted to sockets by the bandwidth controller", r.bandwidth_granted_bytes);
+    write(out, "bandwidth_effective_limit_bytes", "Current bandwidth limit, including storage ceiling", r.bandwidth_effective_limit);
+}
+
+static void print_ms(ostream& out, uint64_t us)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(1) << std::setw(10) << static_cast<double>(us) / 1000;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void metrics::write_latency_summary(ostream& out, const Registry& r)
+{
+    static const std::pair<const char*, const LatencyHistogram Registry::*> phases[] = {
+        {"resolve", &Registry::resolve_latency},
+        {"connect", &Registry::connect_latency},
+        {"ttfb", &Registry::ttfb_latency},
+        {"transfer", &Registry::transfer_duration},
+        {"total", &Registry::total_duration}
+    };
+
+    out << "Latency, ms        p50       p99      p999     count" << "\n";
+    for (const auto& phase : phases)
+    {
+        const LatencyHistogram& histogram = r.*(phase.second);
+        const auto flags = out.flags();
+        out << std::left << std::setw(10) << phase.first;
+        out.flags(flags);
+        print_ms( out, histogram.percentile(0.5) );
+        print_ms( out, histogram.percentile(0.99) );
+        print_ms( out, histogram.percentile(0.999) );
+        out << std::setw(10) << histogram.count() << "\n";
+    }
+}
@@ -0,0 +1,44 @@
+#include "metrics_server.h"
+
+#include <sstream>
+
+using ::std::string;
+using ::std::ostringstream;
+using ::std::to_string;
+
+string metrics::http_response(const string& request, const Registry& registry)
+{
+    const auto line_end = request.find_first_of("\r\n");
+    const string line = request.substr(0, line_end);
+
+    const auto method_end = line.find(' ');
+    const auto path_end = (method_end == string::npos) ? string::npos : line.find_first_of(" ?", method_end + 1);
+    const string method = line.substr(0, method_end);
+    const string path = (method_end == string::npos) ? string{} : line.substr(method_end + 1, path_end - method_end - 1);
+
+    string status;
+    string body;
+    string content_type = "text/plain; charset=utf-8";
+    if (method != "GET")
+    {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    } else if (path != "/metrics")
+    {
+        status = "404 Not Found";
+        body = "Try /metrics\n";
+    } else
+    {
+        ostringstream out;
+        write_prometheus(out, registry);
+        status = "200 OK";
+        body = out.str();
+        content_type = "text/plain; version=0.0.4; charset=utf-8";
+    }
+
+    return "HTTP/1.0 " + status + "\r\n"
+           "Content-Type: " + content_type + "\r\n"
+           "Content-Length: " + to_string( body.size() ) + "\r\n"
+           "Connection: close\r\n"
+           "\r\n" + body;
+}
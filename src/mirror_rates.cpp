@@ -0,0 +1,18 @@
+#include "mirror_rates.h"
+
+using ::std::string;
+
+double MirrorRates::estimate(const string& host) const
+{
+    auto it = rates.find(host);
+    return (it != rates.end()) ? it->second : -1;
+}
+
+void MirrorRates::record(const string& host, double rate)
+{
+    auto it = rates.find(host);
+    if ( it == rates.end() )
+        rates.emplace(host, rate);
+    else
+        it->second += weight * (rate - it->second);
+}
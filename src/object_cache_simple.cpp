@@ -0,0 +1,367 @@
+#include "object_cache_simple.h"
+#include "sha256.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::vector;
+using ::std::pair;
+using ::std::runtime_error;
+
+namespace {
+
+const size_t copy_buffer = 64 * 1024;
+
+bool storable(const string& s)
+{
+    return s.find_first_of("\t\r\n") == string::npos;
+}
+
+bool is_hash(const string& s)
+{
+    return s.size() == 64 && s.find_first_not_of("0123456789abcdef") == string::npos;
+}
+
+bool write_all(int fd, const char* ptr, size_t left)
+{
+    while (left > 0)
+    {
+        auto written = ::write(fd, ptr, left);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        left -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Shares extents on btrfs/xfs, fails elsewhere
+bool clone(int from, int to)
+{
+#ifdef FICLONE
+    return ::ioctl(to, FICLONE, from) == 0;
+#else
+    (void)from; (void)to;
+    return false;
+#endif
+}
+
+/* Copies unless cloned, feeds hash (when given) either way. Returns bytes read or -1 */
+long long transfer(int from, int to, Sha256* hash)
+{
+    const bool cloned = clone(from, to);
+    if ( !hash && cloned )
+    {
+        struct stat st;
+        return (::fstat(from, &st) == 0) ? st.st_size : -1;
+    }
+
+    vector<char> buf(copy_buffer);
+    long long total = 0;
+    for (;;)
+    {
+        auto n = ::read( from, buf.data(), buf.size() );
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            return total;
+        if (hash)
+            hash->update( buf.data(), static_cast<size_t>(n) );
+        if ( !cloned && !write_all( to, buf.data(), static_cast<size_t>(n) ) )
+            return -1;
+        total += n;
+    }
+}
+
+} // namespace
+
+ObjectCacheSimple::ObjectCacheSimple(const string& dir_, size_t capacity_)
+    : dir{dir_},
+      m_capacity{capacity_}
+{
+    for (const auto& path : { dir, dir + "/objects" })
+        if ( ::mkdir(path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP) != 0 && errno != EEXIST )
+            throw runtime_error{"ObjectCacheSimple: can`t create <" + path + ">"};
+
+    scan();
+    if ( load() > 2 * entries.size() + 64 )
+        compact();
+    if ( load_uses() > 2 * objects.size() + 64 )
+        compact_uses();
+    evict();
+
+    if ( !log.open( index_path() ) )
+        throw runtime_error{"ObjectCacheSimple: can`t open <" + index_path() + ">"};
+    if ( !log_uses.open( uses_path() ) )
+        throw runtime_error{"ObjectCacheSimple: can`t open <" + uses_path() + ">"};
+}
+
+ObjectCacheSimple::~ObjectCacheSimple()
+{
+    try {
+        flush();
+    } catch (...) {}
+}
+
+bool ObjectCacheSimple::find(const string& uri, Entry& entry)
+{
+    auto it = entries.find(uri);
+    if ( it == entries.end() )
+        return false;
+
+    auto object = objects.find(it->second.hash);
+    if ( object == objects.end() || object->second.size != it->second.validator.size )
+    {
+        entries.erase(it);
+        return false;
+    }
+
+    lru.splice( lru.begin(), lru, object->second.lru_it );
+    // Persisted with flush(), equal mtimes of a coarse clock could not order the uses
+    pending_uses += it->second.hash + "\n";
+
+    entry = it->second;
+    return true;
+}
+
+void ObjectCacheSimple::insert(const string& uri, const Entry& entry)
+{
+    if ( !is_hash(entry.hash) || !storable(uri) || !storable(entry.validator.etag) || !storable(entry.validator.last_modified) )
+        return;
+
+    entries[uri] = entry;
+    use(entry.hash, entry.validator.size);
+    pending += format(uri, entry);
+    pending_uses += entry.hash + "\n";
+    evict();
+}
+
+void ObjectCacheSimple::forget(const string& uri)
+{
+    if ( entries.erase(uri) == 0 || !storable(uri) )
+        return;
+    pending += format( uri, Entry{} );
+}
+
+bool ObjectCacheSimple::store(const string& fname, Entry& entry) const
+{
+    int from = ::open(fname.c_str(), O_RDONLY);
+    if (from < 0)
+        return false;
+
+    string tmp = dir + "/objects/.tmp.XXXXXX";
+    int to = ::mkstemp( &tmp[0] );
+    if (to < 0)
+    {
+        ::close(from);
+        return false;
+    }
+
+    Sha256 hash;
+    const auto size = transfer(from, to, &hash);
+    ::close(from);
+    // Object under its hash must be complete after a crash
+    bool ok = size >= 0 && ::fdatasync(to) == 0;
+    ok = ::close(to) == 0 && ok;
+    if (ok)
+    {
+        entry.hash = hash.hex();
+        entry.validator.size = static_cast<size_t>(size);
+        // Same content replaces the same content, a concurrent reader keeps the old inode
+        ok = ::rename( tmp.c_str(), object_path(entry.hash).c_str() ) == 0;
+    }
+    if (!ok)
+        ::unlink( tmp.c_str() );
+    return ok;
+}
+
+bool ObjectCacheSimple::restore(const Entry& entry, const string& fname) const
+{
+    int from = ::open(object_path(entry.hash).c_str(), O_RDONLY);
+    if (from < 0)
+        return false;
+
+    int to = ::open(fname.c_str(), O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP);
+    if (to < 0)
+    {
+        const int err = errno;
+        ::close(from);
+        errno = err;
+        return false;
+    }
+
+    const auto size = transfer(from, to, nullptr);
+    ::close(from);
+    bool ok = ::close(to) == 0 && size >= 0 && static_cast<size_t>(size) == entry.validator.size;
+    if (!ok)
+        ::unlink( fname.c_str() );
+    return ok;
+}
+
+void ObjectCacheSimple::flush()
+{
+    if ( !log.append(pending) )
+        throw runtime_error{"ObjectCacheSimple: write failed"};
+    pending.clear();
+
+    // Recency is a hint, lost uses only misorder eviction
+    if ( !log_uses.append(pending_uses, false) )
+        throw runtime_error{"ObjectCacheSimple: write failed"};
+    pending_uses.clear();
+}
+
+string ObjectCacheSimple::format(const string& uri, const Entry& entry)
+{
+    return entry.hash + "\t" + to_string(entry.validator.size) + "\t" + entry.validator.etag + "\t" + entry.validator.last_modified + "\t" + uri + "\n";
+}
+
+/* Objects on disk, ordered by mtime until load_uses(). Leftovers of interrupted store() are removed */
+void ObjectCacheSimple::scan()
+{
+    const string path = dir + "/objects";
+    DIR* d = ::opendir( path.c_str() );
+    if (!d)
+        throw runtime_error{"ObjectCacheSimple: can`t read <" + path + ">"};
+
+    vector< pair<struct timespec, pair<string, size_t>> > found;
+    while (auto ent = ::readdir(d))
+    {
+        const string name = ent->d_name;
+        if ( name.compare(0, 5, ".tmp.") == 0 )
+        {
+            ::unlink( (path + "/" + name).c_str() );
+            continue;
+        }
+        struct stat st;
+        if ( !is_hash(name) || ::stat( object_path(name).c_str(), &st ) != 0 || !S_ISREG(st.st_mode) )
+            continue;
+        found.emplace_back( st.st_mtim, pair<string, size_t>{ name, static_cast<size_t>(st.st_size) } );
+    }
+    ::closedir(d);
+
+    std::sort( found.begin(), found.end(), [](const auto& a, const auto& b)
+    {
+        return (a.first.tv_sec != b.first.tv_sec) ? a.first.tv_sec < b.first.tv_sec : a.first.tv_nsec < b.first.tv_nsec;
+    } );
+    for (const auto& object : found)
+        use(object.second.first, object.second.second);
+}
+
+// Returns count of records
+size_t ObjectCacheSimple::load()
+{
+    return AppendLog::load( index_path(), [this](const string& buf)
+    {
+        size_t tabs[4];
+        size_t pos = 0;
+        bool valid = true;
+        for (auto& tab : tabs)
+        {
+            tab = buf.find('\t', pos);
+            if (tab == string::npos)
+            {
+                valid = false;
+                break;
+            }
+            pos = tab + 1;
+        }
+        if ( !valid || tabs[3] + 1 == buf.size() )
+            return;
+
+        Entry entry;
+        entry.hash = buf.substr(0, tabs[0]);
+        try {
+            entry.validator.size = std::stoul( buf.substr(tabs[0] + 1, tabs[1] - tabs[0] - 1) );
+        } catch (const std::exception&) {
+            return;
+        }
+        entry.validator.etag = buf.substr(tabs[1] + 1, tabs[2] - tabs[1] - 1);
+        entry.validator.last_modified = buf.substr(tabs[2] + 1, tabs[3] - tabs[2] - 1);
+        auto uri = buf.substr(tabs[3] + 1);
+
+        if ( entry.hash.empty() )
+            entries.erase(uri);
+        else if ( is_hash(entry.hash) )
+            entries[ std::move(uri) ] = std::move(entry);
+    } );
+}
+
+// Replays the use log over the objects found by scan(), returns count of records
+size_t ObjectCacheSimple::load_uses()
+{
+    return AppendLog::load( uses_path(), [this](const string& buf)
+    {
+        auto it = objects.find(buf);
+        if ( it != objects.end() )
+            lru.splice( lru.begin(), lru, it->second.lru_it );
+    } );
+}
+
+/* Rewrites the index with live entries only, atomically by rename */
+void ObjectCacheSimple::compact()
+{
+    for (auto it = entries.begin(); it != entries.end();)
+        it = objects.count(it->second.hash) ? std::next(it) : entries.erase(it);
+
+    string data;
+    for (const auto& entry : entries)
+        data += format(entry.first, entry.second);
+    AppendLog::rewrite( index_path(), data );
+}
+
+/* Rewrites the use log with one record per object, least recently used first */
+void ObjectCacheSimple::compact_uses()
+{
+    string data;
+    for (auto it = lru.rbegin(); it != lru.rend(); ++it)
+        data += *it + "\n";
+    AppendLog::rewrite( uses_path(), data );
+}
+
+void ObjectCacheSimple::use(const string& hash, size_t size)
+{
+    auto it = objects.find(hash);
+    if ( it != objects.end() )
+    {
+        lru.splice( lru.begin(), lru, it->second.lru_it );
+        return;
+    }
+    lru.push_front(hash);
+    objects.emplace( hash, Object{ size, lru.begin() } );
+    m_used += size;
+}
+
+void ObjectCacheSimple::evict()
+{
+    while ( m_used > m_capacity && !lru.empty() )
+    {
+        const string& hash = lru.back();
+        ::unlink( object_path(hash).c_str() );
+        auto it = objects.find(hash);
+        m_used -= it->second.size;
+        objects.erase(it);
+        lru.pop_back();
+    }
+}
@@ -1,15 +1,17 @@
 #include "on_tick_simple.h"
 
-#include <algorithm>
 #include <exception>
+#include <ostream>
 
+using ::std::size_t;
 using ::std::shared_ptr;
 using ::std::string;
 using ::std::move;
 using ::std::begin;
 using ::std::end;
-using ::std::find_if;
+using ::std::prev;
 using ::std::runtime_error;
+using ::std::ostream;
 
 void OnTickSimple::invoke(shared_ptr<Downloader> downloader)
 {
@@ -23,8 +25,10 @@ void OnTickSimple::invoke(shared_ptr<Downloader> downloader)
     switch (status.state)
     {
     case State::Done:
+        next_task(job_it, true);
+        break;
     case State::Failed:
-        next_task(job_it);
+        next_task(job_it, false);
         break;
     case State::Redirect:
         redirect(job_it, status.redirect_uri);
@@ -34,27 +38,77 @@ void OnTickSimple::invoke(shared_ptr<Downloader> downloader)
     }
 }
 
-void OnTickSimple::next_task(const ConstIt job_it)
+void OnTickSimple::start(size_t concurrency)
+{
+    vacant += concurrency;
+    fill();
+    check_complete();
+}
+
+void OnTickSimple::next_task(const ConstIt job_it, bool success)
 {
+    task_list.finish(job_it->line, success);
+    index.erase( job_it->downloader.get() );
     job_list.erase(job_it);
+    vacant++;
+    fill();
+    check_complete();
+}
 
+void OnTickSimple::sweep()
+{
+    for (const Job& job : job_list)
+        if (job.downloader)
+            dashboard.progress( job.id, job.downloader->status() );
+    dashboard.sweep_done();
+}
+
+void OnTickSimple::drain()
+{
+    draining = true;
+    check_complete();
+}
+
+void OnTickSimple::snapshot(ostream& out) const
+{
+    out << "Jobs: " << job_list.size() << " running, " << vacant << " vacant slots" << (draining ? ", draining" : "") << '\n';
+    for (const Job& job : job_list)
+    {
+        if ( !job.downloader )
+            continue;
+        const auto& status = job.downloader->status();
+        out << "#" << job.id << " <" << job.fname << "> " << status.downloaded << "/" << status.size << " bytes, " << status.str() << '\n';
+    }
+}
+
+/* TaskList may hold back tasks (e.g. per host limit), so a vacant slot
+ * stays open until the next finished job gives another chance to fill it */
+void OnTickSimple::fill()
+{
     auto factory = weak_factory.lock();
-    if ( !factory )
+    if ( !factory || draining )
         return;
 
-    for (;;)
+    while (vacant > 0)
     {
         auto task = task_list.get();
         if ( !task )
             return;
 
-        Job job{task->fname};
-        job.downloader = factory->create(job.id, task->uri, task->fname);
+        Job job{task->fname, task->line};
+        job.digest = task->digest;
+        dashboard.started(job.id, job.fname);
+        job.downloader = factory->create(job.id, task->uri, task->fname, job.digest);
         if ( !job.downloader )
+        {
+            task_list.finish(task->line, false);
             continue;
+        }
 
+        Downloader* key = job.downloader.get();
         job_list.push_back( move(job) );
-        break;
+        index.emplace( key, prev( end(job_list) ) );
+        vacant--;
     }
 }
 
@@ -64,31 +118,44 @@ void OnTickSimple::redirect(It job_it, const string& uri)
     {
         StatusDownloader status;
         status.state = StatusDownloader::State::Failed;
-        status.state_str = "Maximum count redirect";
+        status.error = StatusDownloader::Error::MaxRedirect;
         dashboard.update(job_it->id, status);
 
-        next_task(job_it);
+        next_task(job_it, false);
         return;
     }
 
+    index.erase( job_it->downloader.get() );
     auto factory = weak_factory.lock();
     if (factory)
     {
-        job_it->downloader = factory->create(job_it->id, uri, job_it->fname);
-        if ( !(job_it->downloader) )
-            next_task(job_it);
+        job_it->downloader = factory->create(job_it->id, uri, job_it->fname, job_it->digest);
+        if ( job_it->downloader )
+            index.emplace( job_it->downloader.get(), job_it );
+        else
+            next_task(job_it, false);
 
     } else
     {
         job_list.erase(job_it);
+        check_complete();
     }
 }
 
 OnTickSimple::It OnTickSimple::find_job(Downloader* downloader)
 {
-    auto it = find_if( begin(job_list), end(job_list),
-                            [&downloader](const Job& job) { return job.downloader.get() == downloader; } );
-    if ( it == end(job_list) )
+    auto it = index.find(downloader);
+    if ( it == end(index) )
         throw runtime_error{"OnTickSimple => invalid Downloader"};
-    return it;
+    return it->second;
+}
+
+void OnTickSimple::check_complete()
+{
+    if ( job_list.empty() && on_complete )
+    {
+        auto cb = move(on_complete);
+        on_complete = nullptr;
+        cb();
+    }
 }
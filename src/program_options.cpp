@@ -20,19 +20,68 @@ static const string usage =
 R"(Ecwid-Console-downloader https://github.com/Ecwid/new-job/blob/master/Console-downloader.md
 
         Usage:
-         Ecwid-Console-downloader -n <concurrency> -l <speed limit> -o <output path> -f <task file name>
+         Ecwid-Console-downloader -n <concurrency> -l <speed limit> -o <output path> -f <task file name> [-m <memory limit>] [-p <connections per host>] [-j <journal file>] [-c <validator file>] [-C <cache dir>] [-s <cache size>] [-R <redirect file>] [-D <digest algorithm>] [-r <progress rate>] [-d <drain timeout>] [--json] [-v] [-M <metrics address>] [--trace <trace file>]
          Ecwid-Console-downloader (-h | --help)
 
         Options:
          -h --help  Show this message
+         -j         Record finished tasks, a rerun skips them and replaces the files left by the others
+         -c         Store ETag/Last-Modified of downloaded files, revalidate them with conditional GET on the next run
+         -C         Keep downloaded files in a content-addressed cache, reuse them for the same URI on later runs
+         -s         Cache size, least recently used files are evicted over it, 1G by default
+         -D         Write <file>.sha256 or <file>.crc32c with the digest of every downloaded file.
+                    A task line may carry an expected digest as the third column, "sha256:<hex>" or "crc32c:<hex>"
+         -R         Keep permanent redirects (301, 308) across runs, later tasks go straight to the target
+         --json     Print job events as JSON lines
+         -v         Live progress view on stderr, redrawn <progress rate> times per second.
+                    Needs stdout and stderr on different terminals or files
+         -M         Serve Prometheus metrics on [ip:]port at /metrics
+         --trace    Write job lifecycles in Chrome trace-event format
 )";
 
+static size_t parse_size(const string& s)
+{
+    regex re{"^\\d+(k|K|m|M|g|G)?$"};
+    if ( !regex_search(s, re) )
+        throw runtime_error{"Invalid size <" + s + ">"};
+
+    switch ( s.back() )
+    {
+    case 'k':
+    case 'K':
+        return stoul( s.substr(0, s.length() - 1) ) * 1024;
+    case 'm':
+    case 'M':
+        return stoul( s.substr(0, s.length() - 1) ) * 1024 * 1024;
+    case 'g':
+    case 'G':
+        return stoul( s.substr(0, s.length() - 1) ) * 1024 * 1024 * 1024;
+    default:
+        return stoul(s);
+    }
+}
+
 const ProgramOptions parse_program_options(int argc, char* argv[])
 {
     auto options = docopt::docopt(usage, {argv + 1, argv + argc} );
 
     size_t concurrency;
     size_t speed_limit;
+    size_t memory_limit = 0;
+    size_t per_host = 0;
+    string journal_fname;
+    string validators_fname;
+    string cache_dir;
+    size_t cache_size = size_t{1024} * 1024 * 1024;
+    string redirects_fname;
+    string digest_files;
+    size_t progress_rate = 4;
+    size_t drain_timeout = 30;
+    bool json_output = false;
+    bool live_view = false;
+    string metrics_ip = "127.0.0.1";
+    unsigned int metrics_port = 0;
+    string trace_fname;
 
     try {
         auto c = options["<concurrency>"].asLong();
@@ -40,33 +89,91 @@ const ProgramOptions parse_program_options(int argc, char* argv[])
             throw runtime_error{"Invalid concurrency"};
         concurrency = static_cast<size_t>(c);
 
-        string s = options["<speed limit>"].asString();
-        regex re{"^\\d+(k|K|m|M)?$"};
-        if ( !regex_search(s, re) )
+        speed_limit = parse_size( options["<speed limit>"].asString() );
+        if (speed_limit == 0)
             throw runtime_error{"Invalid sped limit"};
 
-        switch ( s.back() )
+        if ( options["<memory limit>"] )
         {
-        case 'k':
-        case 'K':
-            speed_limit = stoul( s.substr(0, s.length() - 1) ) * 1024;
-            break;
-        case 'm':
-        case 'M':
-            speed_limit = stoul( s.substr(0, s.length() - 1) ) * 1024 * 1024;
-            break;
-        default:
-            speed_limit = stoul(s);
-            break;
+            memory_limit = parse_size( options["<memory limit>"].asString() );
+            if (memory_limit == 0)
+                throw runtime_error{"Invalid memory limit"};
         }
 
-        if (speed_limit == 0)
-            throw runtime_error{"Invalid sped limit"};
+        if ( options["<connections per host>"] )
+        {
+            auto p = options["<connections per host>"].asLong();
+            if (p <= 0)
+                throw runtime_error{"Invalid connections per host"};
+            per_host = static_cast<size_t>(p);
+        }
+
+        if ( options["<journal file>"] )
+            journal_fname = options["<journal file>"].asString();
+
+        if ( options["<validator file>"] )
+            validators_fname = options["<validator file>"].asString();
+
+        if ( options["<cache dir>"] )
+            cache_dir = options["<cache dir>"].asString();
+
+        if ( options["<cache size>"] )
+        {
+            cache_size = parse_size( options["<cache size>"].asString() );
+            if (cache_size == 0)
+                throw runtime_error{"Invalid cache size"};
+        }
+
+        if ( options["<redirect file>"] )
+            redirects_fname = options["<redirect file>"].asString();
+
+        if ( options["<digest algorithm>"] )
+        {
+            digest_files = options["<digest algorithm>"].asString();
+            if (digest_files != "sha256" && digest_files != "crc32c")
+                throw runtime_error{"Invalid digest algorithm <" + digest_files + ">"};
+        }
+
+        if ( options["<progress rate>"] )
+        {
+            auto r = options["<progress rate>"].asLong();
+            if (r <= 0 || r > 100)
+                throw runtime_error{"Invalid progress rate"};
+            progress_rate = static_cast<size_t>(r);
+        }
+
+        if ( options["<drain timeout>"] )
+        {
+            auto d = options["<drain timeout>"].asLong();
+            if (d < 0)
+                throw runtime_error{"Invalid drain timeout"};
+            drain_timeout = static_cast<size_t>(d);
+        }
+
+        if ( options["<metrics address>"] )
+        {
+            const string address = options["<metrics address>"].asString();
+            std::smatch match;
+            if ( !std::regex_match(address, match, regex{"^(?:(.+):)?(\\d{1,5})$"}) )
+                throw runtime_error{"Invalid metrics address <" + address + ">"};
+            if ( match[1].matched )
+                metrics_ip = match[1].str();
+            const auto port = stol( match[2].str() );
+            if (port == 0 || port > 65535)
+                throw runtime_error{"Invalid metrics port"};
+            metrics_port = static_cast<unsigned int>(port);
+        }
+
+        if ( options["<trace file>"] )
+            trace_fname = options["<trace file>"].asString();
+
+        json_output = options["--json"].asBool();
+        live_view = options["-v"].asBool();
 
     } catch (runtime_error& e) {
         cout << e.what() << endl << usage;
         exit(1);
     }
 
-    return ProgramOptions{ concurrency, speed_limit, move( options["<output path>"].asString() ), move( options["<task file name>"].asString() ) };
+    return ProgramOptions{ concurrency, speed_limit, move( options["<output path>"].asString() ), move( options["<task file name>"].asString() ), memory_limit, per_host, journal_fname, validators_fname, cache_dir, cache_size, redirects_fname, digest_files, progress_rate, drain_timeout, json_output, live_view, metrics_ip, metrics_port, trace_fname };
 }
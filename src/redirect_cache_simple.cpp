@@ -0,0 +1,128 @@
+#include "redirect_cache_simple.h"
+
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::vector;
+using ::std::runtime_error;
+
+namespace {
+
+bool storable(const string& s)
+{
+    return !s.empty() && s.find_first_of("\t\r\n") == string::npos;
+}
+
+} // namespace
+
+constexpr size_t RedirectCacheSimple::max_chain;
+
+RedirectCacheSimple::RedirectCacheSimple(size_t capacity_, const string& fname)
+    : capacity{capacity_}
+{
+    if ( fname.empty() )
+        return;
+
+    const auto records = load(fname);
+    if ( records > 2 * entries.size() + 64 )
+        compact(fname);
+
+    if ( !log.open(fname) )
+        throw runtime_error{"RedirectCacheSimple: can`t open <" + fname + ">"};
+}
+
+RedirectCacheSimple::~RedirectCacheSimple()
+{
+    try {
+        flush();
+    } catch (...) {}
+}
+
+bool RedirectCacheSimple::find(const string& uri, string& target)
+{
+    vector<string> visited{uri};
+    string current = uri;
+    while ( visited.size() <= max_chain )
+    {
+        auto it = index.find(current);
+        if ( it == index.end() )
+            break;
+        entries.splice( entries.begin(), entries, it->second );
+        current = it->second->second;
+        // A loop is left to the network, it ends with MaxRedirect there
+        if ( std::find( visited.begin(), visited.end(), current ) != visited.end() )
+            return false;
+        visited.push_back(current);
+    }
+    if (visited.size() == 1)
+        return false;
+
+    target = std::move(current);
+    return true;
+}
+
+void RedirectCacheSimple::record(const string& uri, const string& target)
+{
+    if ( uri == target || !storable(uri) || !storable(target) )
+        return;
+
+    auto it = index.find(uri);
+    if ( it != index.end() && it->second->second == target )
+    {
+        entries.splice( entries.begin(), entries, it->second );
+        return;
+    }
+    insert(uri, target);
+
+    if ( log.is_open() )
+        pending += uri + "\t" + target + "\n";
+}
+
+void RedirectCacheSimple::flush()
+{
+    if ( !log.append(pending) )
+        throw runtime_error{"RedirectCacheSimple: write failed"};
+    pending.clear();
+}
+
+void RedirectCacheSimple::insert(const string& uri, const string& target)
+{
+    auto it = index.find(uri);
+    if ( it != index.end() )
+    {
+        it->second->second = target;
+        entries.splice( entries.begin(), entries, it->second );
+        return;
+    }
+
+    entries.emplace_front(uri, target);
+    index.emplace( uri, entries.begin() );
+    if ( entries.size() > capacity )
+    {
+        index.erase( entries.back().first );
+        entries.pop_back();
+    }
+}
+
+size_t RedirectCacheSimple::load(const string& fname)
+{
+    return AppendLog::load( fname, [this](const string& buf)
+    {
+        const auto tab = buf.find('\t');
+        if (tab == string::npos || tab == 0 || tab + 1 == buf.size())
+            return;
+        insert( buf.substr(0, tab), buf.substr(tab + 1) );
+    } );
+}
+
+// Rewritten oldest first, so that load() restores the recency order
+void RedirectCacheSimple::compact(const string& fname)
+{
+    string data;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+        data += it->first + "\t" + it->second + "\n";
+    AppendLog::rewrite(fname, data);
+}
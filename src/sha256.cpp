@@ -0,0 +1,208 @@
+#include "sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#endif
+
+using ::std::size_t;
+using ::std::uint8_t;
+using ::std::uint32_t;
+using ::std::uint64_t;
+using ::std::string;
+
+namespace {
+
+const uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t x, unsigned n) noexcept
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+#ifdef SHA256_X86
+
+/* SHA extensions: two rounds per sha256rnds2, the message schedule by sha256msg1/msg2.
+ * The state is kept as ABEF/CDGH pairs, the instruction layout */
+__attribute__((target("sha,sse4.1")))
+void transform_shani(uint32_t* state, const uint8_t* data, size_t blocks) noexcept
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(state) ), 0xB1 );
+    __m128i state1 = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(state + 4) ), 0x1B );
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64)
+    {
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+        __m128i w[4];
+
+        // Rounds 4g..4g+3, w[g % 4] holds their message words
+        for (size_t g = 0; g < 16; g++)
+        {
+            __m128i& cur = w[g % 4];
+            if (g < 4)
+                cur = _mm_shuffle_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>(data + 16 * g) ), mask );
+
+            __m128i msg = _mm_add_epi32( cur, _mm_loadu_si128( reinterpret_cast<const __m128i*>(k + 4 * g) ) );
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g < 15)
+            {
+                __m128i& next = w[(g + 1) % 4];
+                next = _mm_add_epi32( next, _mm_alignr_epi8(cur, w[(g + 3) % 4], 4) );
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g >= 1 && g < 13)
+            {
+                __m128i& prev = w[(g + 3) % 4];
+                prev = _mm_sha256msg1_epu32(prev, cur);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(state), state0 );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(state + 4), state1 );
+}
+
+bool has_shani() noexcept
+{
+    unsigned int eax, ebx, ecx, edx;
+    if ( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1) )
+        return false;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+
+const bool shani = has_shani();
+
+#endif
+
+} // namespace
+
+Sha256::Sha256() noexcept
+    : state{ {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} },
+      block{}
+{}
+
+void Sha256::update(const void* data, size_t length) noexcept
+{
+    auto ptr = static_cast<const uint8_t*>(data);
+    total += length;
+
+    if (block_length > 0)
+    {
+        const size_t n = std::min(length, block.size() - block_length);
+        std::memcpy(block.data() + block_length, ptr, n);
+        block_length += n;
+        ptr += n;
+        length -= n;
+        if (block_length < block.size())
+            return;
+        transform( block.data(), 1 );
+        block_length = 0;
+    }
+
+    const size_t blocks = length / block.size();
+    if (blocks > 0)
+    {
+        transform(ptr, blocks);
+        ptr += blocks * block.size();
+        length -= blocks * block.size();
+    }
+
+    std::memcpy(block.data(), ptr, length);
+    block_length = length;
+}
+
+string Sha256::hex()
+{
+    const uint64_t bits = total * 8;
+    static const uint8_t pad[64] = {0x80};
+    const size_t pad_length = (block_length < 56) ? 56 - block_length : 120 - block_length;
+    update(pad, pad_length);
+
+    uint8_t length[8];
+    for (size_t i = 0; i < 8; i++)
+        length[i] = static_cast<uint8_t>( bits >> (56 - 8 * i) );
+    update(length, sizeof (length));
+
+    static const char digits[] = "0123456789abcdef";
+    string result;
+    result.reserve(64);
+    for (auto word : state)
+        for (int shift = 28; shift >= 0; shift -= 4)
+            result.push_back( digits[(word >> shift) & 0xF] );
+    return result;
+}
+
+void Sha256::transform(const uint8_t* data, size_t blocks) noexcept
+{
+#ifdef SHA256_X86
+    if (shani)
+    {
+        transform_shani(state.data(), data, blocks);
+        return;
+    }
+#endif
+    for (; blocks > 0; blocks--, data += block.size())
+        transform_scalar(data);
+}
+
+void Sha256::transform_scalar(const uint8_t* chunk) noexcept
+{
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++)
+        w[i] = (uint32_t{chunk[4 * i]} << 24) | (uint32_t{chunk[4 * i + 1]} << 16) | (uint32_t{chunk[4 * i + 2]} << 8) | uint32_t{chunk[4 * i + 3]};
+    for (size_t i = 16; i < 64; i++)
+    {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+    for (size_t i = 0; i < 64; i++)
+    {
+        const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
@@ -0,0 +1,21 @@
+#include "task_journaled.h"
+
+using ::std::size_t;
+using ::std::unique_ptr;
+
+unique_ptr<Task> TaskListJournaled::get()
+{
+    for (;;)
+    {
+        auto task = source.get();
+        if ( !task || !journal.completed(task->line) )
+            return task;
+        skipped_count++;
+    }
+}
+
+void TaskListJournaled::finish(size_t line, bool success)
+{
+    journal.record(line, success);
+    source.finish(line, success);
+}
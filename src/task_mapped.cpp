@@ -0,0 +1,131 @@
+#include "task_mapped.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::make_unique;
+using ::std::runtime_error;
+
+void TaskListMapped::map(const string& fname)
+{
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error{"TaskListMapped: can`t open <" + fname + ">"};
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw runtime_error{"TaskListMapped: can`t stat <" + fname + ">"};
+    }
+
+    // A pipe or FIFO has no size and can`t be mapped, it is read into memory
+    if ( !S_ISREG(st.st_mode) )
+    {
+        const bool ok = read_all(fd);
+        ::close(fd);
+        if (!ok)
+            throw runtime_error{"TaskListMapped: can`t read <" + fname + ">"};
+        return;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0)
+    {
+        void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            ::close(fd);
+            throw runtime_error{"TaskListMapped: can`t mmap <" + fname + ">"};
+        }
+        ::madvise(ptr, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(ptr);
+    }
+    ::close(fd);
+}
+
+bool TaskListMapped::read_all(int fd)
+{
+    char buf[64 * 1024];
+    for (;;)
+    {
+        const auto n = ::read(fd, buf, sizeof(buf));
+        if (n == 0)
+            break;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        owned.append( buf, static_cast<size_t>(n) );
+    }
+    size = owned.size();
+    if (size > 0)
+        data = owned.data();
+    return true;
+}
+
+TaskListMapped::~TaskListMapped()
+{
+    if ( data && owned.empty() )
+        ::munmap( const_cast<char*>(data), size );
+}
+
+unique_ptr<Task> TaskListMapped::get()
+{
+    unique_ptr<Task> ret;
+
+    while (offset < size)
+    {
+        const size_t begin = offset;
+        const size_t end = next_line(begin);
+        line++;
+        offset = (end < size) ? end + 1 : size;
+
+        ret = parse(begin, end, line);
+        if (ret)
+            break;
+    }
+
+    return ret;
+}
+
+size_t TaskListMapped::next_line(size_t begin) const noexcept
+{
+    const void* pos = std::memchr(data + begin, '\n', size - begin);
+    return (pos) ? static_cast<size_t>( static_cast<const char*>(pos) - data ) : size;
+}
+
+unique_ptr<Task> TaskListMapped::parse(size_t begin, size_t end, size_t l) const
+{
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; };
+    auto skip_space = [&](size_t pos) { while (pos < end && is_space(data[pos])) pos++; return pos; };
+    auto skip_word = [&](size_t pos) { while (pos < end && !is_space(data[pos])) pos++; return pos; };
+
+    const size_t uri_begin = skip_space(begin);
+    const size_t uri_end = skip_word(uri_begin);
+    const size_t fname_begin = skip_space(uri_end);
+    const size_t fname_end = skip_word(fname_begin);
+    if (uri_begin == uri_end || fname_begin == fname_end)
+        return nullptr;
+    // Third word is an expected digest when it names the algorithm, "<algorithm>:<hex>", other words are ignored
+    size_t digest_begin = skip_space(fname_end);
+    size_t digest_end = skip_word(digest_begin);
+    if ( !std::memchr(data + digest_begin, ':', digest_end - digest_begin) )
+        digest_begin = digest_end;
+
+    string fname;
+    fname.reserve( path.size() + (fname_end - fname_begin) );
+    fname.append(path).append(data + fname_begin, fname_end - fname_begin);
+
+    return make_unique<Task>( string{data + uri_begin, uri_end - uri_begin}, std::move(fname), l, string{data + digest_begin, digest_end - digest_begin} );
+}
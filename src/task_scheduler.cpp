@@ -0,0 +1,78 @@
+#include "task_scheduler.h"
+#include "http.h"
+
+using ::std::size_t;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::move;
+using ::std::begin;
+using ::std::end;
+
+unique_ptr<Task> TaskListScheduler::get()
+{
+    read_ahead();
+
+    for (auto it = begin(rotation); it != end(rotation); ++it)
+    {
+        Host& host = hosts[*it];
+        if (per_host != 0 && host.running >= per_host)
+            continue;
+
+        auto task = move( host.pending.front() );
+        host.pending.pop_front();
+        host.running++;
+        buffered--;
+        running[task->line] = *it;
+
+        // Host goes to the end of the queue, next call starts from the other one
+        if ( host.pending.empty() )
+            rotation.erase(it);
+        else
+            rotation.splice( end(rotation), rotation, it );
+
+        return task;
+    }
+
+    return nullptr;
+}
+
+void TaskListScheduler::finish(size_t line, bool success)
+{
+    auto it = running.find(line);
+    if ( it != end(running) )
+    {
+        auto host_it = hosts.find(it->second);
+        if ( --(host_it->second.running) == 0 && host_it->second.pending.empty() )
+            hosts.erase(host_it);
+        running.erase(it);
+    }
+
+    source.finish(line, success);
+}
+
+void TaskListScheduler::read_ahead()
+{
+    while (!eof && buffered < window)
+    {
+        auto task = source.get();
+        if (!task)
+        {
+            eof = true;
+            break;
+        }
+
+        string name = host_of(task->uri);
+        Host& host = hosts[name];
+        if ( host.pending.empty() )
+            rotation.push_back( move(name) );
+        host.pending.push_back( move(task) );
+        buffered++;
+    }
+}
+
+// Of the first mirror for "uri|uri|..."
+string TaskListScheduler::host_of(const string& uri)
+{
+    auto parsed = HttpParser::uri_parse( uri.substr( 0, uri.find('|') ) );
+    return (parsed) ? parsed->host : string{};
+}
@@ -10,17 +10,22 @@ std::unique_ptr<Task> TaskListSimple::get()
     {
         string buf;
         getline(stream, buf);
+        line++;
         if ( buf.empty() )
             continue;
 
         istringstream sbuf{ move(buf) };
-        string uri, fname;
+        string uri, fname, digest;
         sbuf >> uri;
         sbuf >> fname;
+        sbuf >> digest;
         if ( uri.empty() || fname.empty() )
             continue;
+        // Third word is an expected digest when it names the algorithm, "<algorithm>:<hex>"
+        if ( digest.find(':') == string::npos )
+            digest.clear();
 
-        ret = make_unique<Task>( move(uri), path + fname );
+        ret = make_unique<Task>( move(uri), path + fname, line, move(digest) );
         break;
     }
 
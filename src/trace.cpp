@@ -0,0 +1,193 @@
+#include "trace.h"
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+
+using ::std::size_t;
+using ::std::uint64_t;
+using ::std::int64_t;
+using ::std::string;
+using ::std::vector;
+using ::std::list;
+using ::std::shared_ptr;
+using ::std::make_shared;
+using ::std::mutex;
+using ::std::lock_guard;
+using ::std::ofstream;
+using ::std::ostream;
+using ::std::move;
+using ::std::chrono::duration_cast;
+using ::std::chrono::microseconds;
+using ::trace::Clock;
+
+namespace {
+
+struct Event
+{
+    char phase;           // 'X' span, 'i' instant, 'C' counter, 'M' track name
+    const char* name;
+    uint64_t track;
+    Clock::time_point ts;
+    Clock::time_point end;
+    int64_t value;
+    string detail;
+};
+
+using Buffer = vector<Event>;
+
+struct Registry
+{
+    mutex guard;
+    list< shared_ptr<Buffer> > buffers;
+    Clock::time_point origin = Clock::now();
+    std::atomic<uint64_t> next_track{1};
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+Buffer& local_buffer()
+{
+    thread_local shared_ptr<Buffer> buffer;
+    if (!buffer)
+    {
+        buffer = make_shared<Buffer>();
+        auto& r = registry();
+        lock_guard<mutex> lock{r.guard};
+        r.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void json_string(ostream& out, const string& s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out << '"';
+    for (const unsigned char c : s)
+    {
+        switch (c)
+        {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20)
+                out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+            else
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void trace::start()
+{
+    auto& r = registry();
+    {
+        lock_guard<mutex> lock{r.guard};
+        for (auto& buffer : r.buffers)
+            buffer->clear();
+    }
+    r.origin = Clock::now();
+    detail::enabled_flag().store(true, std::memory_order_relaxed);
+}
+
+uint64_t trace::new_track(const string& name)
+{
+    const auto track = registry().next_track.fetch_add(1, std::memory_order_relaxed);
+    if ( enabled() )
+        local_buffer().push_back( Event{'M', "thread_name", track, Clock::time_point{}, Clock::time_point{}, 0, name} );
+    return track;
+}
+
+void trace::span(const char* name, uint64_t track, Clock::time_point begin, Clock::time_point end)
+{
+    if ( !enabled() || begin == Clock::time_point{} )
+        return;
+    local_buffer().push_back( Event{'X', name, track, begin, end, 0, string{}} );
+}
+
+void trace::instant(const char* name, uint64_t track, string detail)
+{
+    if ( !enabled() )
+        return;
+    const auto now = Clock::now();
+    local_buffer().push_back( Event{'i', name, track, now, now, 0, move(detail)} );
+}
+
+void trace::counter(const char* name, int64_t value)
+{
+    if ( !enabled() )
+        return;
+    const auto now = Clock::now();
+    local_buffer().push_back( Event{'C', name, 0, now, now, value, string{}} );
+}
+
+bool trace::write(const string& fname)
+{
+    detail::enabled_flag().store(false, std::memory_order_relaxed);
+
+    auto& r = registry();
+    vector<const Event*> events;
+    {
+        lock_guard<mutex> lock{r.guard};
+        for (const auto& buffer : r.buffers)
+            for (const auto& event : *buffer)
+                events.push_back(&event);
+    }
+    std::stable_sort( events.begin(), events.end(), [](const Event* a, const Event* b) { return a->ts < b->ts; } );
+
+    ofstream out{fname, std::ios::trunc};
+    if (!out)
+        return false;
+
+    const auto us = [&r](Clock::time_point t) { return duration_cast<microseconds>(t - r.origin).count(); };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const Event* e : events)
+    {
+        if (!first)
+            out << ",\n";
+        first = false;
+
+        out << "{\"ph\":\"" << e->phase << "\",\"pid\":1,\"tid\":" << e->track << ",\"name\":";
+        json_string(out, e->name);
+        switch (e->phase)
+        {
+        case 'M':
+            out << ",\"args\":{\"name\":";
+            json_string(out, e->detail);
+            out << "}";
+            break;
+        case 'X':
+            out << ",\"ts\":" << us(e->ts) << ",\"dur\":" << duration_cast<microseconds>(e->end - e->ts).count();
+            break;
+        case 'i':
+            out << ",\"ts\":" << us(e->ts) << ",\"s\":\"t\",\"args\":{\"detail\":";
+            json_string(out, e->detail);
+            out << "}";
+            break;
+        case 'C':
+            out << ",\"ts\":" << us(e->ts) << ",\"args\":{\"value\":" << e->value << "}";
+            break;
+        default:
+            break;
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    out.flush();
+    return static_cast<bool>(out);
+}
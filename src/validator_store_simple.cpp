@@ -0,0 +1,152 @@
+#include "validator_store_simple.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <sys/stat.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::runtime_error;
+using ::std::chrono::milliseconds;
+
+namespace {
+
+// Header values can`t hold line breaks, a tab would break the record
+bool storable(const string& s)
+{
+    return s.find_first_of("\t\r\n") == string::npos;
+}
+
+} // namespace
+
+ValidatorStoreSimple::ValidatorStoreSimple(const string& fname, size_t batch_, milliseconds interval_)
+    : batch{batch_},
+      interval{interval_}
+{
+    const auto records = load(fname);
+    if ( records > 2 * validators.size() + 64 )
+        compact(fname);
+
+    if ( !log.open(fname) )
+        throw runtime_error{"ValidatorStoreSimple: can`t open <" + fname + ">"};
+}
+
+ValidatorStoreSimple::~ValidatorStoreSimple()
+{
+    try {
+        flush();
+    } catch (...) {}
+}
+
+bool ValidatorStoreSimple::lookup(const string& uri, const string& fname, Validator& validator) const
+{
+    auto it = validators.find(uri);
+    if ( it == validators.end() )
+        return false;
+
+    struct stat st;
+    if ( ::stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) != it->second.size )
+        return false;
+
+    validator = it->second;
+    return true;
+}
+
+bool ValidatorStoreSimple::find(const string& uri, Validator& validator) const
+{
+    auto it = validators.find(uri);
+    if ( it == validators.end() )
+        return false;
+
+    validator = it->second;
+    return true;
+}
+
+void ValidatorStoreSimple::record(const string& uri, const Validator& validator)
+{
+    if ( !storable(uri) || !storable(validator.etag) || !storable(validator.last_modified) )
+        return;
+
+    if ( validator.empty() )
+    {
+        if ( validators.erase(uri) == 0 )
+            return;
+    } else
+    {
+        validators[uri] = validator;
+    }
+
+    pending += format(uri, validator);
+    pending_count++;
+    if (on_due && pending_count >= batch)
+        on_due();
+}
+
+void ValidatorStoreSimple::flush()
+{
+    if ( !write( take() ) )
+        throw runtime_error{"ValidatorStoreSimple: write failed"};
+}
+
+string ValidatorStoreSimple::take()
+{
+    pending_count = 0;
+    string data;
+    data.swap(pending);
+    return data;
+}
+
+void ValidatorStoreSimple::put_back(string data)
+{
+    pending_count += static_cast<size_t>( std::count( data.begin(), data.end(), '\n' ) );
+    data += pending;
+    pending.swap(data);
+}
+
+bool ValidatorStoreSimple::write(const string& data) const noexcept
+{
+    return log.append(data);
+}
+
+string ValidatorStoreSimple::format(const string& uri, const Validator& validator)
+{
+    return to_string(validator.size) + "\t" + validator.etag + "\t" + validator.last_modified + "\t" + uri + "\n";
+}
+
+// Returns count of records
+size_t ValidatorStoreSimple::load(const string& fname)
+{
+    return AppendLog::load( fname, [this](const string& buf)
+    {
+        const auto tab_1 = buf.find('\t');
+        const auto tab_2 = (tab_1 != string::npos) ? buf.find('\t', tab_1 + 1) : string::npos;
+        const auto tab_3 = (tab_2 != string::npos) ? buf.find('\t', tab_2 + 1) : string::npos;
+        if (tab_3 == string::npos || tab_1 == 0 || tab_3 + 1 == buf.size())
+            return;
+
+        Validator validator;
+        try {
+            validator.size = std::stoul( buf.substr(0, tab_1) );
+        } catch (const std::exception&) {
+            return;
+        }
+        validator.etag = buf.substr(tab_1 + 1, tab_2 - tab_1 - 1);
+        validator.last_modified = buf.substr(tab_2 + 1, tab_3 - tab_2 - 1);
+        auto uri = buf.substr(tab_3 + 1);
+
+        if ( validator.empty() )
+            validators.erase(uri);
+        else
+            validators[ std::move(uri) ] = std::move(validator);
+    } );
+}
+
+// One record per URI, a record that forgets one is not needed any more
+void ValidatorStoreSimple::compact(const string& fname)
+{
+    string data;
+    for (const auto& validator : validators)
+        data += format(validator.first, validator.second);
+    AppendLog::rewrite(fname, data);
+}
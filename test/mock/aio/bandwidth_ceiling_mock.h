@@ -0,0 +1,16 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include "aio/bandwidth.h"
+
+namespace aio {
+namespace bandwidth {
+
+struct CeilingMock : public Ceiling
+{
+    virtual std::size_t ceiling() const noexcept { return ceiling_(); }
+    MOCK_CONST_METHOD0( ceiling_, std::size_t() );
+};
+
+} // namespace bandwidth
+} // namespace aio
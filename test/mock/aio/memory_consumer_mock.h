@@ -0,0 +1,18 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include "aio/memory.h"
+
+namespace aio {
+namespace memory {
+
+struct ConsumerMock : public Consumer
+{
+    virtual std::size_t buffered() const noexcept { return buffered_(); }
+    MOCK_CONST_METHOD0( buffered_, std::size_t() );
+    MOCK_METHOD0( throttle, void() );
+    MOCK_METHOD0( unthrottle, void() );
+};
+
+} // namespace memory
+} // namespace aio
@@ -6,4 +6,6 @@
 struct DashboardMock : public Dashboard
 {
     MOCK_METHOD2( update, void(std::size_t, const StatusDownloader&) );
+    MOCK_METHOD2( progress, void(std::size_t, const StatusDownloader&) );
+    MOCK_METHOD0( sweep_done, void() );
 };
@@ -10,3 +10,15 @@ public:
     MOCK_METHOD0( stop, void() );
     MOCK_CONST_METHOD0( status, const StatusDownloader&() );
 };
+
+class DownloaderResumableMock : public DownloaderResumable
+{
+public:
+    MOCK_METHOD2( run, bool(const std::string&, const std::string&) );
+    MOCK_METHOD0( stop, void() );
+    MOCK_CONST_METHOD0( status, const StatusDownloader&() );
+    MOCK_METHOD4( resume, bool(const std::string&, const std::string&, std::size_t, const Entity&) );
+    MOCK_CONST_METHOD0( entity, const Entity&() );
+    MOCK_METHOD0( suspend, bool() );
+    MOCK_CONST_METHOD0( offset, std::size_t() );
+};
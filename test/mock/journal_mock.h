@@ -0,0 +1,12 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include "journal.h"
+
+class JournalMock : public Journal
+{
+public:
+    virtual bool completed(std::size_t line) const noexcept { return completed_(line); }
+    MOCK_CONST_METHOD1( completed_, bool(std::size_t) );
+    MOCK_METHOD2( record, void(std::size_t, bool) );
+};
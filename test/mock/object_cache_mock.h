@@ -0,0 +1,14 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include "object_cache.h"
+
+class ObjectCacheMock : public ObjectCache
+{
+public:
+    MOCK_METHOD2( find, bool(const std::string&, Entry&) );
+    MOCK_METHOD2( insert, void(const std::string&, const Entry&) );
+    MOCK_METHOD1( forget, void(const std::string&) );
+    MOCK_CONST_METHOD2( store, bool(const std::string&, Entry&) );
+    MOCK_CONST_METHOD2( restore, bool(const Entry&, const std::string&) );
+};
@@ -7,4 +7,5 @@ class TaskListMock : public TaskList
 {
 public:
     MOCK_METHOD0( get, std::unique_ptr<Task>() );
+    MOCK_METHOD2( finish, void(std::size_t, bool) );
 };
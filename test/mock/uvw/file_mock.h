@@ -17,6 +17,7 @@ struct FileReqMock : public uvw::Emitter<FileReqMock>
 struct FsReqMock : public uvw::Emitter<FsReqMock>
 {
     MOCK_METHOD1( unlink, void(std::string) );
+    MOCK_METHOD2( rename, void(std::string, std::string) );
 
     template< typename Event >
     void publish(Event&& event) { uvw::Emitter<FsReqMock>::publish( std::forward<Event>(event) ); }
@@ -2,6 +2,7 @@
 
 #include <gmock/gmock.h>
 #include <memory>
+#include <functional>
 
 struct LoopMock;
 struct GetAddrInfoReqMock;
@@ -9,6 +10,7 @@ struct TcpHandleMock;
 struct TimerHandleMock;
 struct FileReqMock;
 struct FsReqMock;
+struct WorkReqMock;
 namespace aio { struct TCPSocketMock; }
 
 namespace LoopMock_internal {
@@ -34,6 +36,12 @@ std::shared_ptr<FsReqMock> resource<FsReqMock>(LoopMock&);
 template<>
 std::shared_ptr<::aio::TCPSocketMock> resource<::aio::TCPSocketMock>(LoopMock&);
 
+template< typename T >
+std::shared_ptr<T> resource(LoopMock&, std::function<void()>) { return nullptr; }
+
+template<>
+std::shared_ptr<WorkReqMock> resource<WorkReqMock>(LoopMock&, std::function<void()>);
+
 }
 
 struct LoopMock
@@ -41,12 +49,16 @@ struct LoopMock
     template< typename T >
     std::shared_ptr<T> resource() { return LoopMock_internal::resource<T>(*this); }
 
+    template< typename T >
+    std::shared_ptr<T> resource(std::function<void()> task) { return LoopMock_internal::resource<T>( *this, std::move(task) ); }
+
     MOCK_METHOD0( resource_GetAddrInfoReqMock, std::shared_ptr<GetAddrInfoReqMock>() );
     MOCK_METHOD0( resource_TcpHandleMock, std::shared_ptr<TcpHandleMock>() );
     MOCK_METHOD0( resource_TimerHandleMock, std::shared_ptr<TimerHandleMock>() );
     MOCK_METHOD0( resource_FileReqMock, std::shared_ptr<FileReqMock>() );
     MOCK_METHOD0( resource_FsReqMock, std::shared_ptr<FsReqMock>() );
     MOCK_METHOD0( resource_TCPSocketMock, std::shared_ptr<::aio::TCPSocketMock>() );
+    MOCK_METHOD1( resource_WorkReqMock, std::shared_ptr<WorkReqMock>(std::function<void()>) );
 };
 
 namespace LoopMock_internal {
@@ -68,4 +80,7 @@ std::shared_ptr<FsReqMock> resource<FsReqMock>(LoopMock& self) { return self.res
 
 template<>
 std::shared_ptr<::aio::TCPSocketMock> resource<::aio::TCPSocketMock>(LoopMock& self) { return self.resource_TCPSocketMock(); }
+
+template<>
+std::shared_ptr<WorkReqMock> resource<WorkReqMock>(LoopMock& self, std::function<void()> task) { return self.resource_WorkReqMock( std::move(task) ); }
 }
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include <uvw/emitter.hpp>
+
+#include <functional>
+
+struct WorkReqMock : public uvw::Emitter<WorkReqMock>
+{
+    MOCK_METHOD0( queue, void() );
+    MOCK_METHOD0( cancel, bool() );
+
+    template< typename Event >
+    void publish(Event&& event) { uvw::Emitter<WorkReqMock>::publish( std::forward<Event>(event) ); }
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include "validator_store.h"
+
+class ValidatorStoreMock : public ValidatorStore
+{
+public:
+    MOCK_CONST_METHOD3( lookup, bool(const std::string&, const std::string&, Validator&) );
+    MOCK_CONST_METHOD2( find, bool(const std::string&, Validator&) );
+    MOCK_METHOD2( record, void(const std::string&, const Validator&) );
+};
@@ -7,6 +7,7 @@
 #include <random>
 
 #include "aio/tcp_bandwidth.h"
+#include "aio/memory_budget.h"
 
 
 using namespace std;
@@ -593,3 +594,100 @@ TEST_F(TCPSocketBandwidth_read, transfer_zero)
 
     resource_close();
 }
+
+TEST_F(TCPSocketBandwidth_read, throttle)
+{
+    EXPECT_CALL( *controller, shedule_transfer() )
+            .Times(1);
+    socket->publish( uvw::DataEvent{move(segments[0].first), segments[0].second} );
+    EXPECT_EQ( resource->buffered(), segment_length );
+    Mock::VerifyAndClearExpectations(controller.get());
+
+    EXPECT_CALL( *socket, stop() )
+            .Times(1);
+    resource->throttle();
+    resource->throttle();
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    EXPECT_CALL( *socket, read() )
+            .Times(0);
+    resource->clear<uvw::DataEvent>();
+    resource->once<uvw::DataEvent>( [](const auto&, const auto&) {} );
+    resource->transfer(segment_length);
+    EXPECT_EQ( resource->buffered(), 0 );
+    resource->read();
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    EXPECT_CALL( *socket, read() )
+            .Times(1);
+    resource->unthrottle();
+    resource->unthrottle();
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    resource_close();
+}
+
+TEST(TCPSocketBandwidth, budget_recovers_from_socket_buffers)
+{
+    auto loop = ::uvw::Loop::getDefault();
+    auto controller = make_shared<ControllerMock>();
+    auto socket = make_shared<::aio::TCPSocketMock>();
+    auto budget = make_shared<::aio::memory::BudgetSimple>(1500);
+
+    Controller::StreamsList streams;
+    Controller::StreamConnection stream_conn;
+    EXPECT_CALL( *controller, add_stream(_) )
+            .WillOnce( Invoke( [&](weak_ptr<Stream> w) -> Controller::StreamConnection
+    {
+        w.lock()->set_buffer(4 * 1024);
+        stream_conn = streams.insert(end(streams), w);
+        return stream_conn;
+    } ) );
+    auto resource = loop->resource<::aio::TCPSocketBandwidth>(controller, socket, budget);
+    ASSERT_TRUE(resource);
+
+    EXPECT_CALL( *socket, read() )
+            .Times(1);
+    resource->read();
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    // All usage sits in the socket buffer, the budget stops the network read only
+    EXPECT_CALL( *controller, shedule_transfer() )
+            .Times(2);
+    EXPECT_CALL( *socket, stop() )
+            .Times(1);
+    socket->publish( uvw::DataEvent{make_unique<char[]>(1000), 1000} );
+    socket->publish( uvw::DataEvent{make_unique<char[]>(1000), 1000} );
+    EXPECT_EQ( budget->used(), 2000 );
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    size_t received = 0;
+    std::function< void(uvw::DataEvent&, const ::aio::TCPSocket&) > handler;
+    handler = [&](uvw::DataEvent& event, const ::aio::TCPSocket&)
+    {
+        received += event.length;
+        EXPECT_EQ( budget->used(), 2000 - received );
+        resource->once<uvw::DataEvent>(handler);
+    };
+    resource->once<uvw::DataEvent>(handler);
+
+    // Draining below the low watermark lifts the throttle
+    EXPECT_CALL( *socket, read() )
+            .Times(1);
+    resource->transfer(1000);
+    EXPECT_EQ( received, 1000 );
+    Mock::VerifyAndClearExpectations(socket.get());
+
+    resource->transfer(1000);
+    EXPECT_EQ( received, 2000 );
+    EXPECT_EQ( budget->used(), 0 );
+    EXPECT_EQ( budget->peak(), 2000 );
+
+    EXPECT_CALL( *controller, remove_stream(stream_conn) )
+            .Times(1);
+    EXPECT_CALL( *socket, close_() )
+            .Times(1);
+    resource->clear();
+    resource->close();
+    socket->publish( uvw::CloseEvent{} );
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "append_log.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+
+using ::std::string;
+using ::std::vector;
+using ::std::ifstream;
+using ::std::ofstream;
+using ::std::stringstream;
+
+struct AppendLogF : public ::testing::Test
+{
+    AppendLogF()
+        : fname{"test_append_log.log"}
+    {
+        std::remove( fname.c_str() );
+    }
+
+    virtual ~AppendLogF()
+    {
+        std::remove( fname.c_str() );
+        std::remove( (fname + ".tmp").c_str() );
+    }
+
+    string content() const
+    {
+        ifstream stream{fname};
+        stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+
+    vector<string> load() const
+    {
+        vector<string> records;
+        AppendLog::load( fname, [&records](const string& record) { records.push_back(record); } );
+        return records;
+    }
+
+    const string fname;
+};
+
+TEST_F(AppendLogF, missing_file)
+{
+    EXPECT_TRUE( load().empty() );
+
+    AppendLog log;
+    EXPECT_FALSE( log.is_open() );
+    ASSERT_TRUE( log.open(fname) );
+    EXPECT_TRUE( log.is_open() );
+    EXPECT_EQ( content(), "" );
+}
+
+TEST_F(AppendLogF, append_and_load)
+{
+    {
+        AppendLog log;
+        ASSERT_TRUE( log.open(fname) );
+        EXPECT_TRUE( log.append("a\n") );
+        EXPECT_TRUE( log.append("") );
+        EXPECT_TRUE( log.append("b\nc\n", false) );
+    }
+    EXPECT_EQ( load(), (vector<string>{"a", "b", "c"}) );
+
+    AppendLog log;
+    ASSERT_TRUE( log.open(fname) );
+    EXPECT_TRUE( log.append("d\n") );
+    EXPECT_EQ( content(), "a\nb\nc\nd\n" );
+}
+
+TEST_F(AppendLogF, cut_torn_record)
+{
+    {
+        ofstream stream{fname};
+        stream << "a\n" << "\n" << "b\n" << "tor";
+    }
+    EXPECT_EQ( AppendLog::load( fname, [](const string&) {} ), 3u );
+    EXPECT_EQ( content(), "a\n\nb\n" );
+
+    AppendLog log;
+    ASSERT_TRUE( log.open(fname) );
+    EXPECT_TRUE( log.append("c\n") );
+    EXPECT_EQ( load(), (vector<string>{"a", "", "b", "c"}) );
+}
+
+TEST_F(AppendLogF, rewrite)
+{
+    {
+        ofstream stream{fname};
+        stream << "a\n" << "a\n" << "b\n";
+    }
+    EXPECT_TRUE( AppendLog::rewrite(fname, "b\n") );
+    EXPECT_EQ( content(), "b\n" );
+    EXPECT_FALSE( ifstream{fname + ".tmp"}.is_open() );
+}
@@ -5,12 +5,14 @@
 #include "mock/uvw/timer_mock.h"
 #include "mock/aio/bandwidth_stream_mock.h"
 #include "mock/aio/bandwidth_time_mock.h"
+#include "mock/aio/bandwidth_ceiling_mock.h"
 
 #include "aio/bandwidth_controller.h"
 
 using ::aio::bandwidth::Stream;
 using ::aio::bandwidth::StreamMock;
 using ::aio::bandwidth::TimeMock;
+using ::aio::bandwidth::CeilingMock;
 using ::aio::bandwidth::Controller;
 using ::aio::bandwidth::ControllerSimple;
 
@@ -247,6 +249,46 @@ TEST_F(bandwidth_ControllerSimpleStreams, redistribution_unused_bandwidth)
     std::cout << "Count invoke transfer: stream_1 = " << count_1 << ", stream_2 = " << count_2 << ", stream_3 = " << count_3 << std::endl;
 }
 
+TEST_F(bandwidth_ControllerSimpleStreams, budget_not_exceeded)
+{
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{1000} ) );
+    EXPECT_CALL( *timer, start(_,_) )
+            .Times( ::testing::AnyNumber() );
+
+    // Stopped, data stays in the buffer
+    EXPECT_CALL( *stream_1, available_() )
+            .WillRepeatedly( Return(2000) );
+    EXPECT_CALL( *stream_1, transfer(_) )
+            .Times( AtLeast(1) );
+
+    size_t transferred = 0;
+    size_t available_2 = 10000, available_3 = 10000;
+    EXPECT_CALL( *stream_2, available_() )
+            .WillRepeatedly( ReturnPointee(&available_2) );
+    EXPECT_CALL( *stream_2, transfer(_) )
+            .WillRepeatedly( Invoke( [&available_2, &transferred](size_t size)
+    {
+        available_2 -= size;
+        transferred += size;
+    } ) );
+    EXPECT_CALL( *stream_3, available_() )
+            .WillRepeatedly( ReturnPointee(&available_3) );
+    EXPECT_CALL( *stream_3, transfer(_) )
+            .WillRepeatedly( Invoke( [&available_3, &transferred](size_t size)
+    {
+        available_3 -= size;
+        transferred += size;
+    } ) );
+
+    controller->shedule_transfer();
+
+    EXPECT_LE(transferred, limit);
+    check_streams();
+    Mock::VerifyAndClearExpectations( timer.get() );
+    timer->clear();
+}
+
 TEST_F(bandwidth_ControllerSimpleStreams, planing_on_zero_to_transfer)
 {
     size_t available_1, available_2, available_3;
@@ -466,3 +508,56 @@ TEST_F(bandwidth_ControllerSimple_planing, remove_other_stream)
     EXPECT_EQ(available_1, 0u);
     EXPECT_EQ(available_2, 0u);
 }
+
+TEST(bandwidth_ControllerSimple, ceiling)
+{
+    const size_t limit = 9000;
+    auto loop = make_shared<LoopMock>();
+    auto timer = make_shared<TimerHandleMock>();
+    EXPECT_CALL( *loop, resource_TimerHandleMock() )
+            .WillOnce( Return(timer) );
+    auto t = make_unique<TimeMock>();
+    auto time = t.get();
+    auto ceiling = make_shared<CeilingMock>();
+    auto controller = make_shared< ControllerSimple<AIO_Mock> >( loop, limit, move(t), ceiling );
+
+    auto stream = make_shared<StreamMock>();
+    EXPECT_CALL( *stream, set_buffer_(limit * 4) )
+            .Times(1);
+    auto conn = controller->add_stream(stream);
+
+    EXPECT_CALL( *time, elapsed_() )
+            .WillRepeatedly( Return( milliseconds{1000} ) );
+    // Unknown storage speed, transfer with configured limit
+    EXPECT_CALL( *ceiling, ceiling_() )
+            .WillOnce( Return(0) );
+    EXPECT_CALL( *stream, available_() )
+            .WillOnce( Return(limit) );
+    EXPECT_CALL( *stream, transfer(limit) )
+            .Times(1);
+    controller->shedule_transfer();
+    Mock::VerifyAndClearExpectations( stream.get() );
+
+    EXPECT_CALL( *ceiling, ceiling_() )
+            .WillOnce( Return(limit / 3) );
+    EXPECT_CALL( *stream, available_() )
+            .WillOnce( Return(limit) );
+    EXPECT_CALL( *stream, transfer(limit / 3) )
+            .Times(1);
+    EXPECT_CALL( *timer, start(_,_) )
+            .Times(1);
+    controller->shedule_transfer();
+    Mock::VerifyAndClearExpectations( stream.get() );
+    Mock::VerifyAndClearExpectations( timer.get() );
+
+    EXPECT_CALL( *ceiling, ceiling_() )
+            .WillOnce( Return(limit * 2) );
+    EXPECT_CALL( *stream, available_() )
+            .WillOnce( Return(limit) );
+    EXPECT_CALL( *stream, transfer(limit) )
+            .Times(1);
+    timer->publish( ::uvw::TimerEvent{} );
+    Mock::VerifyAndClearExpectations( stream.get() );
+
+    controller->remove_stream(conn);
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "checksum.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::stringstream;
+
+TEST(Crc32c, known_vectors)
+{
+    Crc32c crc;
+    crc.update("123456789", 9);
+    EXPECT_EQ( crc.value(), 0xE3069283u );
+    EXPECT_EQ( crc.hex(), "e3069283" );
+
+    EXPECT_EQ( Crc32c{}.hex(), "00000000" );
+}
+
+TEST(Crc32c, split_updates)
+{
+    string data(1000, '\0');
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<char>(i * 31);
+    Crc32c whole;
+    whole.update( data.data(), data.size() );
+
+    // Unaligned heads and tails of the 8 byte words
+    for (std::size_t step = 1; step < 40; step += 3)
+    {
+        Crc32c crc;
+        for (std::size_t pos = 0; pos < data.size(); pos += step)
+            crc.update( data.data() + pos, std::min(step, data.size() - pos) );
+        EXPECT_EQ( crc.value(), whole.value() ) << "step " << step;
+    }
+}
+
+TEST(Checksum, parse)
+{
+    auto sha256 = Checksum::parse("sha256:E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855");
+    ASSERT_TRUE(sha256);
+    EXPECT_STREQ( sha256->name(), "sha256" );
+    EXPECT_EQ( sha256->expected_hex(), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" );
+    EXPECT_TRUE( sha256->verify() );
+
+    auto crc32c = Checksum::parse("crc32c:");
+    ASSERT_TRUE(crc32c);
+    EXPECT_STREQ( crc32c->name(), "crc32c" );
+    EXPECT_TRUE( crc32c->expected_hex().empty() );
+
+    EXPECT_FALSE( Checksum::parse("md5:d41d8cd98f00b204e9800998ecf8427e") );
+    EXPECT_FALSE( Checksum::parse("crc32c:e306928") );
+    EXPECT_FALSE( Checksum::parse("crc32c:e306928x") );
+}
+
+TEST(Checksum, verify_mismatch)
+{
+    auto checksum = Checksum::parse("crc32c:e3069283");
+    ASSERT_TRUE(checksum);
+    checksum->update("123456788", 9);
+    EXPECT_FALSE( checksum->verify() );
+    EXPECT_NE( checksum->hex(), "e3069283" );
+}
+
+TEST(Checksum, sidecar)
+{
+    const string fname = "test_checksum_file.bin";
+    const string sidecar = fname + ".crc32c";
+    std::remove( sidecar.c_str() );
+
+    Checksum checksum{Checksum::Algorithm::Crc32c, string{}, true};
+    checksum.update("123456789", 9);
+    ASSERT_TRUE( checksum.write("./" + fname) );
+
+    ifstream stream{sidecar};
+    stringstream ss;
+    ss << stream.rdbuf();
+    EXPECT_EQ( ss.str(), "e3069283  " + fname + "\n" );
+    std::remove( sidecar.c_str() );
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include "dashboard_buffered.h"
+
+#include <sstream>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::ostringstream;
+using ::std::chrono::milliseconds;
+
+using State = StatusDownloader::State;
+
+static size_t count_lines(const string& s)
+{
+    size_t n = 0;
+    for (char c : s)
+        if (c == '\n')
+            n++;
+    return n;
+}
+
+TEST(DashboardBuffered, text)
+{
+    ostringstream out;
+    {
+        DashboardBuffered dashboard{out};
+
+        StatusDownloader status;
+        status.state = State::OnTheGo;
+        dashboard.update(1, status);
+
+        status.state = State::Done;
+        status.downloaded = 100;
+        dashboard.update(2, status);
+
+        status.state = State::Failed;
+        status.error = StatusDownloader::Error::MaxRedirect;
+        dashboard.update(3, status);
+
+        EXPECT_EQ( dashboard.status().first, 1u );
+        EXPECT_EQ( dashboard.status().second, 100u );
+
+        dashboard.flush();
+        const auto text = out.str();
+        EXPECT_EQ( count_lines(text), 2u );
+        EXPECT_NE( text.find("#2 State: Done"), string::npos );
+        EXPECT_NE( text.find("#3 State: Failed, error: "), string::npos );
+        EXPECT_EQ( text.find("#1 "), string::npos );
+    }
+}
+
+TEST(DashboardBuffered, json)
+{
+    ostringstream out;
+    {
+        DashboardBuffered dashboard{out, DashboardBuffered::Format::Json};
+        dashboard.started(7, "/home/7.zip");
+        dashboard.started(8, "/home/8.zip");
+        dashboard.started(9, "/home/9.zip");
+
+        StatusDownloader status;
+        status.state = State::Done;
+        status.downloaded = 42;
+        status.http_status = 200;
+        dashboard.update(7, status);
+
+        status.state = State::Failed;
+        status.error = StatusDownloader::Error::ResponseParse;
+        status.http_status = 0;
+        status.detail = "bad \"header\"\n";
+        dashboard.update(8, status);
+
+        status.state = State::Redirect;
+        status.http_status = 302;
+        status.redirect_uri = "http://internet.org/9";
+        dashboard.update(9, status);
+
+        status.state = State::Failed;
+        status.error = StatusDownloader::Error::Connect;
+        status.error_code = -111;
+        status.http_status = 0;
+        dashboard.update(9, status);
+    }
+    const auto text = out.str();
+    EXPECT_EQ( count_lines(text), 4u );
+    EXPECT_NE( text.find("\"job\":7,\"file\":\"/home/7.zip\",\"state\":\"done\",\"downloaded\":42,\"http_status\":200}"), string::npos );
+    EXPECT_NE( text.find("\"job\":8,\"file\":\"/home/8.zip\",\"state\":\"failed\",\"error\":\"response_parse\",\"error_code\":0,\"message\":\""), string::npos );
+    EXPECT_NE( text.find("bad \\\"header\\\"\\n"), string::npos );
+    EXPECT_NE( text.find("\"job\":9,\"file\":\"/home/9.zip\",\"state\":\"redirect\",\"redirect_uri\":\"http://internet.org/9\",\"http_status\":302}"), string::npos );
+    EXPECT_NE( text.find("\"job\":9,\"file\":\"/home/9.zip\",\"state\":\"failed\",\"error\":\"connect\",\"error_code\":-111,"), string::npos );
+}
+
+TEST(DashboardBuffered, overflow_dropped)
+{
+    ostringstream out;
+    {
+        DashboardBuffered dashboard{out, DashboardBuffered::Format::Text, 4, milliseconds{10000}};
+
+        StatusDownloader status;
+        status.state = State::Done;
+        size_t i = 0;
+        // Writer may drain the ring concurrently, keep going until something is dropped
+        while (dashboard.dropped() == 0 && i < 1000000)
+            dashboard.update(i++, status);
+
+        EXPECT_GT( dashboard.dropped(), 0u );
+        EXPECT_EQ( dashboard.status().first, i );
+    }
+    EXPECT_NE( out.str().find("records dropped"), string::npos );
+}
+
+TEST(DashboardBuffered, overflow_dropped_json)
+{
+    ostringstream out;
+    {
+        DashboardBuffered dashboard{out, DashboardBuffered::Format::Json, 4, milliseconds{10000}};
+
+        StatusDownloader status;
+        status.state = State::Done;
+        size_t i = 0;
+        while (dashboard.dropped() == 0 && i < 1000000)
+            dashboard.update(i++, status);
+    }
+    // Every line is an object
+    std::istringstream lines{ out.str() };
+    string line;
+    bool notice = false;
+    while ( std::getline(lines, line) )
+    {
+        ASSERT_FALSE( line.empty() );
+        EXPECT_EQ( line.front(), '{' );
+        EXPECT_EQ( line.back(), '}' );
+        notice = notice || line.find("\"dropped\":") != string::npos;
+    }
+    EXPECT_TRUE(notice);
+}
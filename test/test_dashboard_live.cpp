@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/dashboard_mock.h"
+#include "mock/aio/bandwidth_time_mock.h"
+
+#include "dashboard_live.h"
+
+#include <sstream>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::ostringstream;
+using ::std::make_unique;
+using ::std::move;
+using ::std::chrono::milliseconds;
+
+using ::testing::Return;
+using ::testing::_;
+
+using State = StatusDownloader::State;
+using TimeMock = aio::bandwidth::TimeMock;
+
+static StatusDownloader make_status(State state, size_t downloaded, size_t size = 0)
+{
+    StatusDownloader status;
+    status.state = state;
+    status.downloaded = downloaded;
+    status.size = size;
+    return status;
+}
+
+TEST(DashboardLive, forward_update)
+{
+    DashboardMock inner;
+    ostringstream out;
+    auto time = make_unique<TimeMock>();
+    DashboardLive dashboard{inner, out, move(time)};
+
+    EXPECT_CALL( inner, update(5, _) )
+            .Times(1);
+    dashboard.update( 5, make_status(State::Done, 10) );
+}
+
+TEST(DashboardLive, rate_and_eta)
+{
+    DashboardMock inner;
+    ostringstream out;
+    auto time = make_unique<TimeMock>();
+    auto time_ptr = time.get();
+    size_t queued = 0;
+    DashboardLive dashboard{inner, out, move(time), [&queued]() { return queued; }, 1, false};
+
+    EXPECT_CALL( *time_ptr, elapsed_() )
+            .WillRepeatedly( Return(milliseconds{250}) );
+
+    // 2 jobs: 1000 and 250 bytes in 250 ms
+    dashboard.progress( 1, make_status(State::OnTheGo, 1000, 10000) );
+    dashboard.progress( 2, make_status(State::OnTheGo, 250, 1250) );
+    dashboard.sweep_done();
+    EXPECT_EQ( dashboard.rate(), 5000u );
+    // Remaining 9000 + 1000 bytes at 5000 bytes/s
+    EXPECT_EQ( dashboard.eta(), 2u );
+
+    const auto text = out.str();
+    EXPECT_NE( text.find("Running: 2, queued: 0"), string::npos );
+    // Only the slowest job is shown
+    EXPECT_NE( text.find("#2 1000 B/s"), string::npos );
+    EXPECT_EQ( text.find("#1 "), string::npos );
+}
+
+TEST(DashboardLive, finished_between_sweeps)
+{
+    DashboardMock inner;
+    ostringstream out;
+    auto time = make_unique<TimeMock>();
+    auto time_ptr = time.get();
+    size_t queued = 2;
+    DashboardLive dashboard{inner, out, move(time), [&queued]() { return queued; }, 3, false};
+
+    EXPECT_CALL( inner, update(_, _) )
+            .Times(1);
+    EXPECT_CALL( *time_ptr, elapsed_() )
+            .WillRepeatedly( Return(milliseconds{1000}) );
+
+    dashboard.progress( 1, make_status(State::OnTheGo, 400, 1000) );
+    dashboard.sweep_done();
+    EXPECT_EQ( dashboard.rate(), 400u );
+
+    // Last 600 bytes arrive with Done, before the next sweep
+    dashboard.update( 1, make_status(State::Done, 1000, 1000) );
+    dashboard.sweep_done();
+    EXPECT_EQ( dashboard.rate(), (400u * 3 + 600u) / 4 );
+    // 2 queued tasks at the average size of done ones
+    EXPECT_EQ( dashboard.eta(), (2000u + 450u - 1) / 450u );
+    EXPECT_NE( out.str().find("Running: 0, queued: 2"), string::npos );
+}
+
+TEST(DashboardLive, job_gone_without_update)
+{
+    DashboardMock inner;
+    ostringstream out;
+    auto time = make_unique<TimeMock>();
+    auto time_ptr = time.get();
+    DashboardLive dashboard{inner, out, move(time)};
+
+    EXPECT_CALL( *time_ptr, elapsed_() )
+            .WillRepeatedly( Return(milliseconds{1000}) );
+
+    dashboard.progress( 1, make_status(State::OnTheGo, 100) );
+    dashboard.progress( 2, make_status(State::OnTheGo, 100) );
+    dashboard.sweep_done();
+    dashboard.progress( 2, make_status(State::OnTheGo, 200) );
+    dashboard.sweep_done();
+
+    const auto text = out.str();
+    const auto last = text.rfind("Running: ");
+    ASSERT_NE( last, string::npos );
+    EXPECT_EQ( text.compare(last, 10, "Running: 1"), 0 );
+    EXPECT_EQ( text.find("#1 ", last), string::npos );
+}
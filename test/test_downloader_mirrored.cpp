@@ -0,0 +1,243 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/uvw/loop_mock.h"
+#include "mock/uvw/timer_mock.h"
+#include "mock/uvw/file_mock.h"
+#include "mock/aio/bandwidth_time_mock.h"
+#include "mock/downloader_mock.h"
+#include "mock/on_tick_mock.h"
+
+#include "http.h"
+#include "downloader_mirrored.h"
+
+
+using ::std::size_t;
+using ::std::string;
+using ::std::vector;
+using ::std::shared_ptr;
+using ::std::make_shared;
+using ::std::make_unique;
+using ::std::move;
+
+using ::testing::_;
+using ::testing::Return;
+using ::testing::ReturnRef;
+using ::testing::Mock;
+using ::testing::AnyNumber;
+using ::testing::AllOf;
+using ::testing::Field;
+
+struct AIO_Mock
+{
+    using Loop = LoopMock;
+    using TimerHandle = TimerHandleMock;
+    using FsReq = FsReqMock;
+};
+
+using Mirrored = DownloaderMirrored<AIO_Mock, HttpParser>;
+using State = StatusDownloader::State;
+using Entity = DownloaderResumable::Entity;
+
+struct Source
+{
+    shared_ptr<DownloaderResumableMock> downloader = make_shared<DownloaderResumableMock>();
+    StatusDownloader status;
+    DownloaderResumable::Entity entity;
+    shared_ptr<OnTick> relay;
+};
+
+struct DownloaderMirroredF : public ::testing::Test
+{
+    DownloaderMirroredF()
+        : loop{ make_shared<LoopMock>() },
+          timer{ make_shared<TimerHandleMock>() },
+          on_tick{ make_shared<OnTickMock>() },
+          rates{ make_shared<MirrorRates>() },
+          uri_a{"http://a.example/file.zip"},
+          uri_b{"http://b.example/file.zip"},
+          fname{"mirrored_test_file.zip"}
+    {
+        auto time_ = make_unique<aio::bandwidth::TimeMock>();
+        time = time_.get();
+        ON_CALL( *time, elapsed_() ).WillByDefault( Return(std::chrono::milliseconds{1000}) );
+        EXPECT_CALL( *time, elapsed_() ).Times( AnyNumber() );
+
+        for (auto& source : sources)
+        {
+            EXPECT_CALL( *source.downloader, status() ).WillRepeatedly( ReturnRef(source.status) );
+            EXPECT_CALL( *source.downloader, entity() ).WillRepeatedly( ReturnRef(source.entity) );
+        }
+
+        auto make_source = [this](shared_ptr<OnTick> relay) -> shared_ptr<DownloaderResumable>
+        {
+            auto& source = sources[created++];
+            source.relay = move(relay);
+            return source.downloader;
+        };
+        downloader = make_shared<Mirrored>(loop, on_tick, make_source, rates, move(time_));
+    }
+
+    void start()
+    {
+        EXPECT_CALL( *loop, resource_TimerHandleMock() ).WillOnce( Return(timer) );
+        EXPECT_CALL( *sources[0].downloader, resume(uri_a, fname, 0, _) ).WillOnce( Return(true) );
+        EXPECT_CALL( *timer, start(_,_) ).Times(1);
+
+        ASSERT_TRUE( downloader->run(uri_a + "|" + uri_b, fname) );
+        EXPECT_EQ( downloader->status().state, State::OnTheGo );
+        ASSERT_EQ( created, 1 );
+        Mock::VerifyAndClearExpectations( timer.get() );
+    }
+
+    void report(size_t i) { sources[i].relay->invoke( sources[i].downloader ); }
+
+    shared_ptr<LoopMock> loop;
+    shared_ptr<TimerHandleMock> timer;
+    shared_ptr<OnTickMock> on_tick;
+    shared_ptr<MirrorRates> rates;
+    aio::bandwidth::TimeMock* time;
+
+    const string uri_a;
+    const string uri_b;
+    const string fname;
+
+    Source sources[3];
+    size_t created = 0;
+    shared_ptr<Mirrored> downloader;
+};
+
+TEST(DownloaderMirrored, split)
+{
+    EXPECT_EQ( Mirrored::split("a||b|"), (vector<string>{"a", "b"}) );
+    EXPECT_EQ( Mirrored::split("a"), (vector<string>{"a"}) );
+    EXPECT_TRUE( Mirrored::split("|").empty() );
+}
+
+TEST_F(DownloaderMirroredF, failover_resumes_at_offset)
+{
+    start();
+
+    sources[0].status.state = State::Failed;
+    sources[0].status.downloaded = 300;
+    EXPECT_CALL( *sources[0].downloader, offset() ).WillOnce( Return(300) );
+    EXPECT_CALL( *sources[1].downloader, resume(uri_b, fname, 300, _) ).WillOnce( Return(true) );
+    EXPECT_CALL( *on_tick, invoke_(_) ).Times(0);
+    report(0);
+    EXPECT_EQ( downloader->status().state, State::OnTheGo );
+    EXPECT_EQ( rates->estimate("a.example"), 0 );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    sources[1].status.state = State::Done;
+    sources[1].status.downloaded = 700;
+    EXPECT_CALL( *sources[1].downloader, offset() ).WillOnce( Return(1000) );
+    EXPECT_CALL( *timer, close_() ).Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) ).Times(1);
+    report(1);
+
+    const auto& status = downloader->status();
+    EXPECT_EQ( status.state, State::Done );
+    EXPECT_EQ( status.size, 1000 );
+    EXPECT_EQ( status.downloaded, 1000 );
+}
+
+TEST_F(DownloaderMirroredF, entity_pinned_by_first_source)
+{
+    start();
+
+    sources[0].entity.size = 1000;
+    sources[0].entity.etag = "\"58c2fb69-3e8\"";
+    sources[0].status.state = State::Failed;
+    EXPECT_CALL( *sources[0].downloader, offset() ).WillOnce( Return(300) );
+    EXPECT_CALL( *sources[1].downloader, resume(uri_b, fname, 300, AllOf( Field(&Entity::size, 1000u), Field(&Entity::etag, "\"58c2fb69-3e8\"") )) )
+            .WillOnce( Return(true) );
+    report(0);
+    EXPECT_EQ( downloader->status().state, State::OnTheGo );
+}
+
+TEST_F(DownloaderMirroredF, all_mirrors_failed)
+{
+    start();
+
+    sources[0].status.state = State::Failed;
+    EXPECT_CALL( *sources[0].downloader, offset() ).WillOnce( Return(0) );
+    EXPECT_CALL( *sources[1].downloader, resume(uri_b, fname, 0, _) ).WillOnce( Return(true) );
+    report(0);
+
+    auto fs = make_shared<FsReqMock>();
+    sources[1].status.state = State::Failed;
+    sources[1].status.error = StatusDownloader::Error::Connect;
+    EXPECT_CALL( *sources[1].downloader, offset() ).WillOnce( Return(0) );
+    EXPECT_CALL( *timer, close_() ).Times(1);
+    EXPECT_CALL( *loop, resource_FsReqMock() ).WillOnce( Return(fs) );
+    EXPECT_CALL( *fs, unlink(fname) ).Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) ).Times(1);
+    report(1);
+
+    const auto& status = downloader->status();
+    EXPECT_EQ( status.state, State::Failed );
+    EXPECT_EQ( status.error, StatusDownloader::Error::Connect );
+    EXPECT_EQ( created, 2 );
+}
+
+TEST_F(DownloaderMirroredF, checksum_failed_not_retried)
+{
+    start();
+
+    auto fs = make_shared<FsReqMock>();
+    sources[0].status.state = State::Failed;
+    sources[0].status.error = StatusDownloader::Error::Checksum;
+    EXPECT_CALL( *sources[0].downloader, offset() ).WillOnce( Return(1000) );
+    EXPECT_CALL( *sources[1].downloader, resume(_,_,_,_) ).Times(0);
+    EXPECT_CALL( *timer, close_() ).Times(1);
+    EXPECT_CALL( *loop, resource_FsReqMock() ).WillOnce( Return(fs) );
+    EXPECT_CALL( *fs, unlink(fname) ).Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) ).Times(1);
+    report(0);
+
+    EXPECT_EQ( downloader->status().state, State::Failed );
+    EXPECT_EQ( downloader->status().error, StatusDownloader::Error::Checksum );
+    EXPECT_EQ( created, 1 );
+}
+
+TEST_F(DownloaderMirroredF, switch_to_faster_mirror)
+{
+    rates->record("b.example", 1e6);
+    start();
+
+    auto& status = sources[0].status;
+    status.phase = StatusDownloader::Phase::Receive;
+    status.size = 10000000;
+    status.downloaded = 1000;
+    timer->publish( ::uvw::TimerEvent{} );
+
+    // Second interval measures 1000 B/s, b.example is faster enough
+    status.downloaded = 2000;
+    EXPECT_CALL( *sources[0].downloader, suspend() ).WillOnce( Return(true) );
+    timer->publish( ::uvw::TimerEvent{} );
+    Mock::VerifyAndClearExpectations( sources[0].downloader.get() );
+
+    const auto switches = metrics::registry().mirror_switches.value();
+    status.state = State::Suspended;
+    EXPECT_CALL( *sources[0].downloader, status() ).WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( *sources[0].downloader, entity() ).WillRepeatedly( ReturnRef(sources[0].entity) );
+    EXPECT_CALL( *sources[0].downloader, offset() ).WillOnce( Return(2000) );
+    EXPECT_CALL( *sources[1].downloader, resume(uri_b, fname, 2000, _) ).WillOnce( Return(true) );
+    report(0);
+
+    EXPECT_EQ( metrics::registry().mirror_switches.value(), switches + 1 );
+    EXPECT_EQ( downloader->status().state, State::OnTheGo );
+    EXPECT_EQ( downloader->status().downloaded, 2000 );
+}
+
+TEST_F(DownloaderMirroredF, slow_start_not_switched)
+{
+    rates->record("b.example", 1e6);
+    start();
+
+    sources[0].status.phase = StatusDownloader::Phase::Receive;
+    sources[0].status.size = 10000000;
+    sources[0].status.downloaded = 10;
+    EXPECT_CALL( *sources[0].downloader, suspend() ).Times(0);
+    timer->publish( ::uvw::TimerEvent{} );
+}
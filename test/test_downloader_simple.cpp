@@ -5,9 +5,11 @@
 #include "mock/uvw/dns_mock.h"
 #include "mock/uvw/timer_mock.h"
 #include "mock/uvw/file_mock.h"
+#include "mock/uvw/work_mock.h"
 #include "mock/aio/tcp_mock.h"
 #include "mock/aio/factory_tcp_mock.h"
 #include "mock/on_tick_mock.h"
+#include "mock/validator_store_mock.h"
 
 #include "aio_uvw.h"
 #include "http.h"
@@ -17,6 +19,8 @@
 #include <regex>
 #include <algorithm>
 #include <random>
+#include <fstream>
+#include <cstdio>
 
 using ::std::cout;
 using ::std::endl;
@@ -43,6 +47,7 @@ using ::testing::SaveArg;
 using ::testing::AtLeast;
 using ::testing::AtMost;
 using ::testing::AnyNumber;
+using ::testing::SetArgReferee;
 
 struct AIO_Mock
 {
@@ -55,6 +60,7 @@ struct AIO_Mock
     using TimerHandle = TimerHandleMock;
     using FileReq = FileReqMock;
     using FsReq = FsReqMock;
+    using WorkReq = WorkReqMock;
 };
 
 using FileOpenEvent = ::uvw::FsEvent<uvw::FileReq::Type::OPEN>;
@@ -84,6 +90,11 @@ HttpParserMock* HttpParserMock::instance_response_parse;
 
 /*------- uri parse -------*/
 
+// Fixtures derive from DownloaderSimpleF, one with a checksum sets it before the downloader is made
+static shared_ptr<Checksum> fixture_checksum;
+static bool fixture_overwrite = false;
+static shared_ptr<ValidatorStoreMock> fixture_validators;
+
 struct DownloaderSimpleF : public ::testing::Test
 {
     DownloaderSimpleF()
@@ -93,9 +104,13 @@ struct DownloaderSimpleF : public ::testing::Test
           instance_uri_parse{ make_unique<HttpParserMock>() },
 
           backlog{4},
-          downloader{ make_shared< DownloaderSimple<AIO_Mock, HttpParserMock> >(loop, on_tick, factory_socket, backlog) }
+          store{ std::move(fixture_validators) },
+          downloader{ make_shared< DownloaderSimple<AIO_Mock, HttpParserMock> >(loop, on_tick, factory_socket, backlog, nullptr, nullptr, store, nullptr, fixture_checksum, fixture_overwrite) }
     {
         HttpParserMock::instance_uri_parse = instance_uri_parse.get();
+        fixture_checksum.reset();
+        fixture_overwrite = false;
+        fixture_validators.reset();
     }
 
     virtual ~DownloaderSimpleF()
@@ -112,6 +127,8 @@ struct DownloaderSimpleF : public ::testing::Test
     unique_ptr<HttpParserMock> instance_uri_parse;
 
     const size_t backlog;
+    // Set, the file of the previous run is recorded, a changed file is written to <fname>.part
+    shared_ptr<ValidatorStoreMock> store;
 
     shared_ptr<Downloader> downloader;
 };
@@ -132,7 +149,8 @@ TEST_F(DownloaderSimpleF, uri_parse_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed);
-    cout << "downloader status: " << status.state_str << endl;
+    EXPECT_EQ( status.error, StatusDownloader::Error::UriParse );
+    cout << "downloader status: " << status.str() << endl;
 
     Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
@@ -198,7 +216,7 @@ TEST_F(DownloaderSimpleHandlesCreate, socket_create_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed);
-    cout << "downloader status: " << status.state_str << endl;
+    cout << "downloader status: " << status.str() << endl;
 
     Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
@@ -250,7 +268,7 @@ TEST_F(DownloaderSimpleHandlesCreate, timer_create_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed);
-    cout << "downloader status: " << status.state_str << endl;
+    cout << "downloader status: " << status.str() << endl;
 
     Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
@@ -305,7 +323,7 @@ TEST_F(DownloaderSimpleHandlesCreate, resolver_create_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed);
-    cout << "downloader status: " << status.state_str << endl;
+    cout << "downloader status: " << status.str() << endl;
 
     Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
@@ -382,7 +400,7 @@ TEST_F(DownloaderSimpleResolve, resolver_failed_on_run)
 
     const auto status = downloader->status();
     EXPECT_EQ(status.state, StatusDownloader::State::Failed);
-    cout << "downloader status: " << status.state_str << endl;
+    cout << "downloader status: " << status.str() << endl;
 
     check_close_socket_and_timer();
     Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
@@ -392,7 +410,7 @@ TEST_F(DownloaderSimpleResolve, resolver_failed_on_run)
     Mock::VerifyAndClearExpectations( resolver.get() );
 }
 
-auto on_tick_handler = [](Downloader* d) { cout << "on_tick => downloader status: " << d->status().state_str << endl; };
+auto on_tick_handler = [](Downloader* d) { cout << "on_tick => downloader status: " << d->status().str() << endl; };
 
 struct DownloaderSimpleResolve_normalRun : public DownloaderSimpleResolve
 {
@@ -407,7 +425,7 @@ struct DownloaderSimpleResolve_normalRun : public DownloaderSimpleResolve
 
         const auto status = downloader->status();
         EXPECT_EQ( status.state, StatusDownloader::State::OnTheGo );
-        cout << "downloader status: " << status.state_str << endl;
+        cout << "downloader status: " << status.str() << endl;
 
         Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
         Mock::VerifyAndClearExpectations( loop.get() );
@@ -429,6 +447,8 @@ TEST_F(DownloaderSimpleResolve_normalRun, host_resolve_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed );
+    EXPECT_EQ( status.error, StatusDownloader::Error::Resolve );
+    EXPECT_EQ( status.error_code, static_cast<int>(UV_EAI_NONAME) );
 
     check_close_socket_and_timer();
     Mock::VerifyAndClearExpectations( resolver.get() );
@@ -447,6 +467,7 @@ TEST_F(DownloaderSimpleResolve_normalRun, stop)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed );
+    EXPECT_EQ( status.error, StatusDownloader::Error::Abort );
 
     check_close_socket_and_timer();
     Mock::VerifyAndClearExpectations( resolver.get() );
@@ -510,6 +531,8 @@ TEST_F(DownloaderSimpleConnect, connect_failed)
 
     const auto status = downloader->status();
     EXPECT_EQ( status.state, StatusDownloader::State::Failed );
+    EXPECT_EQ( status.error, StatusDownloader::Error::Connect );
+    EXPECT_EQ( status.error_code, static_cast<int>(UV_ECONNREFUSED) );
 
     check_close_socket_and_timer();
     Mock::VerifyAndClearExpectations( on_tick.get() );
@@ -838,6 +861,145 @@ TEST_F(DownloaderSimpleHttpRequest, timer_failed_on_run)
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
 
+TEST_F(DownloaderSimpleResolve, resume_range_request_and_suspend)
+{
+    auto resumable = std::dynamic_pointer_cast<DownloaderResumable>(downloader);
+    ASSERT_TRUE(resumable);
+
+    EXPECT_CALL( *resolver, nodeAddrInfo(host) )
+            .Times(1);
+    EXPECT_TRUE( resumable->resume(uri, fname, 1000, DownloaderResumable::Entity{}) );
+    EXPECT_EQ( resumable->offset(), 1000 );
+
+    EXPECT_CALL( *socket, connect(_, port) )
+            .Times(1);
+    EXPECT_CALL( *timer, start(_,_) )
+            .Times( AtLeast(1) );
+    EXPECT_CALL( *timer, stop() )
+            .Times( AnyNumber() );
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(2)
+            .WillRepeatedly( Invoke(on_tick_handler) );
+
+    resolver->publish( create_addr_info_event("127.0.0.1") );
+
+    string request;
+    EXPECT_CALL( *socket, write_(_,_) )
+            .WillRepeatedly( Invoke( [&request](const char data[], unsigned int len) { request.append(data, len); } ) );
+
+    socket->publish( ::uvw::ConnectEvent{} );
+
+    std::regex re_range{"\\r\\nRange:\\sbytes=1000-\\r\\n"};
+    if ( !std::regex_search(request, re_range) )
+        FAIL() << "Request failed, invalid Range header. Request:" << endl << request << endl;
+
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    // Nothing is written yet, reported right away and the file is kept
+    prepare_close_socket_and_timer();
+    EXPECT_CALL( *loop, resource_FsReqMock() )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    EXPECT_TRUE( resumable->suspend() );
+
+    const auto status = downloader->status();
+    EXPECT_EQ( status.state, StatusDownloader::State::Suspended );
+    EXPECT_EQ( resumable->offset(), 1000 );
+    EXPECT_FALSE( resumable->suspend() );
+
+    check_close_socket_and_timer();
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
+struct DownloaderSimpleResumeCheck : public DownloaderSimpleResolve
+{
+    DownloaderSimpleResumeCheck()
+    {
+        expected.size = 5000;
+        expected.etag = "\"58c2fb69-1388\"";
+
+        result.state = HttpParser::ResponseParseResult::State::InProgress;
+        result.http_status = 206;
+        result.headers_complete = true;
+        result.content_range = true;
+        result.range_start = 1000;
+        result.range_total = expected.size;
+        result.etag = expected.etag;
+    }
+
+    // Resumed at 1000, the response is rejected before anything is written
+    const StatusDownloader& respond()
+    {
+        auto resumable = std::dynamic_pointer_cast<DownloaderResumable>(downloader);
+
+        EXPECT_CALL( *resolver, nodeAddrInfo(host) )
+                .Times(1);
+        EXPECT_TRUE( resumable->resume(uri, fname, 1000, expected) );
+
+        EXPECT_CALL( *socket, connect(_, port) )
+                .Times(1);
+        EXPECT_CALL( *socket, write_(_,_) )
+                .Times( AtLeast(1) );
+        EXPECT_CALL( *socket, read() )
+                .Times(1);
+        EXPECT_CALL( *timer, start(_,_) )
+                .Times( AnyNumber() );
+        EXPECT_CALL( *timer, stop() )
+                .Times( AnyNumber() );
+        EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+                .WillRepeatedly( Invoke(on_tick_handler) );
+
+        resolver->publish( create_addr_info_event("127.0.0.1") );
+        socket->publish( ::uvw::ConnectEvent{} );
+        socket->publish( ::uvw::WriteEvent{} );
+
+        auto http_parser = new HttpParserMock;
+        HttpParserMock::instance_response_parse = http_parser;
+        EXPECT_CALL( *http_parser, create_(_) )
+                .WillOnce( Return( ByMove( unique_ptr<HttpParserMock>{http_parser} ) ) );
+        EXPECT_CALL( *http_parser, response_parse_(_,_) )
+                .WillOnce( Return(result) );
+        EXPECT_CALL( *loop, resource_FileReqMock() )
+                .Times(0);
+        prepare_close_socket_and_timer();
+
+        socket->publish( ::uvw::DataEvent{ make_unique<char[]>(42), 42 } );
+
+        check_close_socket_and_timer();
+        return downloader->status();
+    }
+
+    DownloaderResumable::Entity expected;
+    HttpParser::ResponseParseResult result;
+};
+
+TEST_F(DownloaderSimpleResumeCheck, range_not_at_offset)
+{
+    result.range_start = 0;
+    const auto& status = respond();
+
+    EXPECT_EQ( status.state, StatusDownloader::State::Failed );
+    EXPECT_EQ( status.error, StatusDownloader::Error::ResponseParse );
+    EXPECT_NE( status.detail.find("Content-Range"), string::npos );
+}
+
+TEST_F(DownloaderSimpleResumeCheck, another_file)
+{
+    result.range_total = 6000;
+    EXPECT_NE( respond().detail.find("size 6000"), string::npos );
+}
+
+TEST_F(DownloaderSimpleResumeCheck, validator_changed)
+{
+    result.etag = "\"58c2fb70-1388\"";
+    const auto& status = respond();
+
+    EXPECT_EQ( status.state, StatusDownloader::State::Failed );
+    EXPECT_NE( status.detail.find("ETag"), string::npos );
+}
+
 /*------- read start -------*/
 
 struct DownloaderSimpleReadStart : public DownloaderSimpleHttpRequest
@@ -1028,6 +1190,192 @@ TEST_F(DownloaderSimpleResponseParse, redirect)
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
 
+TEST_F(DownloaderSimpleResponseParse, redirect_same_origin_on_open_connection)
+{
+    const size_t len = 1510;
+    char* data = new char[len];
+    const string redirect_query = "/uri/other.zip";
+
+    HttpParser::ResponseParseResult result;
+    result.state = HttpParser::ResponseParseResult::State::Redirect;
+    result.redirect_uri = redirect_query;
+    result.http_status = 302;
+    result.keep_alive = true;
+
+    EXPECT_CALL( *http_parser, response_parse_(data, len) )
+            .WillOnce( Return(result) );
+
+    auto uri_parsed = make_unique<UriParseResult>();
+    uri_parsed->host = host;
+    uri_parsed->port = port;
+    uri_parsed->query = redirect_query;
+    EXPECT_CALL( *instance_uri_parse, uri_parse_(host + redirect_query) )
+            .WillOnce( Return( ByMove( std::move(uri_parsed) ) ) );
+
+    string request;
+    EXPECT_CALL( *socket, stop() )
+            .Times(1);
+    EXPECT_CALL( *socket, shutdown() )
+            .Times(0);
+    EXPECT_CALL( *socket, write_(_,_) )
+            .WillRepeatedly( Invoke( [&request](const char data[], unsigned int len) { request.append(data, len); } ) );
+    EXPECT_CALL( *timer, stop() )
+            .Times(1);
+    EXPECT_CALL( *timer, start(_,_) )
+            .Times(1);
+    EXPECT_CALL( *timer, close_())
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    const auto followed = metrics::registry().redirects_followed.value();
+    socket->publish( ::uvw::DataEvent{ unique_ptr<char[]>{data}, len } );
+
+    const auto status = downloader->status();
+    EXPECT_EQ( status.state, StatusDownloader::State::OnTheGo );
+    EXPECT_EQ( status.phase, StatusDownloader::Phase::Request );
+    EXPECT_EQ( metrics::registry().redirects_followed.value(), followed + 1 );
+
+    std::regex re_request_line{"^GET\\s" + redirect_query + "\\sHTTP/1.1\\r\\n"};
+    if ( !std::regex_search(request, re_request_line) )
+        FAIL() << "Request failed, invalid request line. Request:" << endl << request << endl;
+
+    Mock::VerifyAndClearExpectations( instance_uri_parse.get() );
+    Mock::VerifyAndClearExpectations( socket.get() );
+    Mock::VerifyAndClearExpectations( timer.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    prepare_close_socket_and_timer();
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    downloader->stop();
+
+    check_close_socket_and_timer();
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
+TEST_F(DownloaderSimpleResponseParse, not_modified)
+{
+    HttpParser::ResponseParseResult result;
+    result.state = HttpParser::ResponseParseResult::State::Done;
+    result.http_status = 304;
+    result.content_length = 0;
+
+    EXPECT_CALL( *http_parser, response_parse_(_,_) )
+            .WillOnce( Return(result) );
+
+    EXPECT_CALL( *socket, stop() )
+            .Times(1);
+    EXPECT_CALL( *socket, shutdown() )
+            .Times(1);
+    EXPECT_CALL( *timer, stop() )
+            .Times(1);
+    EXPECT_CALL( *timer, close_())
+            .Times(1);
+    // Output file is not touched
+    EXPECT_CALL( *loop, resource_FileReqMock() )
+            .Times(0);
+
+    socket->publish( ::uvw::DataEvent{ make_unique<char[]>(147), 147 } );
+
+    EXPECT_CALL( *socket, close_() )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    socket->publish( ::uvw::ShutdownEvent{} );
+
+    const auto status = downloader->status();
+    EXPECT_EQ( status.state, StatusDownloader::State::Done );
+    EXPECT_EQ( status.http_status, 304u );
+
+    Mock::VerifyAndClearExpectations( http_parser );
+    Mock::VerifyAndClearExpectations( socket.get() );
+    Mock::VerifyAndClearExpectations( timer.get() );
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
+struct FixtureSidecar
+{
+    FixtureSidecar()
+        : checksum{ make_shared<Checksum>(Checksum::Algorithm::Crc32c, "", true) },
+          work{ make_shared<WorkReqMock>() }
+    {
+        fixture_checksum = checksum;
+    }
+
+    virtual ~FixtureSidecar()
+    {
+        EXPECT_LE(work.use_count(), 2);
+    }
+
+    shared_ptr<Checksum> checksum;
+    shared_ptr<WorkReqMock> work;
+    function< void() > task;
+};
+
+struct DownloaderSimpleSidecar : public FixtureSidecar, public DownloaderSimpleResponseParse
+{};
+
+TEST_F(DownloaderSimpleSidecar, written_on_threadpool_then_done)
+{
+    HttpParser::ResponseParseResult result;
+    result.state = HttpParser::ResponseParseResult::State::Done;
+    result.http_status = 200;
+    result.content_length = 0;
+
+    EXPECT_CALL( *http_parser, response_parse_(_,_) )
+            .WillOnce( Return(result) );
+    EXPECT_CALL( *socket, stop() )
+            .Times(1);
+    EXPECT_CALL( *socket, shutdown() )
+            .Times(1);
+    EXPECT_CALL( *timer, stop() )
+            .Times(1);
+    EXPECT_CALL( *timer, close_())
+            .Times(1);
+
+    socket->publish( ::uvw::DataEvent{ make_unique<char[]>(147), 147 } );
+
+    // Not Done until the digest file is written
+    EXPECT_CALL( *socket, close_() )
+            .Times(1);
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task), Return(work) ) );
+    EXPECT_CALL( *work, queue() )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(0);
+
+    socket->publish( ::uvw::ShutdownEvent{} );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::OnTheGo );
+
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( work.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    const string sidecar = fname + ".crc32c";
+    task();
+    std::ifstream stream{sidecar};
+    string line;
+    std::getline(stream, line);
+    EXPECT_EQ( line, checksum->hex() + "  " + fname );
+    std::remove( sidecar.c_str() );
+
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    work->publish( ::uvw::WorkEvent{} );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::Done );
+
+    Mock::VerifyAndClearExpectations( http_parser );
+    Mock::VerifyAndClearExpectations( socket.get() );
+    Mock::VerifyAndClearExpectations( timer.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
 TEST_F(DownloaderSimpleResponseParse, error_on_headers)
 {
     HttpParser::ResponseParseResult result;
@@ -1058,7 +1406,8 @@ struct DownloaderSimpleFileOpen : public DownloaderSimpleResponseParse
 {
     DownloaderSimpleFileOpen()
         : file{ make_shared<FileReqMock>() },
-          file_flags{ O_CREAT | O_EXCL | O_WRONLY },
+          file_path{ (store) ? fname + ".part" : fname },
+          file_flags{ O_CREAT | ((store) ? O_TRUNC : O_EXCL) | O_WRONLY },
           file_mode{ S_IRUSR | S_IWUSR | S_IRGRP }
     {
         HttpParser::ResponseParseResult result;
@@ -1088,6 +1437,7 @@ struct DownloaderSimpleFileOpen : public DownloaderSimpleResponseParse
 
     shared_ptr<FileReqMock> file;
 
+    const string file_path;
     const int file_flags;
     const int file_mode;
 
@@ -1098,7 +1448,7 @@ struct DownloaderSimpleFileOpen : public DownloaderSimpleResponseParse
 
 TEST_F(DownloaderSimpleFileOpen, file_filed_open)
 {
-    EXPECT_CALL( *file, open(fname, file_flags, file_mode) )
+    EXPECT_CALL( *file, open(file_path, file_flags, file_mode) )
             .Times(1);
     {
         InSequence s;
@@ -1107,8 +1457,9 @@ TEST_F(DownloaderSimpleFileOpen, file_filed_open)
         EXPECT_CALL( *timer, start(_,_) )
                 .Times(1);
     }
+    // Received data is polled, not ticked
     EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
-            .WillOnce( Invoke(on_tick_handler) );
+            .Times(0);
 
     socket->publish( ::uvw::DataEvent{ make_unique<char[]>(42), 42 } );
 
@@ -1139,9 +1490,64 @@ TEST_F(DownloaderSimpleFileOpen, file_filed_open)
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
 
+struct FixtureOverwrite
+{
+    FixtureOverwrite()
+    {
+        fixture_overwrite = true;
+    }
+};
+
+struct DownloaderSimpleFileOverwrite : public FixtureOverwrite, public DownloaderSimpleFileOpen
+{};
+
+struct FixtureValidators
+{
+    FixtureValidators()
+        : validators{ make_shared<ValidatorStoreMock>() }
+    {
+        ValidatorStore::Validator validator;
+        validator.etag = "\"v1\"";
+        validator.size = 42;
+        EXPECT_CALL( *validators, lookup(_,_,_) )
+                .WillRepeatedly( DoAll( SetArgReferee<2>(validator), Return(true) ) );
+        EXPECT_CALL( *validators, record(_,_) )
+                .Times( AnyNumber() );
+        fixture_validators = validators;
+    }
+
+    shared_ptr<ValidatorStoreMock> validators;
+};
+
+TEST_F(DownloaderSimpleFileOverwrite, file_left_by_previous_run_truncated)
+{
+    EXPECT_CALL( *file, open(fname, O_CREAT | O_TRUNC | O_WRONLY, file_mode) )
+            .Times(1);
+    EXPECT_CALL( *timer, stop() )
+            .Times(1);
+    EXPECT_CALL( *timer, start(_,_) )
+            .Times(1);
+
+    socket->publish( ::uvw::DataEvent{ make_unique<char[]>(42), 42 } );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::OnTheGo );
+
+    Mock::VerifyAndClearExpectations( file.get() );
+    Mock::VerifyAndClearExpectations( timer.get() );
+
+    prepare_close_socket_and_timer();
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    file->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EPERM) } );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::Failed );
+
+    check_close_socket_and_timer();
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
 TEST_F(DownloaderSimpleFileOpen, file_filed_open_on_run)
 {
-    EXPECT_CALL( *file, open(fname, file_flags, file_mode) )
+    EXPECT_CALL( *file, open(file_path, file_flags, file_mode) )
             .WillOnce( InvokeWithoutArgs( [this]() { file->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EPERM) } ); } ) );
 
     EXPECT_CALL( *timer, stop() )
@@ -1184,7 +1590,7 @@ struct FileCloseAndUnlink : public DownloaderSimpleFileOpen
             InSequence s;
             EXPECT_CALL( *file, close() )
                     .Times(1);
-            EXPECT_CALL( *fs, unlink(fname) )
+            EXPECT_CALL( *fs, unlink(file_path) )
                     .Times(1);
         }
     }
@@ -1209,7 +1615,7 @@ struct FileCloseAndUnlink : public DownloaderSimpleFileOpen
                     .WillOnce( Return(true) );
             EXPECT_CALL( *file, close() )
                     .Times(1);
-            EXPECT_CALL( *fs, unlink(fname) )
+            EXPECT_CALL( *fs, unlink(file_path) )
                     .Times(1);
         }
     }
@@ -1246,7 +1652,7 @@ struct DownloaderSimpleFileWrite : public FileCloseAndUnlink
 {
     DownloaderSimpleFileWrite()
     {
-        EXPECT_CALL( *file, open(fname, file_flags, file_mode) )
+        EXPECT_CALL( *file, open(file_path, file_flags, file_mode) )
                 .Times(1);
         {
             InSequence s;
@@ -1255,8 +1661,9 @@ struct DownloaderSimpleFileWrite : public FileCloseAndUnlink
             EXPECT_CALL( *timer, start(_,_) )
                     .Times(1);
         }
+        // Received data is polled, not ticked
         EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
-                .WillOnce( Invoke(on_tick_handler) );
+                .Times(0);
 
         socket->publish( ::uvw::DataEvent{ unique_ptr<char[]>{ generate_data(421) }, 421 } );
 
@@ -1315,6 +1722,31 @@ TEST_F(DownloaderSimpleFileWrite, write_failed)
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
 
+// The file of the previous run is not touched, the part is removed
+struct DownloaderSimpleConditionalWrite : public FixtureValidators, public DownloaderSimpleFileWrite
+{};
+
+TEST_F(DownloaderSimpleConditionalWrite, write_failed_part_removed)
+{
+    EXPECT_EQ( file_path, fname + ".part" );
+    EXPECT_CALL( *file, write(_,_,_) )
+            .Times(1);
+
+    file->publish( FileOpenEvent{file_path.c_str()} );
+
+    prepare_close_socket_and_timer();
+    prepare_close_unlink_file();
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    file->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EIO) } );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::Failed );
+
+    check_close_socket_and_timer();
+    check_close_unlink_file();
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
 TEST_F(DownloaderSimpleFileWrite, socket_read_error)
 {
     EXPECT_CALL( *file, write(_,_,_) )
@@ -1423,7 +1855,7 @@ struct DownloaderSimpleQueue : public FileCloseAndUnlink
 {
     DownloaderSimpleQueue()
     {
-        EXPECT_CALL( *file, open(fname, file_flags, file_mode) )
+        EXPECT_CALL( *file, open(file_path, file_flags, file_mode) )
                 .Times(1);
 
         EXPECT_CALL( *timer, stop() )
@@ -1431,9 +1863,9 @@ struct DownloaderSimpleQueue : public FileCloseAndUnlink
         EXPECT_CALL( *timer, start(_,_) )
                 .Times( AtLeast(1) );
 
+        // Received data is polled, not ticked
         EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
-                .Times( AtLeast(1) )
-                .WillRepeatedly( Invoke(on_tick_handler) );
+                .Times(0);
     }
 };
 
@@ -1669,6 +2101,143 @@ TEST_F(DownloaderSimpleQueue, dont_call_read_if_socket_active)
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
 
+/* Stage on the threadpool */
+
+struct FixtureChecksum
+{
+    FixtureChecksum()
+        : checksum{ make_shared<Checksum>(Checksum::Algorithm::Crc32c) }
+    {
+        fixture_checksum = checksum;
+    }
+
+    shared_ptr<Checksum> checksum;
+};
+
+struct DownloaderSimpleStage : public FixtureChecksum, public DownloaderSimpleQueue
+{
+    DownloaderSimpleStage()
+        : work_1{ make_shared<WorkReqMock>() },
+          work_2{ make_shared<WorkReqMock>() }
+    {
+        EXPECT_CALL( *socket, active_() )
+                .WillRepeatedly( Return(true) );
+    }
+
+    virtual ~DownloaderSimpleStage()
+    {
+        EXPECT_LE(work_1.use_count(), 2);
+        EXPECT_LE(work_2.use_count(), 2);
+    }
+
+    shared_ptr<WorkReqMock> work_1;
+    shared_ptr<WorkReqMock> work_2;
+    function< void() > task_1;
+    function< void() > task_2;
+};
+
+TEST_F(DownloaderSimpleStage, processed_in_order_then_written)
+{
+    const size_t chunk_size = 1000;
+    string buff(chunk_size * 2, '\0');
+    auto buff_replace = [&buff](const char* data, size_t length, size_t offset) { buff.replace(offset, length, data, length); };
+
+    // One chunk at the worker, the file waits for it
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task_1), Return(work_1) ) );
+    EXPECT_CALL( *work_1, queue() )
+            .Times(1);
+    EXPECT_CALL( *file, write(_,_,_) )
+            .Times(0);
+
+    socket->publish( ::uvw::DataEvent{unique_ptr<char[]>{ generate_data(chunk_size) }, chunk_size} );
+    file->publish( FileOpenEvent{fname.c_str()} );
+    socket->publish( ::uvw::DataEvent{unique_ptr<char[]>{ generate_data(chunk_size) }, chunk_size} );
+
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( work_1.get() );
+    Mock::VerifyAndClearExpectations( file.get() );
+
+    // First chunk back: written, the second goes to the worker
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task_2), Return(work_2) ) );
+    EXPECT_CALL( *work_2, queue() )
+            .Times(1);
+    EXPECT_CALL( *file, write(_, chunk_size, 0) )
+            .WillOnce( Invoke(buff_replace) );
+
+    task_1();
+    work_1->publish( ::uvw::WorkEvent{} );
+
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( work_2.get() );
+    Mock::VerifyAndClearExpectations( file.get() );
+
+    // Second chunk back while the first is written
+    EXPECT_CALL( *file, write(_, chunk_size, chunk_size) )
+            .WillOnce( Invoke(buff_replace) );
+
+    task_2();
+    work_2->publish( ::uvw::WorkEvent{} );
+    file->publish( FileWriteEvent{fname.c_str(), chunk_size} );
+    file->publish( FileWriteEvent{fname.c_str(), chunk_size} );
+
+    Mock::VerifyAndClearExpectations( file.get() );
+
+    EXPECT_TRUE( input_data == buff );
+    Crc32c crc;
+    crc.update( input_data.data(), input_data.size() );
+    EXPECT_EQ( checksum->hex(), crc.hex() );
+
+    // Cancel download
+    prepare_close_socket_and_timer();
+    prepare_close_unlink_file();
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    downloader->stop();
+
+    check_close_socket_and_timer();
+    check_close_unlink_file();
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
+TEST_F(DownloaderSimpleStage, cancel_work_on_stop)
+{
+    const size_t chunk_size = 1000;
+
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task_1), Return(work_1) ) );
+    EXPECT_CALL( *work_1, queue() )
+            .Times(1);
+
+    socket->publish( ::uvw::DataEvent{unique_ptr<char[]>{ generate_data(chunk_size) }, chunk_size} );
+    socket->publish( ::uvw::DataEvent{unique_ptr<char[]>{ generate_data(chunk_size) }, chunk_size} );
+    file->publish( FileOpenEvent{fname.c_str()} );
+
+    Mock::VerifyAndClearExpectations( loop.get() );
+
+    EXPECT_CALL( *work_1, cancel() )
+            .WillOnce( Return(false) );
+    prepare_close_socket_and_timer();
+    prepare_close_unlink_file();
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    downloader->stop();
+
+    check_close_socket_and_timer();
+    check_close_unlink_file();
+    Mock::VerifyAndClearExpectations( work_1.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    // Completion of the running work is not listened to
+    EXPECT_CALL( *file, write(_,_,_) )
+            .Times(0);
+    task_1();
+    work_1->publish( ::uvw::WorkEvent{} );
+}
+
 /* Complete download */
 
 struct DownloaderSimpleComplete : public DownloaderSimpleQueue
@@ -1763,6 +2332,16 @@ TEST_F(DownloaderSimpleComplete, close_socket_before_file)
     const auto status_2 = downloader->status();
     EXPECT_EQ( status_2.state, StatusDownloader::State::Done );
 
+    // Every phase boundary is stamped, in order
+    const auto& timing = status_2.timing;
+    using TimePoint = StatusDownloader::Timing::Clock::time_point;
+    EXPECT_NE( timing.resolve_start, TimePoint{} );
+    EXPECT_LE( timing.resolve_start, timing.resolve_end );
+    EXPECT_LE( timing.resolve_end, timing.connected );
+    EXPECT_LE( timing.connected, timing.request_written );
+    EXPECT_LE( timing.request_written, timing.first_byte );
+    EXPECT_LE( timing.first_byte, timing.done );
+
     Mock::VerifyAndClearExpectations( socket.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
@@ -1835,3 +2414,61 @@ TEST_F(DownloaderSimpleComplete, file_error)
     Mock::VerifyAndClearExpectations( socket.get() );
     Mock::VerifyAndClearExpectations( on_tick.get() );
 }
+
+using FsRenameEvent = ::uvw::FsEvent<uvw::FsReq::Type::RENAME>;
+
+struct DownloaderSimpleConditionalComplete : public FixtureValidators, public DownloaderSimpleComplete
+{
+    DownloaderSimpleConditionalComplete()
+    {
+        EXPECT_CALL( *socket, close_() )
+                .Times(1);
+
+        socket->publish( ::uvw::ShutdownEvent{} );
+
+        // Part is written in full, the file of the previous run is replaced only now
+        EXPECT_CALL( *loop, resource_FsReqMock() )
+                .WillOnce( Return(fs) );
+        EXPECT_CALL( *fs, rename(file_path, fname) )
+                .Times(1);
+        EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+                .Times(0);
+
+        file->publish( FileCloseEvent{file_path.c_str()} );
+        EXPECT_EQ( downloader->status().state, StatusDownloader::State::OnTheGo );
+
+        Mock::VerifyAndClearExpectations( socket.get() );
+        Mock::VerifyAndClearExpectations( loop.get() );
+        Mock::VerifyAndClearExpectations( fs.get() );
+        Mock::VerifyAndClearExpectations( on_tick.get() );
+    }
+};
+
+TEST_F(DownloaderSimpleConditionalComplete, part_renamed_on_done)
+{
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    fs->publish( FsRenameEvent{fname.c_str()} );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::Done );
+
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
+
+TEST_F(DownloaderSimpleConditionalComplete, rename_failed)
+{
+    auto fs_unlink = make_shared<FsReqMock>();
+    EXPECT_CALL( *loop, resource_FsReqMock() )
+            .WillOnce( Return(fs_unlink) );
+    EXPECT_CALL( *fs_unlink, unlink(file_path) )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .WillOnce( Invoke(on_tick_handler) );
+
+    fs->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_EACCES) } );
+    EXPECT_EQ( downloader->status().state, StatusDownloader::State::Failed );
+
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( fs_unlink.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+}
@@ -0,0 +1,450 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/uvw/loop_mock.h"
+#include "mock/uvw/file_mock.h"
+#include "mock/uvw/work_mock.h"
+#include "mock/factory_mock.h"
+#include "mock/downloader_mock.h"
+#include "mock/dashboard_mock.h"
+#include "mock/object_cache_mock.h"
+#include "mock/validator_store_mock.h"
+#include "mock/on_tick_mock.h"
+
+#include "factory_cached.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::function;
+using ::std::shared_ptr;
+using ::std::make_shared;
+using ::std::move;
+
+using ::testing::_;
+using ::testing::Return;
+using ::testing::ReturnRef;
+using ::testing::SaveArg;
+using ::testing::SetArgReferee;
+using ::testing::DoAll;
+using ::testing::Invoke;
+using ::testing::Mock;
+using ::testing::AnyNumber;
+using ::testing::AllOf;
+using ::testing::Field;
+
+struct AIO_Mock
+{
+    using Loop = LoopMock;
+    using WorkReq = WorkReqMock;
+    using FsReq = FsReqMock;
+};
+
+using State = StatusDownloader::State;
+using Entry = ObjectCache::Entry;
+using Validator = ValidatorStore::Validator;
+
+struct FactoryCachedF : public ::testing::Test
+{
+    FactoryCachedF()
+        : loop{ make_shared<LoopMock>() },
+          inner{ make_shared<FactoryMock>() },
+          cache{ make_shared<ObjectCacheMock>() },
+          validators{ make_shared<ValidatorStoreMock>() },
+          on_tick{ make_shared<OnTickMock>() },
+          work{ make_shared<WorkReqMock>() },
+          uri{"http://internet.org/file.zip"},
+          fname{"file.zip"}
+    {
+        entry.hash = string(64, 'a');
+        entry.validator = Validator{"\"v1\"", "", 42};
+
+        EXPECT_CALL( *inner, set_OnTick(_) )
+                .WillOnce( SaveArg<0>(&relay) );
+        EXPECT_CALL( dashboard, update(_,_) )
+                .Times( AnyNumber() );
+        factory = make_shared< FactoryCached<AIO_Mock> >(loop, dashboard, inner, cache, validators);
+        factory->set_OnTick(on_tick);
+        Mock::VerifyAndClearExpectations( inner.get() );
+    }
+
+    virtual ~FactoryCachedF()
+    {
+        EXPECT_LE( work.use_count(), 2 );
+    }
+
+    // Cache hit, the work restoring the file is queued
+    shared_ptr<Downloader> create_cached()
+    {
+        EXPECT_CALL( *cache, find(uri, _) )
+                .WillOnce( DoAll( SetArgReferee<1>(entry), Return(true) ) );
+        EXPECT_CALL( *validators, find(uri, _) )
+                .WillOnce( DoAll( SetArgReferee<1>(entry.validator), Return(true) ) );
+        EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+                .WillOnce( DoAll( SaveArg<0>(&task), Return(work) ) );
+        EXPECT_CALL( *work, queue() )
+                .Times(1);
+        EXPECT_CALL( *inner, create(_,_,_) )
+                .Times(0);
+
+        auto downloader = factory->create(1, uri, fname);
+        EXPECT_NE( downloader, nullptr );
+        EXPECT_EQ( downloader->status().state, State::OnTheGo );
+
+        Mock::VerifyAndClearExpectations( cache.get() );
+        Mock::VerifyAndClearExpectations( validators.get() );
+        Mock::VerifyAndClearExpectations( loop.get() );
+        Mock::VerifyAndClearExpectations( work.get() );
+        Mock::VerifyAndClearExpectations( inner.get() );
+        return downloader;
+    }
+
+    shared_ptr<LoopMock> loop;
+    ::testing::NiceMock<DashboardMock> dashboard;
+    shared_ptr<FactoryMock> inner;
+    shared_ptr<ObjectCacheMock> cache;
+    shared_ptr<ValidatorStoreMock> validators;
+    shared_ptr<OnTickMock> on_tick;
+    shared_ptr<WorkReqMock> work;
+    shared_ptr<OnTick> relay;
+    shared_ptr< FactoryCached<AIO_Mock> > factory;
+
+    const string uri;
+    const string fname;
+    Entry entry;
+    function<void()> task;
+};
+
+TEST_F(FactoryCachedF, restored_from_cache)
+{
+    auto downloader = create_cached();
+
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Return(true) );
+    task();
+
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+
+    EXPECT_EQ( downloader->status().state, State::Done );
+    EXPECT_EQ( downloader->status().size, 42u );
+}
+
+TEST_F(FactoryCachedF, existing_output_bypasses_cache)
+{
+    auto downloader = create_cached();
+
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Invoke( [](const Entry&, const string&) { errno = EEXIST; return false; } ) );
+    task();
+
+    // The entry is kept, the job is redirected to the network
+    EXPECT_CALL( *cache, forget(_) )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+
+    EXPECT_EQ( downloader->status().state, State::Redirect );
+    EXPECT_EQ( downloader->status().redirect_uri, uri );
+    Mock::VerifyAndClearExpectations( cache.get() );
+
+    auto network = make_shared<DownloaderMock>();
+    EXPECT_CALL( *cache, find(_,_) )
+            .Times(0);
+    EXPECT_CALL( *inner, create(1, uri, fname) )
+            .WillOnce( Return(network) );
+    EXPECT_EQ( factory->create(1, uri, fname), network );
+    Mock::VerifyAndClearExpectations( inner.get() );
+    Mock::VerifyAndClearExpectations( cache.get() );
+
+    // Bypassed once, the next job for the file looks into the cache again
+    EXPECT_CALL( *cache, find(uri, _) )
+            .WillOnce( Return(false) );
+    EXPECT_CALL( *inner, create(1, uri, fname) )
+            .WillOnce( Return(network) );
+    factory->create(1, uri, fname);
+}
+
+TEST_F(FactoryCachedF, restore_failed_forgets_entry)
+{
+    auto downloader = create_cached();
+
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Invoke( [](const Entry&, const string&) { errno = ENOSPC; return false; } ) );
+    task();
+
+    EXPECT_CALL( *cache, forget(uri) )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+
+    EXPECT_EQ( downloader->status().state, State::Redirect );
+    EXPECT_EQ( downloader->status().redirect_uri, uri );
+}
+
+TEST_F(FactoryCachedF, stop_during_restore_unlinks_file)
+{
+    auto downloader = create_cached();
+
+    EXPECT_CALL( *work, cancel() )
+            .WillOnce( Return(false) );
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    downloader->stop();
+    EXPECT_EQ( downloader->status().state, State::Failed );
+    EXPECT_EQ( downloader->status().error, StatusDownloader::Error::Abort );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    // The work was running already, the file it made was never reported
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Return(true) );
+    task();
+
+    auto fs = make_shared<FsReqMock>();
+    EXPECT_CALL( *loop, resource_FsReqMock() )
+            .WillOnce( Return(fs) );
+    EXPECT_CALL( *fs, unlink(fname) )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_(_) )
+            .Times(0);
+    work->publish( ::uvw::WorkEvent{} );
+}
+
+struct FactoryCachedDigestFile : public FactoryCachedF
+{
+    FactoryCachedDigestFile()
+        : sidecar{fname + ".crc32c"}
+    {
+        EXPECT_CALL( *inner, set_OnTick(_) )
+                .Times(1);
+        factory = make_shared< FactoryCached<AIO_Mock> >(loop, dashboard, inner, cache, validators, "crc32c");
+        factory->set_OnTick(on_tick);
+        Mock::VerifyAndClearExpectations( inner.get() );
+    }
+
+    virtual ~FactoryCachedDigestFile()
+    {
+        std::remove( fname.c_str() );
+        std::remove( sidecar.c_str() );
+    }
+
+    const string sidecar;
+};
+
+TEST_F(FactoryCachedDigestFile, written_on_hit)
+{
+    auto downloader = create_cached();
+
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Invoke( [](const Entry&, const string& path) { std::ofstream{path} << "content"; return true; } ) );
+    task();
+
+    Crc32c crc;
+    crc.update("content", 7);
+    std::ifstream stream{sidecar};
+    string line;
+    std::getline(stream, line);
+    EXPECT_EQ( line, crc.hex() + "  " + fname );
+
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+    EXPECT_EQ( downloader->status().state, State::Done );
+}
+
+TEST_F(FactoryCachedDigestFile, not_written_fails_job)
+{
+    auto downloader = create_cached();
+
+    // Restored file gone before it is read
+    EXPECT_CALL( *cache, restore(_, fname) )
+            .WillOnce( Return(true) );
+    task();
+
+    EXPECT_CALL( *on_tick, invoke_( downloader.get() ) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+    EXPECT_EQ( downloader->status().state, State::Failed );
+    EXPECT_EQ( downloader->status().error, StatusDownloader::Error::FileWrite );
+}
+
+TEST_F(FactoryCachedF, validators_disagree)
+{
+    Validator changed = entry.validator;
+    changed.etag = "\"v2\"";
+    EXPECT_CALL( *cache, find(uri, _) )
+            .WillOnce( DoAll( SetArgReferee<1>(entry), Return(true) ) );
+    EXPECT_CALL( *validators, find(uri, _) )
+            .WillOnce( DoAll( SetArgReferee<1>(changed), Return(true) ) );
+    EXPECT_CALL( *cache, forget(uri) )
+            .Times(1);
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+
+    auto network = make_shared<DownloaderMock>();
+    EXPECT_CALL( *inner, create(1, uri, fname) )
+            .WillOnce( Return(network) );
+    EXPECT_EQ( factory->create(1, uri, fname), network );
+}
+
+TEST_F(FactoryCachedF, digest_of_other_content)
+{
+    EXPECT_CALL( *cache, find(uri, _) )
+            .WillOnce( DoAll( SetArgReferee<1>(entry), Return(true) ) );
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+
+    auto network = make_shared<DownloaderMock>();
+    EXPECT_CALL( *inner, create(1, uri, fname) )
+            .WillOnce( Return(network) );
+    EXPECT_EQ( factory->create(1, uri, fname, "sha256:" + string(64, 'b')), network );
+}
+
+struct FactoryCachedIngest : public FactoryCachedF
+{
+    FactoryCachedIngest()
+        : network{ make_shared<DownloaderMock>() }
+    {
+        EXPECT_CALL( *cache, find(uri, _) )
+                .WillOnce( Return(false) );
+        EXPECT_CALL( *inner, create(1, uri, fname) )
+                .WillOnce( Return(network) );
+        EXPECT_EQ( factory->create(1, uri, fname), network );
+        Mock::VerifyAndClearExpectations( cache.get() );
+        Mock::VerifyAndClearExpectations( inner.get() );
+
+        EXPECT_CALL( *network, status() )
+                .WillRepeatedly( ReturnRef(status) );
+    }
+
+    shared_ptr<DownloaderMock> network;
+    StatusDownloader status;
+};
+
+TEST_F(FactoryCachedIngest, done_download_stored)
+{
+    // Progress goes through the relay untouched
+    status.state = State::OnTheGo;
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( network.get() ) )
+            .Times(1);
+    relay->invoke(network);
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    status.state = State::Done;
+    status.http_status = 200;
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task), Return(work) ) );
+    EXPECT_CALL( *work, queue() )
+            .Times(1);
+    EXPECT_CALL( *on_tick, invoke_( network.get() ) )
+            .Times(1);
+    relay->invoke(network);
+    Mock::VerifyAndClearExpectations( loop.get() );
+    Mock::VerifyAndClearExpectations( on_tick.get() );
+
+    Entry stored;
+    stored.hash = entry.hash;
+    stored.validator.size = 42;
+    EXPECT_CALL( *cache, store(fname, _) )
+            .WillOnce( DoAll( SetArgReferee<1>(stored), Return(true) ) );
+    task();
+
+    // Validators of the response go with the object
+    EXPECT_CALL( *validators, find(uri, _) )
+            .WillOnce( DoAll( SetArgReferee<1>(entry.validator), Return(true) ) );
+    EXPECT_CALL( *cache, insert(uri, AllOf( Field(&Entry::hash, entry.hash),
+                                            Field(&Entry::validator, Field(&Validator::etag, "\"v1\"")) )) )
+            .Times(1);
+    work->publish( ::uvw::WorkEvent{} );
+
+    // Reported once
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( network.get() ) )
+            .Times(1);
+    relay->invoke(network);
+}
+
+TEST_F(FactoryCachedIngest, failed_download_not_stored)
+{
+    status.state = State::Failed;
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( network.get() ) )
+            .Times(1);
+    relay->invoke(network);
+}
+
+TEST_F(FactoryCachedIngest, not_modified_cached_not_stored)
+{
+    status.state = State::Done;
+    status.http_status = 304;
+    EXPECT_CALL( *cache, find(uri, _) )
+            .WillOnce( Return(true) );
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+    EXPECT_CALL( *on_tick, invoke_( network.get() ) )
+            .Times(1);
+    relay->invoke(network);
+}
+
+TEST_F(FactoryCachedF, ingests_limited)
+{
+    shared_ptr<DownloaderMock> network[3];
+    StatusDownloader status;
+    status.state = State::Done;
+    status.http_status = 200;
+    EXPECT_CALL( *cache, find(_,_) )
+            .WillRepeatedly( Return(false) );
+    for (size_t i = 0; i < 3; i++)
+    {
+        network[i] = make_shared<DownloaderMock>();
+        EXPECT_CALL( *network[i], status() )
+                .WillRepeatedly( ReturnRef(status) );
+        EXPECT_CALL( *inner, create(i, uri, fname + std::to_string(i)) )
+                .WillOnce( Return(network[i]) );
+        factory->create(i, uri, fname + std::to_string(i));
+    }
+    EXPECT_CALL( *on_tick, invoke_(_) )
+            .Times(3);
+
+    // Two on the threadpool, the third waits for one of them
+    auto work_2 = make_shared<WorkReqMock>();
+    auto work_3 = make_shared<WorkReqMock>();
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( Return(work) )
+            .WillOnce( Return(work_2) );
+    EXPECT_CALL( *work, queue() )
+            .Times(1);
+    EXPECT_CALL( *work_2, queue() )
+            .Times(1);
+    for (const auto& downloader : network)
+        relay->invoke(downloader);
+    Mock::VerifyAndClearExpectations( loop.get() );
+
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .WillOnce( DoAll( SaveArg<0>(&task), Return(work_3) ) );
+    EXPECT_CALL( *work_3, queue() )
+            .Times(1);
+    work_2->publish( ::uvw::ErrorEvent{ static_cast<int>(UV_ECANCELED) } );
+    Mock::VerifyAndClearExpectations( loop.get() );
+
+    EXPECT_CALL( *cache, store(fname + "2", _) )
+            .WillOnce( Return(false) );
+    task();
+    EXPECT_CALL( *loop, resource_WorkReqMock(_) )
+            .Times(0);
+    EXPECT_CALL( *cache, insert(_,_) )
+            .Times(0);
+    work_3->publish( ::uvw::WorkEvent{} );
+    work->publish( ::uvw::WorkEvent{} );
+}
@@ -37,7 +37,80 @@ TEST(response_parse, normal)
 
     ASSERT_EQ(result.state, State::Done);
     ASSERT_EQ(result.content_length, content_length);
+    ASSERT_EQ(result.http_status, 200u);
     ASSERT_EQ(body, buff_body);
+    ASSERT_EQ(result.etag, "\"58c2fb69-c\"");
+    ASSERT_TRUE( result.last_modified.empty() );
+}
+
+TEST(response_parse, not_modified_304)
+{
+    const string buff = ""
+            "HTTP/1.1 304 Not Modified\r\n"
+            "Server: nginx/1.6.2\r\n"
+            "etag: \"58c2fb69-c\"\r\n"
+            "last-modified: Fri, 10 Mar 2017 19:20:09 GMT\r\n"
+            "\r\n";
+
+    auto instance = HttpParser::create( [](unique_ptr<char[]>, size_t) { FAIL() << "Should not be invoke callback!"; } );
+    ASSERT_TRUE(instance);
+
+    char* const raw_ptr = new char[ buff.size() ];
+    copy(begin(buff), end(buff), raw_ptr);
+    const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr}, buff.size() );
+
+    ASSERT_EQ(result.state, State::Done);
+    ASSERT_EQ(result.http_status, 304u);
+    ASSERT_EQ(result.content_length, 0u);
+    ASSERT_EQ(result.etag, "\"58c2fb69-c\"");
+    ASSERT_EQ(result.last_modified, "Fri, 10 Mar 2017 19:20:09 GMT");
+}
+
+TEST(response_parse, partial_content_206)
+{
+    const string buff = ""
+            "HTTP/1.1 206 Partial Content\r\n"
+            "Content-Length: 4\r\n"
+            "Content-Range: bytes 20-23/24\r\n"
+            "ETag: \"58c2fb69-c\"\r\n"
+            "\r\n"
+            "llo!";
+
+    string body;
+    auto instance = HttpParser::create( [&body](unique_ptr<char[]> data, size_t length) { body.append(data.get(), length); } );
+    ASSERT_TRUE(instance);
+
+    char* const raw_ptr = new char[ buff.size() ];
+    copy(begin(buff), end(buff), raw_ptr);
+    const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr}, buff.size() );
+
+    ASSERT_EQ(result.state, State::Done);
+    ASSERT_EQ(result.http_status, 206u);
+    ASSERT_TRUE(result.headers_complete);
+    ASSERT_TRUE(result.content_range);
+    ASSERT_EQ(result.range_start, 20u);
+    ASSERT_EQ(result.range_total, 24u);
+    ASSERT_EQ(body, "llo!");
+}
+
+TEST(response_parse, partial_content_206_malformed_range)
+{
+    for (const string range : {"bytes 20-23", "bytes 23-20/24", "bytes 20-24/24", "items 20-23/24"})
+    {
+        const string buff = ""
+                "HTTP/1.1 206 Partial Content\r\n"
+                "Content-Length: 0\r\n"
+                "Content-Range: " + range + "\r\n"
+                "\r\n";
+
+        auto instance = HttpParser::create( [](unique_ptr<char[]>, size_t) {} );
+        char* const raw_ptr = new char[ buff.size() ];
+        copy(begin(buff), end(buff), raw_ptr);
+        const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr}, buff.size() );
+
+        EXPECT_TRUE(result.headers_complete);
+        EXPECT_FALSE(result.content_range) << range;
+    }
 }
 
 TEST(response_parse, not_found_404)
@@ -61,6 +134,7 @@ TEST(response_parse, not_found_404)
     const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr}, buff.size() );
 
     ASSERT_EQ(result.state, State::Error);
+    ASSERT_EQ(result.http_status, 404u);
     cout << "result.err_str => " << result.err_str << endl;
 }
 
@@ -89,6 +163,53 @@ TEST(response_parse, redirect_301)
 
     ASSERT_EQ(result.state, State::Redirect);
     ASSERT_EQ(result.redirect_uri, redirect_uri);
+    ASSERT_TRUE(result.keep_alive);
+}
+
+TEST(response_parse, redirect_308_body_pending)
+{
+    const string buff1 = ""
+            "HTTP/1.1 308 Permanent Redirect\r\n"
+            "Location: /redirect\r\n"
+            "Content-Length: 10\r\n"
+            "\r\n"
+            "Moved";
+    const string buff2 = "Moved";
+
+    auto instance = HttpParser::create( [](unique_ptr<char[]>, size_t) { FAIL() << "Should not be invoke callback!"; } );
+    ASSERT_TRUE(instance);
+
+    char* const raw_ptr1 = new char[ buff1.size() ];
+    copy(begin(buff1), end(buff1), raw_ptr1);
+    ASSERT_EQ( instance->response_parse( unique_ptr<char[]>{raw_ptr1}, buff1.size() ).state, State::InProgress );
+
+    char* const raw_ptr2 = new char[ buff2.size() ];
+    copy(begin(buff2), end(buff2), raw_ptr2);
+    const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr2}, buff2.size() );
+    ASSERT_EQ(result.state, State::Redirect);
+    ASSERT_EQ(result.http_status, 308u);
+    ASSERT_EQ(result.redirect_uri, "/redirect");
+    ASSERT_TRUE(result.keep_alive);
+}
+
+TEST(response_parse, redirect_307_connection_close)
+{
+    const string buff = ""
+            "HTTP/1.1 307 Temporary Redirect\r\n"
+            "Location: http://www.example.org/redirect\r\n"
+            "Connection: close\r\n"
+            "\r\n";
+
+    auto instance = HttpParser::create( [](unique_ptr<char[]>, size_t) { FAIL() << "Should not be invoke callback!"; } );
+    ASSERT_TRUE(instance);
+
+    char* const raw_ptr = new char[ buff.size() ];
+    copy(begin(buff), end(buff), raw_ptr);
+    const auto result = instance->response_parse( unique_ptr<char[]>{raw_ptr}, buff.size() );
+
+    ASSERT_EQ(result.state, State::Redirect);
+    ASSERT_EQ(result.redirect_uri, "http://www.example.org/redirect");
+    ASSERT_FALSE(result.keep_alive);
 }
 
 TEST(response_parse, error_redirect_without_location)
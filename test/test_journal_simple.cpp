@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include "journal_simple.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::ofstream;
+using ::std::stringstream;
+using ::std::chrono::milliseconds;
+
+struct JournalSimpleF : public ::testing::Test
+{
+    JournalSimpleF()
+        : fname{"test_journal_simple.log"}
+    {
+        std::remove( fname.c_str() );
+    }
+
+    virtual ~JournalSimpleF()
+    {
+        std::remove( fname.c_str() );
+    }
+
+    string content() const
+    {
+        ifstream stream{fname};
+        stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+
+    const string fname;
+};
+
+TEST_F(JournalSimpleF, record_and_restart)
+{
+    {
+        JournalSimple journal{fname};
+        EXPECT_FALSE( journal.completed(1) );
+
+        journal.record(1, true);
+        journal.record(5, false);
+        journal.record(100000, true);
+        EXPECT_TRUE( journal.completed(1) );
+        EXPECT_FALSE( journal.completed(5) );
+        EXPECT_TRUE( journal.completed(100000) );
+    }
+    EXPECT_EQ( content(), "1 D\n5 F\n100000 D\n" );
+
+    JournalSimple journal{fname};
+    EXPECT_EQ( journal.loaded(), 2u );
+    EXPECT_TRUE( journal.completed(1) );
+    EXPECT_FALSE( journal.completed(2) );
+    EXPECT_FALSE( journal.completed(5) );
+    EXPECT_TRUE( journal.completed(100000) );
+    EXPECT_FALSE( journal.completed(100001) );
+
+    journal.record(5, true);
+    journal.flush();
+    EXPECT_EQ( content(), "1 D\n5 F\n100000 D\n5 D\n" );
+}
+
+TEST_F(JournalSimpleF, batch)
+{
+    JournalSimple journal{fname, 2, milliseconds{60000} };
+
+    journal.record(1, true);
+    EXPECT_EQ( content(), "" );
+    journal.record(2, true);
+    EXPECT_EQ( content(), "1 D\n2 D\n" );
+}
+
+TEST_F(JournalSimpleF, cut_torn_record)
+{
+    {
+        ofstream stream{fname};
+        stream << "1 D\n" << "garbage\n" << "3 D\n" << "42";
+    }
+
+    {
+        JournalSimple journal{fname};
+        EXPECT_EQ( journal.loaded(), 2u );
+        EXPECT_TRUE( journal.completed(1) );
+        EXPECT_TRUE( journal.completed(3) );
+        EXPECT_FALSE( journal.completed(42) );
+
+        journal.record(4, true);
+    }
+    EXPECT_EQ( content(), "1 D\ngarbage\n3 D\n4 D\n" );
+
+    JournalSimple journal{fname};
+    EXPECT_EQ( journal.loaded(), 3u );
+    EXPECT_TRUE( journal.completed(4) );
+}
+
+TEST_F(JournalSimpleF, owner_writes)
+{
+    JournalSimple journal{fname, 2, milliseconds{0} };
+    std::size_t due = 0;
+    journal.set_OnDue( [&due]() { due++; } );
+
+    // Neither batch nor interval writes by itself
+    journal.record(1, true);
+    EXPECT_EQ( due, 0u );
+    journal.record(2, false);
+    EXPECT_EQ( due, 1u );
+    EXPECT_EQ( content(), "" );
+
+    const auto data = journal.take();
+    EXPECT_EQ( data, "1 D\n2 F\n" );
+    EXPECT_TRUE( journal.take().empty() );
+    EXPECT_TRUE( journal.write(data) );
+    EXPECT_EQ( content(), "1 D\n2 F\n" );
+
+    // A failed write is retried before later records
+    journal.record(3, true);
+    auto failed = journal.take();
+    journal.record(4, true);
+    journal.put_back( std::move(failed) );
+    EXPECT_EQ( due, 1u );
+    journal.record(5, true);
+    EXPECT_EQ( due, 2u );
+    EXPECT_EQ( journal.take(), "3 D\n4 D\n5 D\n" );
+}
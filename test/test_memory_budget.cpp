@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/aio/memory_consumer_mock.h"
+
+#include "aio/memory_budget.h"
+#include "metrics.h"
+
+using ::aio::memory::Consumer;
+using ::aio::memory::ConsumerMock;
+using ::aio::memory::BudgetSimple;
+
+using ::std::size_t;
+using ::std::shared_ptr;
+using ::std::make_shared;
+
+using ::testing::Return;
+using ::testing::Mock;
+using ::testing::NiceMock;
+
+struct memory_BudgetSimpleF : public ::testing::Test
+{
+    memory_BudgetSimpleF()
+        : limit{8000},
+          budget{ make_shared<BudgetSimple>(limit) },
+          heavy{ make_shared<ConsumerMock>() },
+          light{ make_shared<ConsumerMock>() }
+    {
+        budget->add_consumer(heavy);
+        budget->add_consumer(light);
+    }
+
+    const size_t limit;
+    shared_ptr<BudgetSimple> budget;
+    shared_ptr<ConsumerMock> heavy;
+    shared_ptr<ConsumerMock> light;
+};
+
+TEST_F(memory_BudgetSimpleF, below_limit)
+{
+    EXPECT_CALL( *heavy, throttle() ).Times(0);
+    EXPECT_CALL( *light, throttle() ).Times(0);
+
+    budget->acquire(limit);
+    EXPECT_EQ( budget->used(), limit );
+    EXPECT_EQ( budget->peak(), limit );
+
+    budget->release(limit / 2);
+    EXPECT_EQ( budget->used(), limit / 2 );
+    EXPECT_EQ( budget->peak(), limit );
+
+    const auto& counters = metrics::registry();
+    EXPECT_EQ( counters.memory_used.value(), static_cast<std::int64_t>(limit / 2) );
+    EXPECT_EQ( counters.memory_peak.value(), static_cast<std::int64_t>(limit) );
+    EXPECT_EQ( counters.memory_limit.value(), static_cast<std::int64_t>(limit) );
+}
+
+TEST_F(memory_BudgetSimpleF, throttle_heaviest)
+{
+    budget->acquire(limit);
+
+    EXPECT_CALL( *heavy, buffered_() ).WillRepeatedly( Return(limit) );
+    EXPECT_CALL( *light, buffered_() ).WillRepeatedly( Return(1) );
+    EXPECT_CALL( *heavy, throttle() ).Times(1);
+    EXPECT_CALL( *light, throttle() ).Times(0);
+    budget->acquire(1);
+    Mock::VerifyAndClearExpectations( heavy.get() );
+    Mock::VerifyAndClearExpectations( light.get() );
+
+    // Hysteresis: no repeated throttle on every chunk
+    EXPECT_CALL( *heavy, throttle() ).Times(0);
+    EXPECT_CALL( *light, throttle() ).Times(0);
+    budget->acquire(1);
+    Mock::VerifyAndClearExpectations( heavy.get() );
+    Mock::VerifyAndClearExpectations( light.get() );
+
+    // Release above low watermark
+    EXPECT_CALL( *heavy, unthrottle() ).Times(0);
+    EXPECT_CALL( *light, unthrottle() ).Times(0);
+    budget->release(limit / 8);
+    Mock::VerifyAndClearExpectations( heavy.get() );
+    Mock::VerifyAndClearExpectations( light.get() );
+
+    EXPECT_CALL( *heavy, unthrottle() ).Times(1);
+    EXPECT_CALL( *light, unthrottle() ).Times(1);
+    budget->release(limit / 8 + 2);
+    Mock::VerifyAndClearExpectations( heavy.get() );
+    Mock::VerifyAndClearExpectations( light.get() );
+
+    EXPECT_EQ( budget->peak(), limit + 2 );
+}
+
+TEST_F(memory_BudgetSimpleF, throttle_several)
+{
+    budget->acquire(limit);
+
+    EXPECT_CALL( *heavy, buffered_() ).WillRepeatedly( Return(limit / 8) );
+    EXPECT_CALL( *light, buffered_() ).WillRepeatedly( Return(limit / 8) );
+    EXPECT_CALL( *heavy, throttle() ).Times(1);
+    EXPECT_CALL( *light, throttle() ).Times(1);
+    budget->acquire(1);
+}
+
+TEST_F(memory_BudgetSimpleF, remove_consumer)
+{
+    auto consumer = make_shared<ConsumerMock>();
+    auto conn = budget->add_consumer(consumer);
+    budget->remove_consumer(conn);
+
+    EXPECT_CALL( *heavy, buffered_() ).WillRepeatedly( Return(limit) );
+    EXPECT_CALL( *light, buffered_() ).WillRepeatedly( Return(0) );
+    EXPECT_CALL( *consumer, buffered_() ).Times(0);
+    EXPECT_CALL( *consumer, throttle() ).Times(0);
+    EXPECT_CALL( *heavy, throttle() ).Times(1);
+    budget->acquire(limit + 1);
+}
+
+TEST_F(memory_BudgetSimpleF, remove_without_pressure)
+{
+    for (int i = 0; i < 100; i++)
+    {
+        auto consumer = make_shared<ConsumerMock>();
+        budget->remove_consumer( budget->add_consumer(consumer) );
+    }
+    EXPECT_EQ( budget->consumers_count(), 2 );
+}
+
+TEST_F(memory_BudgetSimpleF, expired_consumer)
+{
+    light.reset();
+
+    EXPECT_CALL( *heavy, buffered_() ).WillRepeatedly( Return(limit) );
+    EXPECT_CALL( *heavy, throttle() ).Times(1);
+    budget->acquire(limit + 1);
+
+    EXPECT_CALL( *heavy, unthrottle() ).Times(1);
+    budget->release(limit + 1);
+    EXPECT_EQ( budget->used(), 0 );
+}
+
+TEST(memory_BudgetSimple, add_expired)
+{
+    auto budget = make_shared<BudgetSimple>(42);
+    auto consumer = make_shared< NiceMock<ConsumerMock> >();
+    std::weak_ptr<Consumer> weak = consumer;
+    consumer.reset();
+
+    auto conn = budget->add_consumer(weak);
+    budget->remove_consumer(conn);
+    budget->acquire(84);
+    budget->release(84);
+    EXPECT_EQ( budget->peak(), 84 );
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "metrics_server.h"
+
+#include <sstream>
+
+using ::std::string;
+using ::std::chrono::milliseconds;
+
+using namespace metrics;
+
+TEST(Metrics, latency_histogram_index)
+{
+    using H = LatencyHistogram;
+    EXPECT_EQ( H::index(0), 0u );
+    EXPECT_EQ( H::index(127), 127u );
+    EXPECT_EQ( H::index(128), 128u );
+    EXPECT_EQ( H::index(129), 128u );
+    EXPECT_EQ( H::index(130), 129u );
+    EXPECT_EQ( H::highest_equivalent(128), 129u );
+    EXPECT_EQ( H::index( (std::uint64_t{1} << 37) - 1 ), H::bucket_count - 1 );
+
+    // Bucket bounds are contiguous and relative error stays below 1/64
+    for (std::size_t i = 1; i < H::bucket_count; i++)
+    {
+        const auto low = H::highest_equivalent(i - 1) + 1;
+        const auto high = H::highest_equivalent(i);
+        ASSERT_EQ( H::index(low), i );
+        ASSERT_EQ( H::index(high), i );
+        ASSERT_LE( (high - low) * 64, high );
+    }
+}
+
+TEST(Metrics, latency_histogram_percentile)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ( histogram.percentile(0.5), 0u );
+
+    for (int i = 1; i <= 1000; i++)
+        histogram.record( std::chrono::microseconds{i * 1000} );
+    histogram.record( std::chrono::microseconds{-5} );
+
+    EXPECT_EQ( histogram.count(), 1001u );
+    const auto p50 = histogram.percentile(0.5);
+    const auto p99 = histogram.percentile(0.99);
+    const auto p999 = histogram.percentile(0.999);
+    EXPECT_NEAR( static_cast<double>(p50), 500000.0, 500000.0 / 64 );
+    EXPECT_NEAR( static_cast<double>(p99), 990000.0, 990000.0 / 64 );
+    EXPECT_NEAR( static_cast<double>(p999), 999000.0, 999000.0 / 64 );
+    EXPECT_GE( histogram.percentile(1.0), 1000000u );
+}
+
+TEST(Metrics, prometheus_format)
+{
+    Registry registry;
+    registry.bytes_downloaded.add(1024);
+    registry.jobs_done.add(3);
+    registry.jobs_running.add(2);
+    registry.jobs_running.sub();
+    registry.connect_latency.record( milliseconds{30} );
+    registry.connect_latency.record( milliseconds{1500} );
+
+    std::ostringstream out;
+    write_prometheus(out, registry);
+    const auto text = out.str();
+
+    EXPECT_NE( text.find("# TYPE downloader_bytes_total counter\ndownloader_bytes_total 1024\n"), string::npos );
+    EXPECT_NE( text.find("downloader_jobs_total{state=\"done\"} 3\n"), string::npos );
+    EXPECT_NE( text.find("downloader_jobs_running 1\n"), string::npos );
+    EXPECT_NE( text.find("# TYPE downloader_connect_seconds summary\n"), string::npos );
+    EXPECT_NE( text.find("downloader_connect_seconds{quantile=\"0.5\"} 0.030"), string::npos );
+    EXPECT_NE( text.find("downloader_connect_seconds{quantile=\"0.99\"} 1.5"), string::npos );
+    EXPECT_NE( text.find("downloader_connect_seconds_sum 1.530000\n"), string::npos );
+    EXPECT_NE( text.find("downloader_connect_seconds_count 2\n"), string::npos );
+}
+
+TEST(Metrics, latency_summary)
+{
+    Registry registry;
+    registry.ttfb_latency.record( milliseconds{20} );
+
+    std::ostringstream out;
+    write_latency_summary(out, registry);
+    const auto text = out.str();
+
+    EXPECT_NE( text.find("p50"), string::npos );
+    EXPECT_NE( text.find("p999"), string::npos );
+    EXPECT_NE( text.find("ttfb            20.2      20.2      20.2         1\n"), string::npos );
+    EXPECT_NE( text.find("resolve          0.0       0.0       0.0         0\n"), string::npos );
+}
+
+TEST(Metrics, http_response)
+{
+    Registry registry;
+    registry.bytes_downloaded.add(42);
+
+    const auto ok = http_response("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n", registry);
+    EXPECT_EQ( ok.compare(0, 17, "HTTP/1.0 200 OK\r\n"), 0 );
+    EXPECT_NE( ok.find("version=0.0.4"), string::npos );
+    EXPECT_NE( ok.find("\r\n\r\n# HELP"), string::npos );
+    EXPECT_NE( ok.find("downloader_bytes_total 42\n"), string::npos );
+
+    const auto body_pos = ok.find("\r\n\r\n") + 4;
+    const auto length_pos = ok.find("Content-Length: ") + 16;
+    EXPECT_EQ( std::stoul( ok.substr(length_pos) ), ok.size() - body_pos );
+
+    EXPECT_EQ( http_response("GET /metrics?x=1 HTTP/1.1\r\n\r\n", registry).compare(0, 15, "HTTP/1.0 200 OK"), 0 );
+    EXPECT_EQ( http_response("GET / HTTP/1.1\r\n\r\n", registry).compare(0, 22, "HTTP/1.0 404 Not Found"), 0 );
+    EXPECT_EQ( http_response("POST /metrics HTTP/1.1\r\n\r\n", registry).compare(0, 12, "HTTP/1.0 405"), 0 );
+    EXPECT_EQ( http_response("garbage", registry).compare(0, 12, "HTTP/1.0 405"), 0 );
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include "object_cache_simple.h"
+#include "sha256.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::ofstream;
+using ::std::stringstream;
+
+using Entry = ObjectCache::Entry;
+
+struct ObjectCacheSimpleF : public ::testing::Test
+{
+    ObjectCacheSimpleF()
+        : dir{"test_object_cache_simple.dir"},
+          input{"test_object_cache_simple.in"},
+          output{"test_object_cache_simple.out"}
+    {
+        clean();
+    }
+
+    virtual ~ObjectCacheSimpleF()
+    {
+        clean();
+    }
+
+    void clean() const
+    {
+        ::nftw( dir.c_str(), [](const char* path, const struct stat*, int, struct FTW*) { return std::remove(path); }, 8, FTW_DEPTH | FTW_PHYS );
+        std::remove( input.c_str() );
+        std::remove( output.c_str() );
+    }
+
+    static void write(const string& fname, const string& data)
+    {
+        ofstream stream{fname, std::ios::trunc};
+        stream << data;
+    }
+
+    static string read(const string& fname)
+    {
+        ifstream stream{fname};
+        stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+
+    static string sha256(const string& data)
+    {
+        Sha256 hash;
+        hash.update( data.data(), data.size() );
+        return hash.hex();
+    }
+
+    void put(ObjectCacheSimple& cache, const string& uri, const string& data) const
+    {
+        write(input, data);
+        Entry entry;
+        ASSERT_TRUE( cache.store(input, entry) );
+        cache.insert(uri, entry);
+    }
+
+    bool exists(const string& hash) const
+    {
+        struct stat st;
+        return ::stat( (dir + "/objects/" + hash).c_str(), &st ) == 0;
+    }
+
+    const string dir;
+    const string input;
+    const string output;
+};
+
+TEST_F(ObjectCacheSimpleF, store_restore_and_restart)
+{
+    {
+        ObjectCacheSimple cache{dir, 1024};
+        Entry entry;
+        EXPECT_FALSE( cache.find("http://a/1", entry) );
+
+        write(input, "cached body");
+        ASSERT_TRUE( cache.store(input, entry) );
+        EXPECT_EQ( entry.hash, sha256("cached body") );
+        EXPECT_EQ( entry.validator.size, 11u );
+        entry.validator.etag = "\"1\"";
+        cache.insert("http://a/1", entry);
+        EXPECT_EQ( cache.used(), 11u );
+    }
+
+    ObjectCacheSimple cache{dir, 1024};
+    EXPECT_EQ( cache.loaded(), 1u );
+    EXPECT_EQ( cache.used(), 11u );
+    Entry entry;
+    ASSERT_TRUE( cache.find("http://a/1", entry) );
+    EXPECT_EQ( entry.hash, sha256("cached body") );
+    EXPECT_EQ( entry.validator.etag, "\"1\"" );
+
+    ASSERT_TRUE( cache.restore(entry, output) );
+    EXPECT_EQ( read(output), "cached body" );
+    // Existing file is never overwritten
+    write(output, "other");
+    EXPECT_FALSE( cache.restore(entry, output) );
+    EXPECT_EQ( read(output), "other" );
+}
+
+TEST_F(ObjectCacheSimpleF, same_content_stored_once)
+{
+    ObjectCacheSimple cache{dir, 1024};
+    put(cache, "http://a/1", "0123456789");
+    put(cache, "http://b/1", "0123456789");
+    EXPECT_EQ( cache.used(), 10u );
+
+    Entry entry_1, entry_2;
+    ASSERT_TRUE( cache.find("http://a/1", entry_1) );
+    ASSERT_TRUE( cache.find("http://b/1", entry_2) );
+    EXPECT_EQ( entry_1.hash, entry_2.hash );
+}
+
+TEST_F(ObjectCacheSimpleF, evict_least_recently_used)
+{
+    {
+        ObjectCacheSimple cache{dir, 25};
+        put(cache, "http://a/1", "aaaaaaaaaa");
+        put(cache, "http://a/2", "bbbbbbbbbb");
+
+        Entry entry;
+        ASSERT_TRUE( cache.find("http://a/1", entry) );
+        put(cache, "http://a/3", "cccccccccc");
+        EXPECT_EQ( cache.used(), 20u );
+
+        EXPECT_TRUE( exists( sha256("aaaaaaaaaa") ) );
+        EXPECT_FALSE( exists( sha256("bbbbbbbbbb") ) );
+        EXPECT_FALSE( cache.find("http://a/2", entry) );
+        EXPECT_TRUE( cache.find("http://a/3", entry) );
+    }
+
+    // Lower capacity evicts on start
+    ObjectCacheSimple cache{dir, 15};
+    EXPECT_EQ( cache.used(), 10u );
+    Entry entry;
+    EXPECT_TRUE( cache.find("http://a/3", entry) );
+    EXPECT_FALSE( cache.find("http://a/1", entry) );
+}
+
+TEST_F(ObjectCacheSimpleF, recency_from_use_log)
+{
+    {
+        ObjectCacheSimple cache{dir, 1024};
+        put(cache, "http://a/1", "aaaaaaaaaa");
+        put(cache, "http://a/2", "bbbbbbbbbb");
+        Entry entry;
+        ASSERT_TRUE( cache.find("http://a/1", entry) );
+    }
+
+    // Mtimes say the opposite of the uses
+    const struct timespec older[2] = { {1000, 0}, {1000, 0} };
+    const struct timespec newer[2] = { {2000, 0}, {2000, 0} };
+    ASSERT_EQ( ::utimensat( AT_FDCWD, (dir + "/objects/" + sha256("aaaaaaaaaa")).c_str(), older, 0 ), 0 );
+    ASSERT_EQ( ::utimensat( AT_FDCWD, (dir + "/objects/" + sha256("bbbbbbbbbb")).c_str(), newer, 0 ), 0 );
+
+    ObjectCacheSimple cache{dir, 15};
+    EXPECT_TRUE( exists( sha256("aaaaaaaaaa") ) );
+    EXPECT_FALSE( exists( sha256("bbbbbbbbbb") ) );
+}
+
+TEST_F(ObjectCacheSimpleF, forget_and_torn_record)
+{
+    {
+        ObjectCacheSimple cache{dir, 1024};
+        put(cache, "http://a/1", "first");
+        put(cache, "http://a/2", "second");
+        cache.forget("http://a/1");
+    }
+    {
+        ofstream stream{dir + "/index", std::ios::app};
+        stream << sha256("second") << "\t6\t\t\thttp://a/";
+    }
+
+    ObjectCacheSimple cache{dir, 1024};
+    EXPECT_EQ( cache.loaded(), 1u );
+    Entry entry;
+    EXPECT_FALSE( cache.find("http://a/1", entry) );
+    EXPECT_FALSE( cache.find("http://a/", entry) );
+    EXPECT_TRUE( cache.find("http://a/2", entry) );
+}
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <random>
+#include <sstream>
 
 using ::std::size_t;
 using ::std::string;
@@ -174,6 +175,8 @@ TEST_F(OnTickSimpleF_nextTask, Downloader_is_Done)
             .WillRepeatedly( ReturnRef(status) );
     EXPECT_CALL( *other_downloader, status() )
             .Times(0);
+    EXPECT_CALL( task_list, finish(0, true) )
+            .Times(1);
 
     OnTickSimple on_tick{job_list, factory, task_list, dashboard};
     on_tick.invoke(used_downloader);
@@ -187,6 +190,8 @@ TEST_F(OnTickSimpleF_nextTask, Downloader_is_Failed)
             .WillRepeatedly( ReturnRef(status) );
     EXPECT_CALL( *other_downloader, status() )
             .Times(0);
+    EXPECT_CALL( task_list, finish(0, false) )
+            .Times(1);
 
     OnTickSimple on_tick{job_list, factory, task_list, dashboard};
     on_tick.invoke(used_downloader);
@@ -666,3 +671,205 @@ TEST_F(OnTickSimpleF_invalidDownloader, unknow_Downloader)
     OnTickSimple on_tick{job_list, factory, task_list, dashboard};
     ASSERT_THROW( on_tick.invoke(unknow_downloader), std::runtime_error );
 }
+
+TEST(OnTickSimple, start_and_refill_vacant)
+{
+    JobList job_list;
+    auto factory = make_shared<FactoryMock>();
+    TaskListMock task_list;
+    DashboardMock dashboard;
+    auto downloader_1 = make_shared<DownloaderMock>();
+    auto downloader_2 = make_shared<DownloaderMock>();
+    auto downloader_3 = make_shared<DownloaderMock>();
+
+    // Second slot is held back by TaskList
+    EXPECT_CALL( task_list, get() )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/1", "1.zip", 1) ) ) )
+            .WillOnce( Return( ByMove( nullptr ) ) );
+    EXPECT_CALL( *factory, create(_, "http://internet.org/1", "1.zip") )
+            .WillOnce( Return(downloader_1) );
+
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.start(2);
+    ASSERT_EQ( job_list.size(), 1u );
+    EXPECT_EQ( job_list.front().line, 1u );
+    ::testing::Mock::VerifyAndClearExpectations(&task_list);
+
+    // Both slots are filled after job finished
+    StatusDownloader status;
+    status.state = StatusDownloader::State::Done;
+    EXPECT_CALL( *downloader_1, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( dashboard, update(_,_) )
+            .Times(1);
+    EXPECT_CALL( task_list, finish(1, true) )
+            .Times(1);
+    EXPECT_CALL( task_list, get() )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/2", "2.zip", 2) ) ) )
+            .WillOnce( Return( ByMove( make_unique<Task>("bad_uri", "3.zip", 3) ) ) )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/4", "4.zip", 4) ) ) );
+    EXPECT_CALL( *factory, create(_, "http://internet.org/2", "2.zip") )
+            .WillOnce( Return(downloader_2) );
+    EXPECT_CALL( *factory, create(_, "bad_uri", "3.zip") )
+            .WillOnce( Return(nullptr) );
+    EXPECT_CALL( task_list, finish(3, false) )
+            .Times(1);
+    EXPECT_CALL( *factory, create(_, "http://internet.org/4", "4.zip") )
+            .WillOnce( Return(downloader_3) );
+
+    on_tick.invoke(downloader_1);
+    ASSERT_EQ( job_list.size(), 2u );
+    EXPECT_EQ( job_list.front().downloader, downloader_2 );
+    EXPECT_EQ( job_list.back().downloader, downloader_3 );
+}
+
+TEST_F(OnTickSimpleF, lookup_after_redirect)
+{
+    StatusDownloader status;
+    status.state = StatusDownloader::State::Redirect;
+    status.redirect_uri = "http://internet.org/redirect";
+    EXPECT_CALL( *used_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+
+    auto redirect_downloader = make_shared<DownloaderMock>();
+    EXPECT_CALL( *factory, create(used_job_id, status.redirect_uri, used_fname) )
+            .WillOnce( Return(redirect_downloader) );
+    EXPECT_CALL( dashboard, update(used_job_id,_) )
+            .Times(2);
+
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.invoke(used_downloader);
+
+    ASSERT_THROW( on_tick.invoke(used_downloader), std::runtime_error );
+
+    StatusDownloader status_redirected;
+    status_redirected.state = StatusDownloader::State::OnTheGo;
+    EXPECT_CALL( *redirect_downloader, status() )
+            .WillRepeatedly( ReturnRef(status_redirected) );
+    on_tick.invoke(redirect_downloader);
+}
+
+TEST_F(OnTickSimpleF, sweep)
+{
+    StatusDownloader used_status;
+    used_status.state = StatusDownloader::State::OnTheGo;
+    used_status.downloaded = 42;
+    EXPECT_CALL( *used_downloader, status() )
+            .WillRepeatedly( ReturnRef(used_status) );
+    StatusDownloader other_status;
+    other_status.state = StatusDownloader::State::OnTheGo;
+    other_status.downloaded = 24;
+    EXPECT_CALL( *other_downloader, status() )
+            .WillRepeatedly( ReturnRef(other_status) );
+
+    {
+        ::testing::InSequence s;
+        EXPECT_CALL( dashboard, progress(used_job_id, ::testing::Field(&StatusDownloader::downloaded, 42u)) )
+                .Times(1);
+        EXPECT_CALL( dashboard, progress(other_job_id, ::testing::Field(&StatusDownloader::downloaded, 24u)) )
+                .Times(1);
+        EXPECT_CALL( dashboard, sweep_done() )
+                .Times(1);
+    }
+    EXPECT_CALL( dashboard, update(_,_) )
+            .Times(0);
+
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.sweep();
+}
+
+TEST_F(OnTickSimpleF, complete_on_last_job)
+{
+    StatusDownloader status;
+    status.state = StatusDownloader::State::Done;
+    EXPECT_CALL( *used_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( *other_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( dashboard, update(_,_) )
+            .Times(2);
+    EXPECT_CALL( task_list, get() )
+            .WillRepeatedly( Invoke( []() { return nullptr; } ) );
+
+    size_t complete_count = 0;
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.set_OnComplete( [&complete_count]() { complete_count++; } );
+
+    on_tick.invoke(used_downloader);
+    EXPECT_EQ( complete_count, 0u );
+
+    on_tick.invoke(other_downloader);
+    EXPECT_EQ( complete_count, 1u );
+    EXPECT_TRUE( job_list.empty() );
+}
+
+TEST(OnTickSimple, complete_on_empty_task_list)
+{
+    JobList job_list;
+    auto factory = make_shared<FactoryMock>();
+    TaskListMock task_list;
+    DashboardMock dashboard;
+
+    EXPECT_CALL( task_list, get() )
+            .WillOnce( Return( ByMove( nullptr ) ) );
+
+    bool completed = false;
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.set_OnComplete( [&completed]() { completed = true; } );
+    on_tick.start(4);
+    EXPECT_TRUE(completed);
+}
+
+TEST_F(OnTickSimpleF, drain_stops_new_tasks)
+{
+    StatusDownloader status;
+    status.state = StatusDownloader::State::Done;
+    EXPECT_CALL( *used_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( *other_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( dashboard, update(_,_) )
+            .Times(2);
+    EXPECT_CALL( task_list, get() )
+            .Times(0);
+    EXPECT_CALL( *factory, create(_,_,_) )
+            .Times(0);
+
+    size_t complete_count = 0;
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.set_OnComplete( [&complete_count]() { complete_count++; } );
+    on_tick.drain();
+    EXPECT_EQ( complete_count, 0u );
+
+    on_tick.invoke(used_downloader);
+    EXPECT_EQ( complete_count, 0u );
+    EXPECT_EQ( job_list.size(), 1u );
+
+    on_tick.invoke(other_downloader);
+    EXPECT_EQ( complete_count, 1u );
+    EXPECT_TRUE( job_list.empty() );
+}
+
+TEST_F(OnTickSimpleF, snapshot)
+{
+    StatusDownloader status;
+    status.state = StatusDownloader::State::OnTheGo;
+    status.downloaded = 42;
+    status.size = 100;
+    EXPECT_CALL( *used_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+    EXPECT_CALL( *other_downloader, status() )
+            .WillRepeatedly( ReturnRef(status) );
+
+    OnTickSimple on_tick{job_list, factory, task_list, dashboard};
+    on_tick.drain();
+    std::ostringstream out;
+    on_tick.snapshot(out);
+
+    const auto text = out.str();
+    EXPECT_NE( text.find("2 running"), string::npos );
+    EXPECT_NE( text.find("draining"), string::npos );
+    EXPECT_NE( text.find("#" + std::to_string(used_job_id) + " <" + used_fname + ">"), string::npos );
+    EXPECT_NE( text.find(other_fname), string::npos );
+    EXPECT_NE( text.find("42/100"), string::npos );
+}
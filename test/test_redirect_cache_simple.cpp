@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "redirect_cache_simple.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::ofstream;
+using ::std::stringstream;
+
+struct RedirectCacheSimpleF : public ::testing::Test
+{
+    RedirectCacheSimpleF()
+        : fname{"test_redirect_cache_simple.log"}
+    {
+        std::remove( fname.c_str() );
+    }
+
+    virtual ~RedirectCacheSimpleF()
+    {
+        std::remove( fname.c_str() );
+    }
+
+    string content() const
+    {
+        ifstream stream{fname};
+        stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+
+    const string fname;
+};
+
+TEST(RedirectCacheSimple, chain_and_loop)
+{
+    RedirectCacheSimple cache{16};
+    string target;
+    EXPECT_FALSE( cache.find("http://a/1", target) );
+
+    cache.record("http://a/1", "http://b/1");
+    cache.record("http://b/1", "http://c/1");
+    cache.record("http://c/1", "http://c/1");
+    EXPECT_TRUE( cache.find("http://a/1", target) );
+    EXPECT_EQ( target, "http://c/1" );
+    EXPECT_TRUE( cache.find("http://b/1", target) );
+    EXPECT_EQ( target, "http://c/1" );
+    EXPECT_EQ( cache.size(), 2 );
+
+    cache.record("http://c/1", "http://a/1");
+    EXPECT_FALSE( cache.find("http://a/1", target) );
+}
+
+TEST(RedirectCacheSimple, evict_least_recently_used)
+{
+    RedirectCacheSimple cache{2};
+    string target;
+    cache.record("http://a/1", "http://b/1");
+    cache.record("http://a/2", "http://b/2");
+    EXPECT_TRUE( cache.find("http://a/1", target) );
+
+    cache.record("http://a/3", "http://b/3");
+    EXPECT_EQ( cache.size(), 2 );
+    EXPECT_TRUE( cache.find("http://a/1", target) );
+    EXPECT_FALSE( cache.find("http://a/2", target) );
+    EXPECT_TRUE( cache.find("http://a/3", target) );
+}
+
+TEST_F(RedirectCacheSimpleF, record_and_restart)
+{
+    {
+        RedirectCacheSimple cache{16, fname};
+        cache.record("http://a/1", "http://b/1");
+        cache.record("http://a/1", "http://b/1");
+        cache.record("http://a/2", "http://b/2");
+        cache.record("http://a/2", "http://c/2");
+        cache.record("http://a/3", "http://b/3\tbad");
+    }
+    EXPECT_EQ( content(), "http://a/1\thttp://b/1\nhttp://a/2\thttp://b/2\nhttp://a/2\thttp://c/2\n" );
+
+    RedirectCacheSimple cache{16, fname};
+    string target;
+    EXPECT_EQ( cache.size(), 2 );
+    EXPECT_TRUE( cache.find("http://a/2", target) );
+    EXPECT_EQ( target, "http://c/2" );
+}
+
+TEST_F(RedirectCacheSimpleF, cut_torn_record_and_compact)
+{
+    {
+        ofstream stream{fname};
+        for (int i = 0; i < 100; i++)
+            stream << "http://a/1\thttp://b/" << i << "\n";
+        stream << "http://a/2\thttp://b";
+    }
+
+    {
+        RedirectCacheSimple cache{16, fname};
+        string target;
+        EXPECT_EQ( cache.size(), 1 );
+        EXPECT_TRUE( cache.find("http://a/1", target) );
+        EXPECT_EQ( target, "http://b/99" );
+        EXPECT_FALSE( cache.find("http://a/2", target) );
+    }
+    EXPECT_EQ( content(), "http://a/1\thttp://b/99\n" );
+}
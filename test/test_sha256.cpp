@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include "sha256.h"
+
+#include <string>
+
+using ::std::string;
+
+static string sha256(const string& data)
+{
+    Sha256 hash;
+    hash.update( data.data(), data.size() );
+    return hash.hex();
+}
+
+TEST(Sha256, known_vectors)
+{
+    EXPECT_EQ( sha256(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" );
+    EXPECT_EQ( sha256("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" );
+    EXPECT_EQ( sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+               "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" );
+    EXPECT_EQ( sha256( string(1000000, 'a') ), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" );
+}
+
+TEST(Sha256, split_updates)
+{
+    const string data(300, 'x');
+    const auto expected = sha256(data);
+
+    // Chunks cross the 64 byte block boundary at every offset
+    for (std::size_t step = 1; step < 130; step += 7)
+    {
+        Sha256 hash;
+        for (std::size_t pos = 0; pos < data.size(); pos += step)
+            hash.update( data.data() + pos, std::min(step, data.size() - pos) );
+        EXPECT_EQ( hash.hex(), expected ) << "step " << step;
+    }
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "downloader.h"
+
+#include <uv.h>
+
+using State = StatusDownloader::State;
+using Phase = StatusDownloader::Phase;
+using Error = StatusDownloader::Error;
+
+TEST(StatusDownloader, default_state)
+{
+    StatusDownloader status;
+    EXPECT_EQ( status.state, State::Init );
+    EXPECT_EQ( status.error, Error::None );
+    EXPECT_EQ( status.error_code, 0 );
+    EXPECT_EQ( status.http_status, 0u );
+}
+
+TEST(StatusDownloader, phase_str)
+{
+    StatusDownloader status;
+    status.state = State::OnTheGo;
+    status.phase = Phase::Request;
+    EXPECT_EQ( status.str(), "Connected, write request." );
+
+    status.phase = Phase::Receive;
+    EXPECT_EQ( status.str(), "Data received." );
+}
+
+TEST(StatusDownloader, done_and_redirect_str)
+{
+    StatusDownloader status;
+    status.state = State::Done;
+    EXPECT_EQ( status.str(), "Downloading complete" );
+
+    status.state = State::Redirect;
+    status.redirect_uri = "http://internet.org/other";
+    EXPECT_EQ( status.str(), "Redirect to <http://internet.org/other>" );
+
+    status.state = State::Suspended;
+    EXPECT_EQ( status.str(), "Suspended" );
+}
+
+TEST(StatusDownloader, error_str)
+{
+    StatusDownloader status;
+    status.state = State::Failed;
+    status.error = Error::Abort;
+    EXPECT_EQ( status.str(), "Abort." );
+
+    status.error = Error::Connect;
+    status.error_code = UV_ECONNREFUSED;
+    status.detail = "127.0.0.1";
+    EXPECT_EQ( status.str(), "Host <127.0.0.1> can`t available. Code => " + std::to_string(UV_ECONNREFUSED) + " Reason => " + uv_strerror(UV_ECONNREFUSED) );
+
+    status.error = Error::ResponseParse;
+    status.error_code = 0;
+    status.detail = "404 Not Found";
+    EXPECT_EQ( status.str(), "Response parse failed. 404 Not Found" );
+}
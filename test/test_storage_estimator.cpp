@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/aio/bandwidth_time_mock.h"
+
+#include "aio/storage_estimator.h"
+
+using ::aio::bandwidth::TimeMock;
+using ::aio::storage::EstimatorSimple;
+
+using ::std::size_t;
+using ::std::make_unique;
+using ::std::move;
+using ::std::chrono::milliseconds;
+
+using ::testing::Return;
+using ::testing::Mock;
+
+struct storage_EstimatorSimpleF : public ::testing::Test
+{
+    storage_EstimatorSimpleF()
+    {
+        auto t = make_unique<TimeMock>();
+        time = t.get();
+        estimator = make_unique<EstimatorSimple>( move(t), milliseconds{200} );
+    }
+
+    TimeMock* time;
+    std::unique_ptr<EstimatorSimple> estimator;
+};
+
+TEST_F(storage_EstimatorSimpleF, unknown)
+{
+    EXPECT_EQ( estimator->ceiling(), 0 );
+
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{0} ) )
+            .WillOnce( Return( milliseconds{100} ) );
+    estimator->write_begin();
+    estimator->write_end(4096);
+
+    EXPECT_EQ( estimator->ceiling(), 0 );
+}
+
+TEST_F(storage_EstimatorSimpleF, measure)
+{
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{5000} ) ) // idle
+            .WillOnce( Return( milliseconds{250} ) );
+    estimator->write_begin();
+    estimator->write_end(1000);
+    EXPECT_EQ( estimator->ceiling(), 4000 );
+    Mock::VerifyAndClearExpectations(time);
+
+    // Smoothing
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{1000} ) )
+            .WillOnce( Return( milliseconds{200} ) );
+    estimator->write_begin();
+    estimator->write_end(1600);
+    EXPECT_EQ( estimator->ceiling(), (4000 * 3 + 8000) / 4 );
+}
+
+TEST_F(storage_EstimatorSimpleF, concurrent_writes)
+{
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{0} ) )
+            .WillOnce( Return( milliseconds{100} ) )
+            .WillOnce( Return( milliseconds{100} ) );
+    estimator->write_begin();
+    estimator->write_begin();
+    estimator->write_end(2000);
+    estimator->write_end(2000);
+    EXPECT_EQ( estimator->ceiling(), 20000 );
+}
+
+TEST_F(storage_EstimatorSimpleF, abort)
+{
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{0} ) );
+    estimator->write_begin();
+    estimator->write_abort();
+    estimator->write_abort();
+    estimator->write_end(42);
+    Mock::VerifyAndClearExpectations(time);
+
+    EXPECT_CALL( *time, elapsed_() )
+            .WillOnce( Return( milliseconds{300} ) )
+            .WillOnce( Return( milliseconds{500} ) );
+    estimator->write_begin();
+    estimator->write_end(1000);
+    EXPECT_EQ( estimator->ceiling(), 2000 );
+}
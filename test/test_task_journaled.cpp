@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/task_mock.h"
+#include "mock/journal_mock.h"
+
+#include "task_journaled.h"
+
+using ::std::unique_ptr;
+using ::std::make_unique;
+
+using ::testing::Return;
+using ::testing::ByMove;
+using ::testing::InSequence;
+
+TEST(TaskListJournaled, skip_completed)
+{
+    TaskListMock source;
+    JournalMock journal;
+
+    EXPECT_CALL( source, get() )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/1", "1.zip", 1) ) ) )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/2", "2.zip", 2) ) ) )
+            .WillOnce( Return( ByMove( make_unique<Task>("http://internet.org/3", "3.zip", 3) ) ) )
+            .WillOnce( Return( ByMove( nullptr ) ) );
+    EXPECT_CALL( journal, completed_(1) )
+            .WillOnce( Return(true) );
+    EXPECT_CALL( journal, completed_(2) )
+            .WillOnce( Return(true) );
+    EXPECT_CALL( journal, completed_(3) )
+            .WillOnce( Return(false) );
+
+    TaskListJournaled task_list{source, journal};
+
+    auto task = task_list.get();
+    ASSERT_TRUE(task);
+    EXPECT_EQ(task->line, 3u);
+    EXPECT_FALSE( task_list.get() );
+    EXPECT_EQ( task_list.skipped(), 2u );
+}
+
+TEST(TaskListJournaled, record_finished)
+{
+    TaskListMock source;
+    JournalMock journal;
+
+    InSequence s;
+    EXPECT_CALL( journal, record(42, true) )
+            .Times(1);
+    EXPECT_CALL( source, finish(42, true) )
+            .Times(1);
+    EXPECT_CALL( journal, record(43, false) )
+            .Times(1);
+    EXPECT_CALL( source, finish(43, false) )
+            .Times(1);
+
+    TaskListJournaled task_list{source, journal};
+    task_list.finish(42, true);
+    task_list.finish(43, false);
+}
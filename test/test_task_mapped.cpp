@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "task_mapped.h"
+
+#include <fstream>
+#include <thread>
+#include <cstdio>
+#include <sys/stat.h>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::to_string;
+using ::std::ofstream;
+
+struct TaskListMappedF : public ::testing::Test
+{
+    TaskListMappedF()
+        : fname{"test_task_mapped.txt"}
+    {}
+
+    virtual ~TaskListMappedF()
+    {
+        std::remove( fname.c_str() );
+    }
+
+    void write(const string& content)
+    {
+        ofstream stream{fname, ofstream::binary | ofstream::trunc};
+        stream << content;
+    }
+
+    const string fname;
+};
+
+TEST_F(TaskListMappedF, normal)
+{
+    write("http://internet.org/archive.bin downloaded_file_1.zip\n"
+          "\n"
+          "xyz\n"
+          "  http://internet.org/download/\t New_file.zip  xyz\r\n"
+          "http://internet.org/last last.zip sha256:E3B0c442");
+
+    TaskListMapped task_list{fname, "/home/"};
+
+    auto task_1 = task_list.get();
+    ASSERT_TRUE(task_1);
+    EXPECT_EQ(task_1->uri, "http://internet.org/archive.bin");
+    EXPECT_EQ(task_1->fname, "/home/downloaded_file_1.zip");
+    EXPECT_EQ(task_1->line, 1u);
+
+    auto task_2 = task_list.get();
+    ASSERT_TRUE(task_2);
+    EXPECT_EQ(task_2->uri, "http://internet.org/download/");
+    EXPECT_EQ(task_2->fname, "/home/New_file.zip");
+    EXPECT_EQ(task_2->line, 4u);
+    EXPECT_TRUE(task_2->digest.empty());
+
+    auto task_3 = task_list.get();
+    ASSERT_TRUE(task_3);
+    EXPECT_EQ(task_3->uri, "http://internet.org/last");
+    EXPECT_EQ(task_3->fname, "/home/last.zip");
+    EXPECT_EQ(task_3->line, 5u);
+    EXPECT_EQ(task_3->digest, "sha256:E3B0c442");
+
+    EXPECT_FALSE( task_list.get() );
+    EXPECT_FALSE( task_list.get() );
+}
+
+TEST_F(TaskListMappedF, empty_file)
+{
+    write("");
+
+    TaskListMapped task_list{fname, string{} };
+    EXPECT_FALSE( task_list.get() );
+}
+
+TEST_F(TaskListMappedF, many_lines)
+{
+    const size_t count = 5000;
+    string content;
+    for (size_t i = 1; i <= count; i++)
+        content += (i % 7 == 0) ? "\n" : "http://internet.org/" + to_string(i) + " " + to_string(i) + ".zip\n";
+    write(content);
+
+    TaskListMapped task_list{fname, string{} };
+
+    size_t line = 0;
+    while (auto task = task_list.get())
+    {
+        if (++line % 7 == 0)
+            ++line;
+        ASSERT_EQ(task->line, line);
+        ASSERT_EQ(task->fname, to_string(line) + ".zip");
+    }
+    EXPECT_EQ(line, count);
+}
+
+TEST_F(TaskListMappedF, fifo)
+{
+    ASSERT_EQ( ::mkfifo(fname.c_str(), S_IRUSR | S_IWUSR), 0 );
+    std::thread writer{ [this]() { write("http://internet.org/1 1.zip\n\nhttp://internet.org/3 3.zip"); } };
+
+    TaskListMapped task_list{fname, "/home/"};
+    writer.join();
+
+    auto task_1 = task_list.get();
+    ASSERT_TRUE(task_1);
+    EXPECT_EQ(task_1->uri, "http://internet.org/1");
+    EXPECT_EQ(task_1->fname, "/home/1.zip");
+    auto task_3 = task_list.get();
+    ASSERT_TRUE(task_3);
+    EXPECT_EQ(task_3->line, 3u);
+    EXPECT_FALSE( task_list.get() );
+}
+
+TEST(TaskListMapped, file_not_exist)
+{
+    ASSERT_THROW( (TaskListMapped{"not_exist_task_file.txt", string{} }), std::runtime_error );
+}
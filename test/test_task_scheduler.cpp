@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "mock/task_mock.h"
+
+#include "task_scheduler.h"
+
+#include <deque>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::make_unique;
+using ::std::deque;
+
+using ::testing::Invoke;
+using ::testing::Mock;
+using ::testing::AnyNumber;
+using ::testing::_;
+
+struct TaskListSchedulerF : public ::testing::Test
+{
+    TaskListSchedulerF()
+    {
+        EXPECT_CALL( source, get() )
+                .WillRepeatedly( Invoke( [this]() -> unique_ptr<Task>
+        {
+            if ( tasks.empty() )
+                return nullptr;
+            auto task = make_unique<Task>( tasks.front(), "fname", ++line );
+            tasks.pop_front();
+            read++;
+            return task;
+        } ) );
+    }
+
+    void push(const string& uri, size_t count = 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            tasks.push_back(uri);
+    }
+
+    TaskListMock source;
+    deque<string> tasks;
+    size_t line = 0;
+    size_t read = 0;
+};
+
+TEST_F(TaskListSchedulerF, round_robin)
+{
+    push("http://slow.org/file", 3);
+    push("http://fast.org/file", 2);
+    push("http://other.org/file");
+
+    TaskListScheduler scheduler{source, 0};
+
+    const string expected[] = { "http://slow.org/file", "http://fast.org/file", "http://other.org/file",
+                                "http://slow.org/file", "http://fast.org/file", "http://slow.org/file" };
+    for (const auto& uri : expected)
+    {
+        auto task = scheduler.get();
+        ASSERT_TRUE(task);
+        EXPECT_EQ(task->uri, uri);
+    }
+    EXPECT_FALSE( scheduler.get() );
+}
+
+TEST_F(TaskListSchedulerF, per_host_limit)
+{
+    push("http://slow.org/file", 3);
+    push("http://fast.org/file");
+
+    TaskListScheduler scheduler{source, 1};
+
+    auto task_1 = scheduler.get();
+    ASSERT_TRUE(task_1);
+    EXPECT_EQ(task_1->uri, "http://slow.org/file");
+    auto task_2 = scheduler.get();
+    ASSERT_TRUE(task_2);
+    EXPECT_EQ(task_2->uri, "http://fast.org/file");
+
+    // slow.org is saturated
+    EXPECT_FALSE( scheduler.get() );
+
+    EXPECT_CALL( source, finish(task_1->line, true) )
+            .Times(1);
+    scheduler.finish(task_1->line, true);
+    Mock::VerifyAndClearExpectations(&source);
+
+    auto task_3 = scheduler.get();
+    ASSERT_TRUE(task_3);
+    EXPECT_EQ(task_3->uri, "http://slow.org/file");
+    EXPECT_FALSE( scheduler.get() );
+
+    // Finish of other host doesn`t release slow.org
+    EXPECT_CALL( source, finish(task_2->line, false) )
+            .Times(1);
+    scheduler.finish(task_2->line, false);
+    EXPECT_FALSE( scheduler.get() );
+}
+
+TEST_F(TaskListSchedulerF, window)
+{
+    push("http://slow.org/file", 10);
+    push("http://fast.org/file");
+
+    TaskListScheduler scheduler{source, 1, 4};
+
+    auto task = scheduler.get();
+    ASSERT_TRUE(task);
+    EXPECT_EQ(read, 4u);
+
+    // fast.org is beyond the window
+    EXPECT_FALSE( scheduler.get() );
+    EXPECT_EQ(read, 5u);
+
+    EXPECT_CALL( source, finish(_, true) )
+            .Times(AnyNumber());
+    scheduler.finish(task->line, true);
+    task = scheduler.get();
+    ASSERT_TRUE(task);
+    EXPECT_EQ(task->uri, "http://slow.org/file");
+}
+
+TEST_F(TaskListSchedulerF, mirrors_counted_by_first_host)
+{
+    push("http://slow.org/file|http://mirror.org/file");
+    push("http://slow.org/other");
+
+    TaskListScheduler scheduler{source, 1};
+
+    auto task = scheduler.get();
+    ASSERT_TRUE(task);
+    EXPECT_EQ(task->uri, "http://slow.org/file|http://mirror.org/file");
+    EXPECT_FALSE( scheduler.get() );
+}
@@ -98,6 +98,25 @@ TEST(TaskListSimple, skip_line_not_complete)
     ASSERT_EQ(task_2->fname, fname_2);
 }
 
+TEST(TaskListSimple, line_number)
+{
+    stringstream stream;
+    stream << "http://internet.org/archive.bin" << " " << "downloaded_file_1.zip" << endl;
+    stream << endl;
+    stream << "xyz" << endl;
+    stream << "http://internet.org/download/" << " " << "New_file.zip" << endl;
+
+    TaskListSimple task_list{stream, string{} };
+
+    auto task_1 = task_list.get();
+    ASSERT_TRUE(task_1);
+    ASSERT_EQ(task_1->line, 1u);
+
+    auto task_2 = task_list.get();
+    ASSERT_TRUE(task_2);
+    ASSERT_EQ(task_2->line, 4u);
+}
+
 TEST(TaskListSimple, ignore_whitespace_charters)
 {
     const string uri = "http://internet.org/archive.bin";
@@ -128,6 +147,19 @@ TEST(TaskListSimple, ignore_additional_word)
     ASSERT_TRUE(task);
     ASSERT_EQ(task->uri, uri);
     ASSERT_EQ(task->fname, fname);
+    ASSERT_TRUE(task->digest.empty());
+}
+
+TEST(TaskListSimple, digest)
+{
+    stringstream stream;
+    stream << "http://internet.org/archive.bin downloaded_file_1.zip crc32c:e3069283" << std::endl;
+
+    TaskListSimple task_list{stream, string{} };
+
+    auto task = task_list.get();
+    ASSERT_TRUE(task);
+    ASSERT_EQ(task->digest, "crc32c:e3069283");
 }
 
 TEST(TaskListSimple, constructor)
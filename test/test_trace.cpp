@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include "trace.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::stringstream;
+using ::std::chrono::milliseconds;
+
+struct TraceF : public ::testing::Test
+{
+    TraceF()
+        : fname{"test_trace.json"}
+    {
+        std::remove( fname.c_str() );
+    }
+
+    virtual ~TraceF()
+    {
+        std::remove( fname.c_str() );
+    }
+
+    string content() const
+    {
+        ifstream stream{fname};
+        stringstream buffer;
+        buffer << stream.rdbuf();
+        return buffer.str();
+    }
+
+    static std::size_t count(const string& text, const string& what)
+    {
+        std::size_t n = 0;
+        for (auto pos = text.find(what); pos != string::npos; pos = text.find(what, pos + 1))
+            n++;
+        return n;
+    }
+
+    const string fname;
+};
+
+TEST_F(TraceF, disabled)
+{
+    ASSERT_FALSE( trace::enabled() );
+    const auto now = trace::Clock::now();
+    trace::span( "resolve", 1, now, now + milliseconds{1} );
+    trace::counter( "queued bytes", 10 );
+
+    trace::start();
+    ASSERT_TRUE( trace::write(fname) );
+    EXPECT_FALSE( trace::enabled() );
+    EXPECT_EQ( count(content(), "\"ph\""), 0u );
+}
+
+TEST_F(TraceF, events)
+{
+    trace::start();
+    ASSERT_TRUE( trace::enabled() );
+
+    const auto track = trace::new_track("file \"1\".zip");
+    const auto begin = trace::Clock::now();
+    trace::span( "connect", track, begin, begin + milliseconds{3} );
+    trace::span( "wait", track, trace::Clock::time_point{}, begin ); // phase not reached
+    trace::instant( "error", track, "Connection closed" );
+    trace::counter( "bandwidth budget", 4096 );
+
+    ASSERT_TRUE( trace::write(fname) );
+    const auto text = content();
+
+    EXPECT_EQ( text.find("{\"displayTimeUnit\""), 0u );
+    EXPECT_EQ( count(text, "\"ph\""), 4u );
+    EXPECT_NE( text.find("\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(track) + ",\"name\":\"thread_name\",\"args\":{\"name\":\"file \\\"1\\\".zip\"}"), string::npos );
+    EXPECT_NE( text.find("\"name\":\"connect\",\"ts\":"), string::npos );
+    EXPECT_NE( text.find("\"dur\":3000}"), string::npos );
+    EXPECT_NE( text.find("\"ph\":\"i\""), string::npos );
+    EXPECT_NE( text.find("\"args\":{\"detail\":\"Connection closed\"}"), string::npos );
+    EXPECT_NE( text.find("\"name\":\"bandwidth budget\""), string::npos );
+    EXPECT_NE( text.find("\"args\":{\"value\":4096}"), string::npos );
+    EXPECT_EQ( text.find("\"name\":\"wait\""), string::npos );
+}
+
+TEST_F(TraceF, thread_buffers_merged)
+{
+    trace::start();
+    std::thread worker{ []() { trace::counter( "worker", 1 ); } };
+    worker.join();
+    trace::counter( "main", 2 );
+
+    ASSERT_TRUE( trace::write(fname) );
+    const auto text = content();
+    EXPECT_NE( text.find("\"name\":\"worker\""), string::npos );
+    EXPECT_NE( text.find("\"name\":\"main\""), string::npos );
+}
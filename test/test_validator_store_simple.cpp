@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include "validator_store_simple.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using ::std::string;
+using ::std::ifstream;
+using ::std::ofstream;
+using ::std::stringstream;
+
+using Validator = ValidatorStore::Validator;
+
+struct ValidatorStoreSimpleF : public ::testing::Test
+{
+    ValidatorStoreSimpleF()
+        : fname{"test_validator_store_simple.log"},
+          output{"test_validator_store_simple.out"}
+    {
+        std::remove( fname.c_str() );
+        write_output(12);
+    }
+
+    virtual ~ValidatorStoreSimpleF()
+    {
+        std::remove( fname.c_str() );
+        std::remove( output.c_str() );
+    }
+
+    void write_output(std::size_t size) const
+    {
+        ofstream stream{output};
+        stream << string(size, 'x');
+    }
+
+    string content() const
+    {
+        ifstream stream{fname};
+        stringstream ss;
+        ss << stream.rdbuf();
+        return ss.str();
+    }
+
+    const string fname;
+    const string output;
+};
+
+TEST_F(ValidatorStoreSimpleF, record_and_restart)
+{
+    {
+        ValidatorStoreSimple store{fname};
+        Validator validator;
+        EXPECT_FALSE( store.lookup("http://a/1", output, validator) );
+
+        store.record( "http://a/1", Validator{"\"58c2fb69-c\"", "", 12} );
+        store.record( "http://a/2", Validator{"", "Fri, 10 Mar 2017 19:20:09 GMT", 7} );
+        store.record( "http://a/3", Validator{} );
+        EXPECT_TRUE( store.lookup("http://a/1", output, validator) );
+        EXPECT_EQ( validator.etag, "\"58c2fb69-c\"" );
+    }
+    EXPECT_EQ( content(), "12\t\"58c2fb69-c\"\t\thttp://a/1\n"
+                          "7\t\tFri, 10 Mar 2017 19:20:09 GMT\thttp://a/2\n" );
+
+    ValidatorStoreSimple store{fname};
+    EXPECT_EQ( store.loaded(), 2u );
+    Validator validator;
+    ASSERT_TRUE( store.lookup("http://a/1", output, validator) );
+    EXPECT_EQ( validator.etag, "\"58c2fb69-c\"" );
+    EXPECT_TRUE( validator.last_modified.empty() );
+    EXPECT_EQ( validator.size, 12u );
+    // Recorded for another size
+    EXPECT_FALSE( store.lookup("http://a/2", output, validator) );
+}
+
+TEST_F(ValidatorStoreSimpleF, file_changed_or_missing)
+{
+    ValidatorStoreSimple store{fname};
+    store.record( "http://a/1", Validator{"\"1\"", "", 12} );
+
+    Validator validator;
+    EXPECT_TRUE( store.lookup("http://a/1", output, validator) );
+    EXPECT_FALSE( store.lookup("http://a/1", output + ".missing", validator) );
+    write_output(13);
+    EXPECT_FALSE( store.lookup("http://a/1", output, validator) );
+    // Regardless of the file
+    ASSERT_TRUE( store.find("http://a/1", validator) );
+    EXPECT_EQ( validator.etag, "\"1\"" );
+    EXPECT_FALSE( store.find("http://a/2", validator) );
+}
+
+TEST_F(ValidatorStoreSimpleF, last_record_wins)
+{
+    {
+        ValidatorStoreSimple store{fname};
+        store.record( "http://a/1", Validator{"\"1\"", "", 12} );
+        store.record( "http://a/2", Validator{"\"2\"", "", 12} );
+        store.record( "http://a/1", Validator{"\"3\"", "", 12} );
+        // Response without validators forgets the URI
+        store.record( "http://a/2", Validator{} );
+    }
+
+    ValidatorStoreSimple store{fname};
+    EXPECT_EQ( store.loaded(), 1u );
+    Validator validator;
+    ASSERT_TRUE( store.lookup("http://a/1", output, validator) );
+    EXPECT_EQ( validator.etag, "\"3\"" );
+    EXPECT_FALSE( store.lookup("http://a/2", output, validator) );
+}
+
+TEST_F(ValidatorStoreSimpleF, ignore_malformed_and_torn_records)
+{
+    {
+        ofstream stream{fname};
+        stream << "12\t\"1\"\t\thttp://a/1\n" << "garbage\n" << "x\t\"2\"\t\thttp://a/2\n" << "12\t\"3\"\t\thttp://a/";
+    }
+
+    {
+        ValidatorStoreSimple store{fname};
+        EXPECT_EQ( store.loaded(), 1u );
+        Validator validator;
+        EXPECT_TRUE( store.lookup("http://a/1", output, validator) );
+        EXPECT_FALSE( store.lookup("http://a/", output, validator) );
+
+        store.record( "http://a/4", Validator{"\"4\"", "", 12} );
+    }
+    EXPECT_EQ( content(), "12\t\"1\"\t\thttp://a/1\ngarbage\nx\t\"2\"\t\thttp://a/2\n12\t\"4\"\t\thttp://a/4\n" );
+
+    ValidatorStoreSimple store{fname};
+    EXPECT_EQ( store.loaded(), 2u );
+}
+
+TEST_F(ValidatorStoreSimpleF, compact_on_load)
+{
+    {
+        ofstream stream{fname};
+        for (int i = 0; i < 100; i++)
+            stream << i << "\t\"" << i << "\"\t\thttp://a/1\n";
+        stream << "5\t\"5\"\t\thttp://a/2\n" << "0\t\t\thttp://a/2\n";
+    }
+
+    {
+        ValidatorStoreSimple store{fname};
+        EXPECT_EQ( store.loaded(), 1u );
+        Validator validator;
+        EXPECT_TRUE( store.find("http://a/1", validator) );
+        EXPECT_EQ( validator.etag, "\"99\"" );
+    }
+    EXPECT_EQ( content(), "99\t\"99\"\t\thttp://a/1\n" );
+}
+
+TEST_F(ValidatorStoreSimpleF, owner_writes)
+{
+    ValidatorStoreSimple store{fname, 2};
+    std::size_t due = 0;
+    store.set_OnDue( [&due]() { due++; } );
+
+    store.record( "http://a/1", Validator{"\"1\"", "", 12} );
+    EXPECT_EQ( due, 0u );
+    store.record( "http://a/2", Validator{"\"2\"", "", 12} );
+    EXPECT_EQ( due, 1u );
+    EXPECT_EQ( content(), "" );
+
+    const auto data = store.take();
+    EXPECT_TRUE( store.take().empty() );
+    EXPECT_TRUE( store.write(data) );
+    EXPECT_EQ( content(), "12\t\"1\"\t\thttp://a/1\n12\t\"2\"\t\thttp://a/2\n" );
+
+    // A failed write is retried before later records
+    store.record( "http://a/3", Validator{"\"3\"", "", 12} );
+    auto failed = store.take();
+    store.record( "http://a/4", Validator{"\"4\"", "", 12} );
+    store.put_back( std::move(failed) );
+    EXPECT_EQ( store.take(), "12\t\"3\"\t\thttp://a/3\n12\t\"4\"\t\thttp://a/4\n" );
+}